@@ -26,6 +26,18 @@ char *passphrase;
 module_param(passphrase, charp, S_IRUGO);
 MODULE_PARM_DESC(passphrase, " Passphrase for AP. If set, use sec. offload");
 
+static uint sinfo_max_age_ms = 2000;
+module_param(sinfo_max_age_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(sinfo_max_age_ms,
+		 " Max. age of cached link status for station query, msec;"
+		 " refreshed in background after half of it. 0 - always ask FW");
+
+static uint sinfo_interval_ms = 500;
+module_param(sinfo_interval_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(sinfo_interval_ms,
+		 " Period for FW to report link status when single station"
+		 " connected, msec. 0 - disabled");
+
 #define CHAN60G(_channel, _flags) {				\
 	.band			= IEEE80211_BAND_60GHZ,		\
 	.center_freq		= 56160 + (2160 * (_channel)),	\
@@ -116,8 +128,110 @@ int wil_iftype_nl2wmi(enum nl80211_iftype type)
 	return -EOPNOTSUPP;
 }
 
-static int wil_cid_fill_sinfo(struct wil6210_priv *wil, int cid,
-			      struct station_info *sinfo)
+static int wil_connected_sta_count(struct wil6210_priv *wil)
+{
+	int i, n = 0;
+
+	for (i = 0; i < ARRAY_SIZE(wil->sta); i++)
+		if (wil->sta[i].status == wil_sta_connected)
+			n++;
+
+	return n;
+}
+
+static void wil_link_refresh_done(struct wil6210_priv *wil, void *ctx, int rc,
+				  void *reply, u16 len)
+{
+	int cid = (long)ctx;
+	struct wil_sta_info *sta = &wil->sta[cid];
+	struct {
+		struct wil6210_mbox_hdr_wmi wmi;
+		struct wmi_notify_req_done_event evt;
+	} __packed *r = reply;
+
+	/* cache updated before next refresh may start */
+	if (!rc && len >= sizeof(*r) && sta->status == wil_sta_connected)
+		wil_link_stats_update(wil, cid, &r->evt);
+	WRITE_ONCE(sta->link.refresh, false);
+}
+
+/*
+ * Ask FW for link status of @cid in background; answer comes while
+ * station query served from the cache.
+ * @link.refresh is set here, under rtnl as station queries are,
+ * and cleared by wil_link_refresh_done() on wmi_wq
+ */
+static void wil_link_refresh(struct wil6210_priv *wil, int cid)
+{
+	struct wmi_notify_req_cmd cmd = {
+		.cid = cid,
+		.interval_usec = 0,
+	};
+	struct wil_sta_info *sta = &wil->sta[cid];
+	int rc;
+
+	if (READ_ONCE(sta->link.refresh))
+		return;
+
+	WRITE_ONCE(sta->link.refresh, true);
+	rc = wmi_call_async(wil, WMI_NOTIFY_REQ_CMDID, &cmd, sizeof(cmd),
+			    WMI_NOTIFY_REQ_DONE_EVENTID,
+			    sizeof(struct wil6210_mbox_hdr_wmi) +
+			    sizeof(struct wmi_notify_req_done_event), 20,
+			    wil_link_refresh_done, (void *)(long)cid);
+	if (rc)
+		WRITE_ONCE(sta->link.refresh, false);
+}
+
+static void wil_link_notify_stop_done(struct wil6210_priv *wil, void *ctx,
+				      int rc, void *reply, u16 len)
+{
+	wil_dbg_wmi(wil, "Link status reports for CID %d stopped: %d\n",
+		    (int)(long)ctx, rc);
+}
+
+/*
+ * Stop periodic link status reports, don't wait for FW.
+ * @sinfo_notify_cid is reset first, so that wmi_evt_notify() drops
+ * reports still on their way. FW acknowledges with the same event the
+ * reports come with; the call absorbs it, else it would be taken for
+ * the reply to the query that follows. A report already in the mailbox
+ * may be absorbed instead, then the ack goes to that query: one sample
+ * of the former CID, rather than blocking station query on a barrier.
+ * @sinfo_notify_cid is written under rtnl only, read by wmi_evt_notify()
+ */
+static int wil_link_notify_stop(struct wil6210_priv *wil)
+{
+	struct wmi_notify_req_cmd stop = {
+		.cid = wil->sinfo_notify_cid,
+		.interval_usec = 0,
+	};
+	int rc;
+
+	wil_dbg_wmi(wil, "Stop link status reports for CID %d\n", stop.cid);
+	WRITE_ONCE(wil->sinfo_notify_cid, -1);
+	rc = wmi_call_async(wil, WMI_NOTIFY_REQ_CMDID, &stop, sizeof(stop),
+			    WMI_NOTIFY_REQ_DONE_EVENTID, 0, 20,
+			    wil_link_notify_stop_done, (void *)(long)stop.cid);
+	if (rc) {
+		wil_err(wil, "Failed to stop link status reports: %d\n", rc);
+		/* try again on the next query */
+		WRITE_ONCE(wil->sinfo_notify_cid, stop.cid);
+	}
+
+	return rc;
+}
+
+/*
+ * Get link status from FW, waiting for it.
+ *
+ * With single station connected, ask FW to keep reporting it
+ * periodically; reports carry no CID, so with several stations the
+ * periodic report is cancelled and stations refreshed on demand.
+ * Reports would be taken for the reply to query on other CID, so
+ * they are stopped before it
+ */
+static int wil_link_query(struct wil6210_priv *wil, int cid)
 {
 	struct wmi_notify_req_cmd cmd = {
 		.cid = cid,
@@ -127,14 +241,28 @@ static int wil_cid_fill_sinfo(struct wil6210_priv *wil, int cid,
 		struct wil6210_mbox_hdr_wmi wmi;
 		struct wmi_notify_req_done_event evt;
 	} __packed reply;
-	struct wil_net_stats *stats = &wil->sta[cid].stats;
+	bool periodic = sinfo_interval_ms &&
+			wil_connected_sta_count(wil) == 1;
+	int notify_cid = wil->sinfo_notify_cid;
 	int rc;
 
+	if (notify_cid >= 0 && (!periodic || notify_cid != cid)) {
+		rc = wil_link_notify_stop(wil);
+		if (rc)
+			return rc;
+	}
+
+	if (periodic)
+		cmd.interval_usec = cpu_to_le32(sinfo_interval_ms * 1000);
+
 	rc = wmi_call(wil, WMI_NOTIFY_REQ_CMDID, &cmd, sizeof(cmd),
 		      WMI_NOTIFY_REQ_DONE_EVENTID, &reply, sizeof(reply), 20);
 	if (rc)
 		return rc;
 
+	if (periodic)
+		WRITE_ONCE(wil->sinfo_notify_cid, cid);
+
 	wil_dbg_wmi(wil, "Link status for CID %d: {\n"
 		    "  MCS %d TSF 0x%016llx\n"
 		    "  BF status 0x%08x SNR 0x%08x SQI %d%%\n"
@@ -152,6 +280,32 @@ static int wil_cid_fill_sinfo(struct wil6210_priv *wil, int cid,
 		    le16_to_cpu(reply.evt.other_rx_sector),
 		    le16_to_cpu(reply.evt.other_tx_sector));
 
+	wil_link_stats_update(wil, cid, &reply.evt);
+
+	return 0;
+}
+
+static int wil_cid_fill_sinfo(struct wil6210_priv *wil, int cid,
+			      struct station_info *sinfo)
+{
+	struct wil_net_stats *stats = &wil->sta[cid].stats;
+	struct wil_link_stats *link = &wil->sta[cid].link;
+	ulong max_age = msecs_to_jiffies(sinfo_max_age_ms);
+	ulong updated = link->updated;
+	int rc;
+
+	if (!max_age || !updated || time_after(jiffies, updated + max_age)) {
+		rc = wil_link_query(wil, cid);
+		if (rc)
+			return rc;
+	} else if (time_after(jiffies, updated + max_age / 2) &&
+		   wil->sinfo_notify_cid < 0) {
+		/* periodic reports would be taken for the reply */
+		wil_link_refresh(wil, cid);
+	}
+	/* pairs with wil_link_stats_update() */
+	smp_rmb();
+
 	sinfo->generation = wil->sinfo_gen;
 
 	sinfo->filled = STATION_INFO_RX_BYTES |
@@ -164,7 +318,7 @@ static int wil_cid_fill_sinfo(struct wil6210_priv *wil, int cid,
 			STATION_INFO_TX_FAILED;
 
 	sinfo->txrate.flags = RATE_INFO_FLAGS_MCS | RATE_INFO_FLAGS_60G;
-	sinfo->txrate.mcs = le16_to_cpu(reply.evt.bf_mcs);
+	sinfo->txrate.mcs = link->bf_mcs;
 	sinfo->rxrate.flags = RATE_INFO_FLAGS_MCS | RATE_INFO_FLAGS_60G;
 	sinfo->rxrate.mcs = stats->last_mcs_rx;
 	sinfo->rx_bytes = stats->rx_bytes;
@@ -176,10 +330,10 @@ static int wil_cid_fill_sinfo(struct wil6210_priv *wil, int cid,
 
 	if (test_bit(wil_status_fwconnected, &wil->status)) {
 		sinfo->filled |= STATION_INFO_SIGNAL;
-		sinfo->signal = reply.evt.sqi;
+		sinfo->signal = link->sqi;
 	}
 
-	return rc;
+	return 0;
 }
 
 static int wil_cfg80211_get_station(struct wiphy *wiphy,
@@ -548,34 +702,45 @@ int wil_cfg80211_mgmt_tx(struct wiphy *wiphy,
 				bool dont_wait_for_ack, u64 *cookie)
 {
 	struct wil6210_priv *wil = wiphy_to_wil(wiphy);
-	int rc;
+	u64 tx_cookie;
 
 	if (offchan)
-		return wil_prepare_roc(wil, chan, buf, len, wait, cookie);
+		return wil_prepare_roc(wil, chan, buf, len, wait,
+				       dont_wait_for_ack, cookie);
 
-	/* Tx on operation channel - go send it */
-	rc = wmi_mgmt_tx(wil, buf, len);
-	cfg80211_mgmt_tx_status(wdev, cookie ? *cookie : 0, buf, len,
-				rc == 0, GFP_KERNEL);
+	/* debugfs Tx has no cookie */
+	if (!cookie)
+		cookie = &tx_cookie;
 
-	return rc;
+	*cookie = wil_cookie_alloc(wil);
+
+	/*
+	 * Tx on operation channel - go send it.
+	 * Status reported when FW done with it, unless not asked for
+	 */
+	return wmi_mgmt_tx(wil, buf, len, *cookie, dont_wait_for_ack);
 }
 static int wil_cfg80211_mgmt_tx_cancel_wait(struct wiphy *wiphy,
 					    struct wireless_dev *wdev,
 					    u64 cookie)
 {
 	struct wil6210_priv *wil = wiphy_to_wil(wiphy);
-	int rc = 0;
+	struct wil_roc *roc = &wil->roc;
+	bool match;
 
 	wil_info(wil, "%s()\n", __func__);
 
-	if (cookie != wil->roc.cookie)
-		wil_err(wil, "Cookie mismatch: active 0x%016llx vs. 0x%016llx\n",
-			wil->roc.cookie, cookie);
+	/* only offchannel Tx waits; Tx on own channel has nothing to cancel */
+	mutex_lock(&wil->mutex);
+	match = roc->mgmt_tx_cookie && cookie == roc->mgmt_tx_cookie;
+	mutex_unlock(&wil->mutex);
 
-	wil_cancel_roc(wil);
+	if (!match) {
+		wil_dbg_misc(wil, "No Tx wait for cookie 0x%016llx\n", cookie);
+		return -ENOENT;
+	}
 
-	return rc;
+	return wil_cancel_roc(wil);
 }
 
 static int wil_cfg80211_set_channel(struct wiphy *wiphy,
@@ -601,6 +766,9 @@ static int wil_cfg80211_add_key(struct wiphy *wiphy,
 	if (!pairwise)
 		return 0;
 
+	/* handshake frames queued so far go out under the old key */
+	flush_work(&wil->eapol_worker);
+
 	return wmi_add_cipher_key(wil, key_index, mac_addr,
 				  params->key_len, params->key);
 }
@@ -616,6 +784,9 @@ static int wil_cfg80211_del_key(struct wiphy *wiphy,
 	if (!pairwise)
 		return 0;
 
+	/* handshake frames queued so far go out under the old key */
+	flush_work(&wil->eapol_worker);
+
 	return wmi_del_cipher_key(wil, key_index, mac_addr);
 }
 
@@ -636,7 +807,7 @@ static int wil_remain_on_channel(struct wiphy *wiphy,
 {
 	struct wil6210_priv *wil = wiphy_to_wil(wiphy);
 
-	return wil_prepare_roc(wil, chan, NULL, 0, duration, cookie);
+	return wil_prepare_roc(wil, chan, NULL, 0, duration, false, cookie);
 }
 
 static int wil_cancel_remain_on_channel(struct wiphy *wiphy,
@@ -644,17 +815,21 @@ static int wil_cancel_remain_on_channel(struct wiphy *wiphy,
 					u64 cookie)
 {
 	struct wil6210_priv *wil = wiphy_to_wil(wiphy);
-	int rc = 0;
+	struct wil_roc *roc = &wil->roc;
+	bool match;
 
 	wil_info(wil, "%s()\n", __func__);
 
-	if (cookie != wil->roc.cookie)
-		wil_err(wil, "Cookie mismatch: active 0x%016llx vs. 0x%016llx\n",
-			wil->roc.cookie, cookie);
+	mutex_lock(&wil->mutex);
+	match = !roc->mgmt_tx_cookie && cookie == roc->cookie;
+	mutex_unlock(&wil->mutex);
 
-	wil_cancel_roc(wil);
+	if (!match) {
+		wil_dbg_misc(wil, "No ROC for cookie 0x%016llx\n", cookie);
+		return -ENOENT;
+	}
 
-	return rc;
+	return wil_cancel_roc(wil);
 }
 
 static void wil_print_bcon_data(struct cfg80211_beacon_data *b)
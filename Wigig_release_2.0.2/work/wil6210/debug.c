@@ -1,3 +1,6 @@
+#include <linux/seq_file.h>
+#include <linux/math64.h>
+
 #include "wil6210.h"
 #include "trace.h"
 
@@ -52,3 +55,54 @@ int wil_dbg_trace(struct wil6210_priv *wil, const char *fmt, ...)
 	return 0;
 }
 
+void wil_hist_add(struct wil_hist *h, u32 usec)
+{
+	int i = min_t(int, fls(usec), WIL_HIST_BUCKETS - 1);
+
+	h->bucket[i]++;
+	if (!h->count || usec < h->min)
+		h->min = usec;
+	if (usec > h->max)
+		h->max = usec;
+	h->count++;
+	h->sum += usec;
+}
+
+/* upper bound of the bucket @pct percent of samples fall within */
+static u32 wil_hist_percentile(struct wil_hist *h, uint pct)
+{
+	u64 want = div_u64((u64)h->count * pct + 99, 100);
+	u64 sum = 0;
+	int i;
+
+	for (i = 0; i < WIL_HIST_BUCKETS - 1; i++) {
+		sum += h->bucket[i];
+		if (sum >= want)
+			return min(1U << i, h->max);
+	}
+
+	return h->max;
+}
+
+void wil_hist_print(struct seq_file *s, struct wil_hist *h)
+{
+	int i;
+
+	if (!h->count) {
+		seq_printf(s, "  no samples\n");
+		return;
+	}
+
+	seq_printf(s, "  count %u min %u avg %llu p99 %u max %u usec\n",
+		   h->count, h->min, div_u64(h->sum, h->count),
+		   wil_hist_percentile(h, 99), h->max);
+	for (i = 0; i < WIL_HIST_BUCKETS; i++) {
+		if (!h->bucket[i])
+			continue;
+		if (i == WIL_HIST_BUCKETS - 1)
+			seq_printf(s, "  >= %6u : %u\n", 1U << (i - 1),
+				   h->bucket[i]);
+		else
+			seq_printf(s, "  < %7u : %u\n", 1U << i, h->bucket[i]);
+	}
+}
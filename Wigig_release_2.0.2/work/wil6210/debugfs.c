@@ -20,6 +20,7 @@
 #include <linux/pci.h>
 #include <linux/rtnetlink.h>
 #include <linux/power_supply.h>
+#include <linux/math64.h>
 
 #include "wil6210.h"
 #include "txrx.h"
@@ -97,10 +98,17 @@ static int wil_vring_debugfs_show(struct seq_file *s, void *data)
 				   txdata->agg_wsize, txdata->agg_timeout,
 				   used, avail, (int)((idle*100)/total));
 
+			if (txdata->cfg_pending)
+				seq_printf(s, "config in flight%s\n",
+					   txdata->cfg_orphan ?
+					   ", released" : "");
 			wil_print_vring(s, wil, name, vring, '_', 'H');
 		}
 	}
 
+	seq_printf(s, "\nTx vring pool: %u free, allocated on connect %u\n",
+		   wil->tx_vring_pool_n, wil->tx_vring_pool_miss);
+
 	return 0;
 }
 
@@ -209,6 +217,10 @@ static int wil_mbox_debugfs_show(struct seq_file *s, void *data)
 	wil_print_ring(s, "rx", wil->csr + HOST_MBOX +
 		       offsetof(struct wil6210_mbox_ctl, rx));
 
+	seq_printf(s, "event pool: %d x %d bytes, oversize %u empty %u\n",
+		   wil->wmi_ev_pool ? WIL_WMI_EV_POOL : 0, wil->wmi_ev_room,
+		   wil->wmi_ev_oversize, wil->wmi_ev_pool_empty);
+
 	return 0;
 }
 
@@ -950,6 +962,8 @@ static void wil_print_rxtid(struct seq_file *s, struct wil_tid_ampdu_rx *r)
 			seq_printf(s, "%c", r->reorder_buf[i] ? '*' : '_');
 	}
 	seq_printf(s, "] last drop 0x%03x\n", r->ssn_last_drop);
+	seq_printf(s, "     wsize %d timeout %d A-MSDU %d token %d\n",
+		   r->buf_size, r->timeout, r->amsdu, r->dialog_token);
 }
 
 static int wil_sta_debugfs_show(struct seq_file *s, void *data)
@@ -974,13 +988,25 @@ static int wil_sta_debugfs_show(struct seq_file *s, void *data)
 		seq_printf(s, "[%d] %pM %s\n", i, p->addr, status);
 
 		if (p->status == wil_sta_connected) {
+			seq_printf(s, "BAR received %lu, behind window %lu\n",
+				   p->stats.rx_bar, p->stats.rx_bar_old);
+			if (p->link.updated)
+				seq_printf(s, "Link MCS %d SQI %d%% age %d ms%s\n",
+					   p->link.bf_mcs, p->link.sqi,
+					   jiffies_to_msecs(jiffies -
+							    p->link.updated),
+					   wil->sinfo_notify_cid == i ?
+					   ", periodic" : "");
+			rcu_read_lock();
 			for (tid = 0; tid < WIL_STA_TID_NUM; tid++) {
-				struct wil_tid_ampdu_rx *r = p->tid_rx[tid];
+				struct wil_tid_ampdu_rx *r =
+					rcu_dereference(p->tid_rx[tid]);
 				if (r) {
 					seq_printf(s, "[%2d] ", tid);
 					wil_print_rxtid(s, r);
 				}
 			}
+			rcu_read_unlock();
 		}
 	}
 
@@ -999,6 +1025,473 @@ static const struct file_operations fops_sta = {
 	.llseek		= seq_lseek,
 };
 
+/*---------Rx BACK policy------------*/
+static int wil_back_policy_debugfs_show(struct seq_file *s, void *data)
+{
+	struct wil6210_priv *wil = s->private;
+	int tid, used, budget;
+
+	seq_printf(s, "TID wsize timeout A-MSDU\n");
+	for (tid = 0; tid < WIL_STA_TID_NUM; tid++) {
+		struct wil_back_policy *p = &wil->back_policy[tid];
+
+		seq_printf(s, "[%2d] %5d %7d %6d\n", tid, p->agg_wsize,
+			   p->agg_timeout, p->agg_amsdu);
+	}
+
+	budget = wil_reorder_budget(&used);
+	seq_printf(s, "reorder slots used %d budget %d\n", used, budget);
+
+	return 0;
+}
+
+static int wil_back_policy_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wil_back_policy_debugfs_show,
+			   inode->i_private);
+}
+
+/*
+ * Write "<tid> <wsize> <timeout> <amsdu>" to set policy for the TID,
+ * use tid -1 to set policy for all TIDs
+ */
+static ssize_t wil_write_back_policy(struct file *file,
+				     const char __user *buf,
+				     size_t len, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct wil6210_priv *wil = s->private;
+	int rc, i, tid, wsize, timeout, amsdu;
+	char kbuf[64];
+
+	if (len >= sizeof(kbuf))
+		return -EINVAL;
+	if (copy_from_user(kbuf, buf, len))
+		return -EIO;
+
+	kbuf[len] = '\0';
+	rc = sscanf(kbuf, "%d %d %d %d", &tid, &wsize, &timeout, &amsdu);
+	if (rc != 4)
+		return -EINVAL;
+
+	if (tid >= WIL_STA_TID_NUM || tid < -1 ||
+	    wsize < 0 || wsize > WIL_MAX_AGG_WSIZE ||
+	    timeout < 0 || timeout > 0xffff)
+		return -EINVAL;
+
+	for (i = 0; i < WIL_STA_TID_NUM; i++) {
+		struct wil_back_policy *p = &wil->back_policy[i];
+
+		if (tid >= 0 && tid != i)
+			continue;
+		p->agg_wsize = wsize;
+		p->agg_timeout = timeout;
+		p->agg_amsdu = !!amsdu;
+	}
+
+	return len;
+}
+
+static const struct file_operations fops_back_policy = {
+	.open		= wil_back_policy_seq_open,
+	.release	= single_release,
+	.read		= seq_read,
+	.write		= wil_write_back_policy,
+	.llseek		= seq_lseek,
+};
+
+/*---------Rx BACK setup latency------------*/
+static int wil_back_lat_debugfs_show(struct seq_file *s, void *data)
+{
+	struct wil6210_priv *wil = s->private;
+
+	seq_printf(s, "ADDBA request -> response queued:\n");
+	wil_hist_print(s, &wil->back_lat_queued);
+	seq_printf(s, "ADDBA request -> response sent:\n");
+	wil_hist_print(s, &wil->back_lat_sent);
+
+	return 0;
+}
+
+static int wil_back_lat_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wil_back_lat_debugfs_show, inode->i_private);
+}
+
+/* write anything to reset */
+static ssize_t wil_write_back_lat(struct file *file, const char __user *buf,
+				  size_t len, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct wil6210_priv *wil = s->private;
+
+	memset(&wil->back_lat_queued, 0, sizeof(wil->back_lat_queued));
+	memset(&wil->back_lat_sent, 0, sizeof(wil->back_lat_sent));
+
+	return len;
+}
+
+static const struct file_operations fops_back_lat = {
+	.open		= wil_back_lat_seq_open,
+	.release	= single_release,
+	.read		= seq_read,
+	.write		= wil_write_back_lat,
+	.llseek		= seq_lseek,
+};
+
+/*---------WMI mailbox flow control------------*/
+static int wil_mbox_wait_debugfs_show(struct seq_file *s, void *data)
+{
+	struct wil6210_priv *wil = s->private;
+
+	seq_printf(s, "Tx mailbox head busy:\n");
+	wil_hist_print(s, &wil->wmi_wait_head);
+	seq_printf(s, "Tx mailbox ring full:\n");
+	wil_hist_print(s, &wil->wmi_wait_full);
+
+	return 0;
+}
+
+static int wil_mbox_wait_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wil_mbox_wait_debugfs_show, inode->i_private);
+}
+
+/* write anything to reset */
+static ssize_t wil_write_mbox_wait(struct file *file, const char __user *buf,
+				   size_t len, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct wil6210_priv *wil = s->private;
+
+	mutex_lock(&wil->wmi_mutex);
+	memset(&wil->wmi_wait_head, 0, sizeof(wil->wmi_wait_head));
+	memset(&wil->wmi_wait_full, 0, sizeof(wil->wmi_wait_full));
+	mutex_unlock(&wil->wmi_mutex);
+
+	return len;
+}
+
+static const struct file_operations fops_mbox_wait = {
+	.open		= wil_mbox_wait_seq_open,
+	.release	= single_release,
+	.read		= seq_read,
+	.write		= wil_write_mbox_wait,
+	.llseek		= seq_lseek,
+};
+
+/*---------WMI event statistics------------*/
+static int wil_wmi_evt_debugfs_show(struct seq_file *s, void *data)
+{
+	struct wil6210_priv *wil = s->private;
+	struct wil_wmi_evt_stat *st;
+	const char *name;
+	u16 id;
+	uint i;
+
+	seq_printf(s, "%-28s %6s %8s %8s %10s %8s %8s\n", "event", "id",
+		   "count", "replies", "total us", "avg ns", "max ns");
+	for (i = 0; i < WIL_WMI_EVT_SLOTS; i++) {
+		name = wmi_evt_name(i, &id);
+		st = &wil->wmi_evt_stats[i];
+		if (!name || !st->count)
+			continue;
+		seq_printf(s, "%-28s 0x%04x %8u %8u %10llu %8llu %8u\n",
+			   name, id, st->count, st->replies,
+			   div_u64(st->time_ns, 1000),
+			   div_u64(st->time_ns, st->count), st->max_ns);
+	}
+	seq_printf(s, "unknown events: %u\n", wil->wmi_evt_unknown);
+
+	return 0;
+}
+
+static int wil_wmi_evt_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wil_wmi_evt_debugfs_show, inode->i_private);
+}
+
+/* write anything to reset */
+static ssize_t wil_write_wmi_evt(struct file *file, const char __user *buf,
+				 size_t len, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct wil6210_priv *wil = s->private;
+
+	memset(wil->wmi_evt_stats, 0, sizeof(wil->wmi_evt_stats));
+	wil->wmi_evt_unknown = 0;
+
+	return len;
+}
+
+static const struct file_operations fops_wmi_evt = {
+	.open		= wil_wmi_evt_seq_open,
+	.release	= single_release,
+	.read		= seq_read,
+	.write		= wil_write_wmi_evt,
+	.llseek		= seq_lseek,
+};
+
+/*---------WMI call latency------------*/
+static int wil_wmi_lat_debugfs_show(struct seq_file *s, void *data)
+{
+	struct wil6210_priv *wil = s->private;
+	struct wil_wmi_cmd_stat *st;
+	int i;
+
+	spin_lock(&wil->wmi_cmd_stat_lock);
+	for (i = 0; i < WIL_WMI_CMD_STATS; i++) {
+		st = &wil->wmi_cmd_stats[i];
+		if (!st->cmdid)
+			continue;
+		seq_printf(s, "0x%04x -> 0x%04x: timeouts %u errors %u\n",
+			   st->cmdid, st->reply_id, st->timeouts, st->errors);
+		wil_hist_print(s, &st->lat);
+	}
+	if (wil->wmi_cmd_stats_lost)
+		seq_printf(s, "not accounted: %u\n", wil->wmi_cmd_stats_lost);
+	spin_unlock(&wil->wmi_cmd_stat_lock);
+
+	return 0;
+}
+
+static int wil_wmi_lat_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wil_wmi_lat_debugfs_show, inode->i_private);
+}
+
+/* write anything to reset */
+static ssize_t wil_write_wmi_lat(struct file *file, const char __user *buf,
+				 size_t len, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct wil6210_priv *wil = s->private;
+
+	spin_lock(&wil->wmi_cmd_stat_lock);
+	memset(wil->wmi_cmd_stats, 0, sizeof(wil->wmi_cmd_stats));
+	wil->wmi_cmd_stats_lost = 0;
+	spin_unlock(&wil->wmi_cmd_stat_lock);
+
+	return len;
+}
+
+static const struct file_operations fops_wmi_lat = {
+	.open		= wil_wmi_lat_seq_open,
+	.release	= single_release,
+	.read		= seq_read,
+	.write		= wil_write_wmi_lat,
+	.llseek		= seq_lseek,
+};
+
+/*---------WMI calls in flight------------*/
+static int wil_wmi_calls_debugfs_show(struct seq_file *s, void *data)
+{
+	struct wil6210_priv *wil = s->private;
+	struct wil_wmi_call *call;
+	ulong now = jiffies;
+
+	seq_printf(s, "in flight %u max %u limit %d timeouts %u late %u\n",
+		   wil->wmi_calls_inflight, wil->wmi_calls_inflight_max,
+		   WIL_WMI_CALLS_MAX, wil->wmi_calls_timeout,
+		   wil->wmi_calls_stale);
+
+	spin_lock(&wil->wmi_call_lock);
+	list_for_each_entry(call, &wil->wmi_calls, list) {
+		seq_printf(s, "  0x%04x -> 0x%04x %s age %d msec of %d\n",
+			   call->cmdid, call->reply_id,
+			   call->stale ? "stale" : call->cb ? "async" : "sync",
+			   jiffies_to_msecs(now - call->start),
+			   jiffies_to_msecs(call->deadline - call->start));
+	}
+	spin_unlock(&wil->wmi_call_lock);
+
+	return 0;
+}
+
+static int wil_wmi_calls_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wil_wmi_calls_debugfs_show, inode->i_private);
+}
+
+static const struct file_operations fops_wmi_calls = {
+	.open		= wil_wmi_calls_seq_open,
+	.release	= single_release,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+};
+
+/*---------adaptive ITR------------*/
+static int wil_itr_debugfs_show(struct seq_file *s, void *data)
+{
+	struct wil6210_priv *wil = s->private;
+	struct wil_itr *itr = &wil->itr;
+	static const char * const level[] = {
+		[wil_itr_lowest_latency] = "lowest latency",
+		[wil_itr_low_latency] = "low latency",
+		[wil_itr_bulk] = "bulk",
+	};
+	u32 n = itr->n_decisions;
+	u32 i;
+
+	seq_printf(s, "adaptive %s, threshold %d (%s), %d decisions\n",
+		   itr->adaptive ? "on" : "off", itr->trsh,
+		   level[itr->level], n);
+	if (!n)
+		return 0;
+
+	seq_printf(s, "   age[ms]  IRQs    pkts     bytes  threshold\n");
+	/* newest first */
+	for (i = 0; i < min_t(u32, n, WIL_ITR_HISTORY); i++) {
+		struct wil_itr_decision *d =
+			&itr->history[(n - 1 - i) % WIL_ITR_HISTORY];
+
+		seq_printf(s, "%10d %5d %7d %9d %6d %s\n",
+			   jiffies_to_msecs(jiffies - d->jiffies), d->irqs,
+			   d->pkts, d->bytes, d->trsh, level[d->level]);
+	}
+
+	return 0;
+}
+
+static int wil_itr_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wil_itr_debugfs_show, inode->i_private);
+}
+
+static const struct file_operations fops_itr = {
+	.open		= wil_itr_seq_open,
+	.release	= single_release,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+};
+
+/*---------IRQ vectors------------*/
+static int wil_irq_vec_debugfs_show(struct seq_file *s, void *data)
+{
+	struct wil6210_priv *wil = s->private;
+	struct wil_irq_mmio *mmio = &wil->irq_mmio;
+	static const char * const name[] = {
+		[wil_irq_tx] = "Tx",
+		[wil_irq_rx] = "Rx",
+		[wil_irq_misc] = "Misc",
+	};
+	u64 n = 0, reads, writes;
+	int i;
+
+	seq_printf(s, "MSI vectors: %d\n", wil->n_msi);
+	if (wil->n_msi != 3)
+		seq_printf(s, "shared IRQ %d: %d interrupts, %d spurious\n",
+			   wil->pdev->irq, wil->irq_shared_count,
+			   wil->irq_shared_spurious);
+
+	for (i = 0; i < wil_irq_vecs; i++) {
+		struct wil_irq_vec *v = &wil->irq_vec[i];
+		struct wil_irq_storm_vec *sv = &wil->irq_storm.vec[i];
+
+		seq_printf(s, "%-4s", name[i]);
+		if (v->irq)
+			seq_printf(s, " IRQ %d", v->irq);
+		if (v->cpu >= 0)
+			seq_printf(s, " hint CPU %d", v->cpu);
+		seq_printf(s, " count %d last CPU %d spurious %d"
+			   " unhandled %d\n", v->count, v->last_cpu,
+			   v->spurious, v->unhandled);
+		seq_printf(s, "     storm: %s, %d detected, last rate %d"
+			   " IRQs/sec\n",
+			   test_bit(i, &wil->irq_storm.active) ?
+			   "throttled" : "no", sv->storms, sv->last_rate);
+		n += v->count;
+	}
+
+	if (wil->n_msi != 3)
+		n = wil->irq_shared_count;
+	reads = atomic64_read(&mmio->reads);
+	writes = atomic64_read(&mmio->writes);
+	seq_printf(s, "MMIO: %llu reads, %llu writes, %llu writes skipped\n",
+		   reads, writes, (u64)atomic64_read(&mmio->skipped));
+	if (n) {
+		u64 r = div64_u64(reads * 100, n);
+		u64 w = div64_u64(writes * 100, n);
+		u32 r_frac = do_div(r, 100);
+		u32 w_frac = do_div(w, 100);
+
+		seq_printf(s, "per IRQ: %llu.%02d reads, %llu.%02d writes\n",
+			   r, r_frac, w, w_frac);
+	}
+
+	return 0;
+}
+
+static int wil_irq_vec_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wil_irq_vec_debugfs_show, inode->i_private);
+}
+
+/* write anything to reset counters */
+static ssize_t wil_write_irq_vec(struct file *file, const char __user *buf,
+				 size_t len, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct wil6210_priv *wil = s->private;
+	int i;
+
+	for (i = 0; i < wil_irq_vecs; i++) {
+		wil->irq_vec[i].count = 0;
+		wil->irq_vec[i].spurious = 0;
+		wil->irq_vec[i].unhandled = 0;
+		wil->irq_storm.vec[i].storms = 0;
+	}
+	wil->irq_shared_count = 0;
+	wil->irq_shared_spurious = 0;
+	atomic64_set(&wil->irq_mmio.reads, 0);
+	atomic64_set(&wil->irq_mmio.writes, 0);
+	atomic64_set(&wil->irq_mmio.skipped, 0);
+
+	return len;
+}
+
+static const struct file_operations fops_irq_vec = {
+	.open		= wil_irq_vec_seq_open,
+	.release	= single_release,
+	.read		= seq_read,
+	.write		= wil_write_irq_vec,
+	.llseek		= seq_lseek,
+};
+
+static void wil6210_debugfs_create_busy_poll(struct wil6210_priv *wil,
+					     struct dentry *parent)
+{
+	struct dentry *d = debugfs_create_dir("busy_poll", parent);
+	struct wil_busy_poll_stats *st = &wil->bp_stats;
+
+	if (IS_ERR_OR_NULL(d))
+		return;
+
+	debugfs_create_u32("hits", S_IRUGO | S_IWUSR, d, &st->hits);
+	debugfs_create_u32("misses", S_IRUGO | S_IWUSR, d, &st->misses);
+	debugfs_create_u32("poll_yield", S_IRUGO | S_IWUSR, d,
+			   &st->poll_yield);
+	debugfs_create_u32("napi_yield", S_IRUGO | S_IWUSR, d,
+			   &st->napi_yield);
+}
+
+static void wil6210_debugfs_create_tx_coalesce(struct wil6210_priv *wil,
+					       struct dentry *parent)
+{
+	struct dentry *d = debugfs_create_dir("tx_coalesce", parent);
+	struct wil_tx_coalesce_stats *st = &wil->tx_coal_stats;
+
+	if (IS_ERR_OR_NULL(d))
+		return;
+
+	debugfs_create_u32("irq_req", S_IRUGO | S_IWUSR, d, &st->irq_req);
+	debugfs_create_u32("irq_skip", S_IRUGO | S_IWUSR, d, &st->irq_skip);
+	debugfs_create_u32("timer_reap", S_IRUGO | S_IWUSR, d,
+			   &st->timer_reap);
+	debugfs_create_u32("xmit_reap", S_IRUGO | S_IWUSR, d,
+			   &st->xmit_reap);
+}
+
 /*----------------*/
 int wil6210_debugfs_init(struct wil6210_priv *wil)
 {
@@ -1036,6 +1529,11 @@ int wil6210_debugfs_init(struct wil6210_priv *wil)
 				   HOSTADDR(RGF_DMA_EP_MISC_ICR));
 	wil6210_debugfs_create_pseudo_ISR(wil, dbg);
 	wil6210_debugfs_create_ITR_CNT(wil, dbg);
+	debugfs_create_file("itr", S_IRUGO, dbg, wil, &fops_itr);
+	debugfs_create_file("irq_vectors", S_IRUGO | S_IWUSR, dbg, wil,
+			    &fops_irq_vec);
+	wil6210_debugfs_create_busy_poll(wil, dbg);
+	wil6210_debugfs_create_tx_coalesce(wil, dbg);
 
 	debugfs_create_u32("mem_addr", S_IRUGO | S_IWUSR, dbg, &mem_addr);
 	debugfs_create_file("mem_val", S_IRUGO | S_IWUSR, dbg, wil,
@@ -1045,9 +1543,20 @@ int wil6210_debugfs_init(struct wil6210_priv *wil)
 	debugfs_create_file("rxon", S_IWUSR, dbg, wil, &fops_rxon);
 	debugfs_create_file("tx_mgmt", S_IWUSR, dbg, wil, &fops_txmgmt);
 	debugfs_create_file("wmi_send", S_IWUSR, dbg, wil, &fops_wmi);
+	debugfs_create_file("wmi_calls", S_IRUGO, dbg, wil, &fops_wmi_calls);
+	debugfs_create_file("wmi_events", S_IRUGO | S_IWUSR, dbg, wil,
+			    &fops_wmi_evt);
+	debugfs_create_file("wmi_latency", S_IRUGO | S_IWUSR, dbg, wil,
+			    &fops_wmi_lat);
+	debugfs_create_file("mbox_wait", S_IRUGO | S_IWUSR, dbg, wil,
+			    &fops_mbox_wait);
 	debugfs_create_file("temp", S_IRUGO, dbg, wil, &fops_temp);
 	debugfs_create_file("info", S_IRUGO, dbg, wil, &fops_info);
 	debugfs_create_file("addba", S_IWUSR, dbg, wil, &fops_addba);
+	debugfs_create_file("back_policy", S_IRUGO | S_IWUSR, dbg, wil,
+			    &fops_back_policy);
+	debugfs_create_file("back_latency", S_IRUGO | S_IWUSR, dbg, wil,
+			    &fops_back_lat);
 	debugfs_create_u8("tid", S_IRUGO | S_IWUSR, dbg, &wil->tid_to_use);
 
 	wil->rgf_blob.data = (void * __force)wil->csr + 0;
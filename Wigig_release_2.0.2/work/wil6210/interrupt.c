@@ -15,10 +15,57 @@
  */
 
 #include <linux/interrupt.h>
+#include <linux/moduleparam.h>
 
 #include "wil6210.h"
 #include "trace.h"
 
+static bool itr_adaptive = true;
+module_param(itr_adaptive, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(itr_adaptive, " adapt Rx interrupt moderation to traffic,"
+		 " applied on interface up");
+
+static uint itr_min = 300;
+module_param(itr_min, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(itr_min, " adaptive ITR threshold for low rate traffic,"
+		 " 0 - no moderation");
+
+static uint itr_max = 30000;
+module_param(itr_max, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(itr_max, " adaptive ITR threshold for bulk traffic");
+
+static int irq_cpu_rx = -1;
+module_param(irq_cpu_rx, int, S_IRUGO);
+MODULE_PARM_DESC(irq_cpu_rx, " CPU for Rx IRQ in 3 MSI mode,"
+		 " -1 (default) - auto, from device's NUMA node");
+
+static int irq_cpu_tx = -1;
+module_param(irq_cpu_tx, int, S_IRUGO);
+MODULE_PARM_DESC(irq_cpu_tx, " CPU for Tx IRQ in 3 MSI mode,"
+		 " -1 (default) - auto");
+
+static int irq_cpu_misc = -1;
+module_param(irq_cpu_misc, int, S_IRUGO);
+MODULE_PARM_DESC(irq_cpu_misc, " CPU for WMI/misc IRQ in 3 MSI mode,"
+		 " -1 (default) - auto");
+
+static uint irq_storm_rate = 200000;
+module_param(irq_storm_rate, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(irq_storm_rate, " IRQs/sec on a vector considered a storm,"
+		 " spurious ones count 10 times; 0 - no storm detection");
+
+static uint irq_storm_hold_ms = 1000;
+module_param(irq_storm_hold_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(irq_storm_hold_ms, " throttle storming vector this long"
+		 " once storm detected");
+
+static uint irq_storm_poll_usec = 500;
+module_param(irq_storm_poll_usec, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(irq_storm_poll_usec, " Rx/Tx polling period during storm,"
+		 " also Misc IRQ allowed once per this period");
+
+#define WIL_IRQ_STORM_WINDOW_MS	(100)
+
 /**
  * Theory of operation:
  *
@@ -47,82 +94,147 @@
 					BIT_DMA_PSEUDO_CAUSE_TX | \
 					BIT_DMA_PSEUDO_CAUSE_MISC))
 
+/*
+ * MMIO on the interrupt path, accounted in wil->irq_mmio
+ */
+static inline u32 wil_irq_ioread32(struct wil6210_priv *wil, u32 off)
+{
+	atomic64_inc(&wil->irq_mmio.reads);
+	return ioread32(wil->csr + off);
+}
+
+static inline void wil_irq_iowrite32(struct wil6210_priv *wil, u32 x, u32 off)
+{
+	atomic64_inc(&wil->irq_mmio.writes);
+	iowrite32(x, wil->csr + off);
+}
+
 #if defined(CONFIG_WIL6210_ISR_COR)
 /* configure to Clear-On-Read mode */
 #define WIL_ICR_ICC_VALUE	(0xFFFFFFFFUL)
 
-static inline void wil_icr_clear(u32 x, void __iomem *addr)
+static inline void wil_icr_clear(struct wil6210_priv *wil, u32 x, u32 off)
 {
 }
 #else /* defined(CONFIG_WIL6210_ISR_COR) */
 /* configure to Write-1-to-Clear mode */
 #define WIL_ICR_ICC_VALUE	(0UL)
 
-static inline void wil_icr_clear(u32 x, void __iomem *addr)
+static inline void wil_icr_clear(struct wil6210_priv *wil, u32 x, u32 off)
 {
-	iowrite32(x, addr);
+	wil_irq_iowrite32(wil, x, off);
 }
 #endif /* defined(CONFIG_WIL6210_ISR_COR) */
 
-static inline u32 wil_ioread32_and_clear(void __iomem *addr)
+static inline u32 wil_ioread32_and_clear(struct wil6210_priv *wil, u32 off)
 {
-	u32 x = ioread32(addr);
+	u32 x = wil_irq_ioread32(wil, off);
 
-	wil_icr_clear(x, addr);
+	wil_icr_clear(wil, x, off);
 
 	return x;
 }
 
+/*
+ * Mask state is shadowed in wil->irq_masked, bit per wil_irq_* vector
+ * plus WIL_IRQ_PSEUDO; write to the hardware only when state changes.
+ * Mask and unmask of the same register are serialized by the callers:
+ * unmask is done only by whoever owns the masked source
+ * (NAPI or the threaded handler)
+ */
+#define WIL_IRQ_PSEUDO	(wil_irq_vecs)
+
+static void wil6210_irq_set_mask(struct wil6210_priv *wil, int bit,
+				 u32 x, u32 off)
+{
+	if (test_and_set_bit(bit, &wil->irq_masked)) {
+		atomic64_inc(&wil->irq_mmio.skipped);
+		return;
+	}
+	wil_irq_iowrite32(wil, x, off);
+}
+
+static void wil6210_irq_clear_mask(struct wil6210_priv *wil, int bit,
+				   u32 x, u32 off)
+{
+	if (!test_and_clear_bit(bit, &wil->irq_masked)) {
+		atomic64_inc(&wil->irq_mmio.skipped);
+		return;
+	}
+	wil_irq_iowrite32(wil, x, off);
+}
+
 static void wil6210_mask_irq_tx(struct wil6210_priv *wil)
 {
-	iowrite32(WIL6210_IRQ_DISABLE, wil->csr +
-		  HOSTADDR(RGF_DMA_EP_TX_ICR) +
-		  offsetof(struct RGF_ICR, IMS));
+	wil6210_irq_set_mask(wil, wil_irq_tx, WIL6210_IRQ_DISABLE,
+			     HOSTADDR(RGF_DMA_EP_TX_ICR) +
+			     offsetof(struct RGF_ICR, IMS));
 }
 
 static void wil6210_mask_irq_rx(struct wil6210_priv *wil)
 {
-	iowrite32(WIL6210_IRQ_DISABLE, wil->csr +
-		  HOSTADDR(RGF_DMA_EP_RX_ICR) +
-		  offsetof(struct RGF_ICR, IMS));
+	wil6210_irq_set_mask(wil, wil_irq_rx, WIL6210_IRQ_DISABLE,
+			     HOSTADDR(RGF_DMA_EP_RX_ICR) +
+			     offsetof(struct RGF_ICR, IMS));
 }
 
 static void wil6210_mask_irq_misc(struct wil6210_priv *wil)
 {
-	iowrite32(WIL6210_IRQ_DISABLE, wil->csr +
-		  HOSTADDR(RGF_DMA_EP_MISC_ICR) +
-		  offsetof(struct RGF_ICR, IMS));
+	wil6210_irq_set_mask(wil, wil_irq_misc, WIL6210_IRQ_DISABLE,
+			     HOSTADDR(RGF_DMA_EP_MISC_ICR) +
+			     offsetof(struct RGF_ICR, IMS));
 }
 
 static void wil6210_mask_irq_pseudo(struct wil6210_priv *wil)
 {
 	wil_dbg_irq(wil, "%s()\n", __func__);
 
-	iowrite32(WIL6210_IRQ_DISABLE, wil->csr +
-		  HOSTADDR(RGF_DMA_PSEUDO_CAUSE_MASK_SW));
+	wil6210_irq_set_mask(wil, WIL_IRQ_PSEUDO, WIL6210_IRQ_DISABLE,
+			     HOSTADDR(RGF_DMA_PSEUDO_CAUSE_MASK_SW));
 
 	clear_bit(wil_status_irqen, &wil->status);
 }
 
 void wil6210_unmask_irq_tx(struct wil6210_priv *wil)
 {
-	iowrite32(WIL6210_IMC_TX, wil->csr +
-		  HOSTADDR(RGF_DMA_EP_TX_ICR) +
-		  offsetof(struct RGF_ICR, IMC));
+	/* polled by storm timer, stay masked */
+	if (test_bit(wil_irq_tx, &wil->irq_storm.active))
+		return;
+	wil6210_irq_clear_mask(wil, wil_irq_tx, WIL6210_IMC_TX,
+			       HOSTADDR(RGF_DMA_EP_TX_ICR) +
+			       offsetof(struct RGF_ICR, IMC));
 }
 
 void wil6210_unmask_irq_rx(struct wil6210_priv *wil)
 {
-	iowrite32(WIL6210_IMC_RX, wil->csr +
-		  HOSTADDR(RGF_DMA_EP_RX_ICR) +
-		  offsetof(struct RGF_ICR, IMC));
+	if (test_bit(wil_irq_rx, &wil->irq_storm.active))
+		return;
+	wil6210_irq_clear_mask(wil, wil_irq_rx, WIL6210_IMC_RX,
+			       HOSTADDR(RGF_DMA_EP_RX_ICR) +
+			       offsetof(struct RGF_ICR, IMC));
+}
+
+static void __wil6210_unmask_irq_misc(struct wil6210_priv *wil)
+{
+	wil6210_irq_clear_mask(wil, wil_irq_misc, WIL6210_IMC_MISC,
+			       HOSTADDR(RGF_DMA_EP_MISC_ICR) +
+			       offsetof(struct RGF_ICR, IMC));
 }
 
 static void wil6210_unmask_irq_misc(struct wil6210_priv *wil)
 {
-	iowrite32(WIL6210_IMC_MISC, wil->csr +
-		  HOSTADDR(RGF_DMA_EP_MISC_ICR) +
-		  offsetof(struct RGF_ICR, IMC));
+	struct wil_irq_storm *st = &wil->irq_storm;
+
+	/* throttled: hand unmask over to the storm timer */
+	if (test_bit(wil_irq_misc, &st->active)) {
+		set_bit(0, &st->misc_unmask);
+		smp_mb();
+		/* storm may be over meanwhile; whoever clears the bit unmasks */
+		if (test_bit(wil_irq_misc, &st->active) ||
+		    !test_and_clear_bit(0, &st->misc_unmask))
+			return;
+	}
+	__wil6210_unmask_irq_misc(wil);
 }
 
 static void wil6210_unmask_irq_pseudo(struct wil6210_priv *wil)
@@ -131,20 +243,169 @@ static void wil6210_unmask_irq_pseudo(struct wil6210_priv *wil)
 
 	set_bit(wil_status_irqen, &wil->status);
 
-	iowrite32(WIL6210_IRQ_PSEUDO_MASK, wil->csr +
-		  HOSTADDR(RGF_DMA_PSEUDO_CAUSE_MASK_SW));
+	wil6210_irq_clear_mask(wil, WIL_IRQ_PSEUDO, WIL6210_IRQ_PSEUDO_MASK,
+			       HOSTADDR(RGF_DMA_PSEUDO_CAUSE_MASK_SW));
 }
 
 void wil6210_disable_irq(struct wil6210_priv *wil)
 {
 	wil_dbg_irq(wil, "%s()\n", __func__);
 
+	/* don't trust shadow here, write all */
+	wil->irq_masked = 0;
+
 	wil6210_mask_irq_tx(wil);
 	wil6210_mask_irq_rx(wil);
 	wil6210_mask_irq_misc(wil);
 	wil6210_mask_irq_pseudo(wil);
 }
 
+static void wil6210_itr_set(struct wil6210_priv *wil, u32 trsh)
+{
+	wil->itr.trsh = trsh;
+	if (trsh) {
+		iowrite32(trsh, wil->csr + HOSTADDR(RGF_DMA_ITR_CNT_TRSH));
+		iowrite32(BIT_DMA_ITR_CNT_CRL_EN,
+			  wil->csr + HOSTADDR(RGF_DMA_ITR_CNT_CRL));
+	} else {
+		iowrite32(0, wil->csr + HOSTADDR(RGF_DMA_ITR_CNT_CRL));
+	}
+}
+
+static void wil6210_itr_init(struct wil6210_priv *wil)
+{
+	struct wil_itr *itr = &wil->itr;
+	struct net_device *ndev = wil_to_ndev(wil);
+
+	memset(itr, 0, sizeof(*itr));
+	itr->level = wil_itr_low_latency;
+	itr->last = jiffies;
+	itr->rx_packets = ndev->stats.rx_packets;
+	itr->rx_bytes = ndev->stats.rx_bytes;
+
+	/* interrupt moderation parameters */
+	if (wil->wdev->iftype == NL80211_IFTYPE_MONITOR) {
+		/* disable interrupt moderation for monitor
+		 * to get better timestamp precision
+		 */
+		wil6210_itr_set(wil, 0);
+		return;
+	}
+
+	itr->adaptive = itr_adaptive;
+	wil6210_itr_set(wil, WIL6210_ITR_TRSH);
+}
+
+static u32 wil6210_itr_trsh(enum wil_itr_level level)
+{
+	u32 lo = min(itr_min, itr_max);
+	u32 hi = max(itr_min, itr_max);
+
+	switch (level) {
+	case wil_itr_lowest_latency:
+		return lo;
+	case wil_itr_bulk:
+		return hi;
+	default:
+		return clamp_t(u32, WIL6210_ITR_TRSH, lo, hi);
+	}
+}
+
+/*
+ * IRQ storm on Rx or Tx: go to the bulk threshold right away.
+ * Adaptive moderation walks it back one level per interval as traffic
+ * allows; fixed one is restored by the next wil6210_enable_irq()
+ */
+static void wil6210_itr_storm(struct wil6210_priv *wil)
+{
+	struct wil_itr *itr = &wil->itr;
+	u32 trsh = wil6210_itr_trsh(wil_itr_bulk);
+
+	/* no moderation (monitor), or already there */
+	if (!itr->trsh || trsh <= itr->trsh)
+		return;
+
+	wil_dbg_irq(wil, "ITR %d -> %d on IRQ storm\n", itr->trsh, trsh);
+	itr->level = wil_itr_bulk;
+	wil6210_itr_set(wil, trsh);
+}
+
+/**
+ * Adaptive interrupt moderation
+ *
+ * Called on NAPI Rx completion, with Rx IRQ still masked.
+ * Once per interval, classify traffic by packets and bytes per
+ * Rx interrupt, and move ITR threshold one level towards the
+ * class: small threshold for sparse traffic gives low latency,
+ * large one for bulk traffic keeps interrupt rate low.
+ * Moving one level per interval provides hysteresis.
+ */
+void wil6210_itr_update(struct wil6210_priv *wil)
+{
+	struct wil_itr *itr = &wil->itr;
+	struct net_device *ndev = wil_to_ndev(wil);
+	struct wil_itr_decision *d;
+	enum wil_itr_level level = itr->level;
+	u32 irqs, pkts, bytes, ppi, bpi, trsh;
+
+	if (test_and_clear_bit(0, &wil->irq_storm.itr_bump))
+		wil6210_itr_storm(wil);
+
+	if (!itr->adaptive)
+		return;
+	if (time_before(jiffies, itr->last + msecs_to_jiffies(10)))
+		return;
+	irqs = atomic_read(&itr->irqs);
+	if (!irqs)
+		return;
+
+	pkts = ndev->stats.rx_packets - itr->rx_packets;
+	bytes = ndev->stats.rx_bytes - itr->rx_bytes;
+	ppi = pkts / irqs;
+	bpi = bytes / irqs;
+
+	switch (itr->level) {
+	case wil_itr_lowest_latency:
+		if (bpi > 8000 || ppi > 4)
+			level = wil_itr_low_latency;
+		break;
+	case wil_itr_low_latency:
+		if (bpi > 32000 || ppi > 16)
+			level = wil_itr_bulk;
+		else if (bpi < 2000 && ppi <= 2)
+			level = wil_itr_lowest_latency;
+		break;
+	case wil_itr_bulk:
+		if (bpi < 16000 && ppi <= 8)
+			level = wil_itr_low_latency;
+		break;
+	}
+
+	trsh = wil6210_itr_trsh(level);
+
+	d = &itr->history[itr->n_decisions % WIL_ITR_HISTORY];
+	d->jiffies = jiffies;
+	d->irqs = irqs;
+	d->pkts = pkts;
+	d->bytes = bytes;
+	d->level = level;
+	d->trsh = trsh;
+	itr->n_decisions++;
+
+	itr->level = level;
+	/* keep IRQs counted meanwhile for the next interval */
+	atomic_sub(irqs, &itr->irqs);
+	itr->last = jiffies;
+	itr->rx_packets = ndev->stats.rx_packets;
+	itr->rx_bytes = ndev->stats.rx_bytes;
+
+	if (trsh != itr->trsh) {
+		wil_dbg_irq(wil, "ITR %d -> %d, %d IRQs %d pkts %d bytes\n",
+			    itr->trsh, trsh, d->irqs, pkts, bytes);
+		wil6210_itr_set(wil, trsh);
+	}
+}
+
 void wil6210_enable_irq(struct wil6210_priv *wil)
 {
 	wil_dbg_irq(wil, "%s()\n", __func__);
@@ -156,52 +417,205 @@ void wil6210_enable_irq(struct wil6210_priv *wil)
 	iowrite32(WIL_ICR_ICC_VALUE, wil->csr + HOSTADDR(RGF_DMA_EP_MISC_ICR) +
 		  offsetof(struct RGF_ICR, ICC));
 
-	/* interrupt moderation parameters */
-	if (wil->wdev->iftype == NL80211_IFTYPE_MONITOR) {
-		/* disable interrupt moderation for monitor
-		 * to get better timestamp precision
-		 */
-		iowrite32(0, wil->csr + HOSTADDR(RGF_DMA_ITR_CNT_CRL));
-	} else {
-		iowrite32(WIL6210_ITR_TRSH,
-			  wil->csr + HOSTADDR(RGF_DMA_ITR_CNT_TRSH));
-		iowrite32(BIT_DMA_ITR_CNT_CRL_EN,
-			  wil->csr + HOSTADDR(RGF_DMA_ITR_CNT_CRL));
+	wil6210_itr_init(wil);
 
-	}
+	/* start over, storm timer will find it off and stop */
+	wil->irq_storm.active = 0;
+	wil->irq_storm.misc_unmask = 0;
+	wil->irq_storm.itr_bump = 0;
 
+	/* don't trust shadow here, write all */
+	wil->irq_masked = ~0UL;
 	wil6210_unmask_irq_pseudo(wil);
 	wil6210_unmask_irq_tx(wil);
 	wil6210_unmask_irq_rx(wil);
 	wil6210_unmask_irq_misc(wil);
 }
 
+/*
+ * Rx, or combined Rx/Tx poll: in NAPI or in the poll thread.
+ * With poll thread, NAPI is never scheduled, even while thread is not
+ * running: Rx IRQ stays masked, and thread polls once when started
+ */
+void wil6210_schedule_rx(struct wil6210_priv *wil)
+{
+	if (!wil->poll_threaded)
+		napi_schedule(&wil->napi_rx);
+	else if (READ_ONCE(wil->poll_task))
+		wil6210_poll_thread_wake(wil);
+}
+
+/* Tx completions: own NAPI, or combined poll; also used by reap timer */
+void wil6210_schedule_tx(struct wil6210_priv *wil)
+{
+	if (wil->combined_poll)
+		wil6210_schedule_rx(wil);
+	else
+		napi_schedule(&wil->napi_tx);
+}
+
+static const char * const wil_irq_vec_name[wil_irq_vecs] = {
+	[wil_irq_tx] = "Tx",
+	[wil_irq_rx] = "Rx",
+	[wil_irq_misc] = "Misc",
+};
+
+static enum hrtimer_restart wil6210_irq_storm_poll(struct hrtimer *timer)
+{
+	struct wil6210_priv *wil = container_of(timer, struct wil6210_priv,
+						irq_storm.poll_timer);
+	struct wil_irq_storm *st = &wil->irq_storm;
+	ulong polled = st->active;
+	int i;
+
+	for (i = 0; i < wil_irq_vecs; i++) {
+		if (!test_bit(i, &polled) ||
+		    time_before(jiffies, st->vec[i].until))
+			continue;
+		/*
+		 * clear first: polls scheduled below unmask IRQs when done,
+		 * one that completed while storm still on - didn't
+		 */
+		clear_bit(i, &st->active);
+		wil_info(wil, "IRQ storm on %s over, back to interrupts\n",
+			 wil_irq_vec_name[i]);
+	}
+
+	if (test_bit(wil_irq_rx, &polled))
+		wil6210_schedule_rx(wil);
+	if (test_bit(wil_irq_tx, &polled))
+		wil6210_schedule_tx(wil);
+	/* Misc handled since last tick, let the next one in */
+	if (test_and_clear_bit(0, &st->misc_unmask))
+		__wil6210_unmask_irq_misc(wil);
+
+	if (!st->active)
+		return HRTIMER_NORESTART;
+
+	hrtimer_forward_now(timer,
+			    ns_to_ktime(irq_storm_poll_usec * NSEC_PER_USEC));
+	return HRTIMER_RESTART;
+}
+
+/*
+ * Throttle vector @vec for irq_storm_hold_ms: Rx and Tx stay masked
+ * and are polled from a timer, Misc (WMI) is let in once per timer
+ * period. Rx/Tx storm also raises interrupt moderation, applied on
+ * the next Rx poll completion, see wil6210_itr_update()
+ */
+static void wil6210_irq_storm_enter(struct wil6210_priv *wil, int vec)
+{
+	struct wil_irq_storm *st = &wil->irq_storm;
+	struct wil_irq_storm_vec *sv = &st->vec[vec];
+
+	sv->until = jiffies + msecs_to_jiffies(irq_storm_hold_ms);
+	if (test_and_set_bit(vec, &st->active))
+		return;
+
+	sv->storms++;
+	switch (vec) {
+	case wil_irq_rx:
+		wil6210_mask_irq_rx(wil);
+		set_bit(0, &st->itr_bump);
+		break;
+	case wil_irq_tx:
+		wil6210_mask_irq_tx(wil);
+		set_bit(0, &st->itr_bump);
+		break;
+	default:
+		/* Misc masked already, handler hands unmask to the timer */
+		break;
+	}
+	wil_err_ratelimited(wil, "IRQ storm on %s, %d IRQs/sec (%d spurious),"
+			    " throttling for %d ms\n", wil_irq_vec_name[vec],
+			    sv->last_rate, sv->spurious, irq_storm_hold_ms);
+	hrtimer_start(&st->poll_timer,
+		      ns_to_ktime(irq_storm_poll_usec * NSEC_PER_USEC),
+		      HRTIMER_MODE_REL);
+}
+
+/*
+ * Count interrupts of vector @vec over WIL_IRQ_STORM_WINDOW_MS windows;
+ * spurious ones weigh 10 times, as they indicate misbehaving device.
+ * Interrupts with no cause at all on the shared line are not counted:
+ * they may belong to another device, and the kernel's spurious IRQ
+ * detection deals with the line itself
+ */
+static void wil6210_irq_storm_account(struct wil6210_priv *wil, int vec,
+				      bool spurious)
+{
+	struct wil_irq_storm_vec *sv = &wil->irq_storm.vec[vec];
+	unsigned long elapsed;
+	u32 load;
+
+	if (!irq_storm_rate)
+		return;
+
+	sv->irqs++;
+	if (spurious)
+		sv->spurious++;
+
+	elapsed = jiffies - sv->window;
+	if (elapsed < msecs_to_jiffies(WIL_IRQ_STORM_WINDOW_MS))
+		return;
+
+	sv->last_rate = sv->irqs * HZ / elapsed;
+	load = (sv->irqs + 9 * sv->spurious) * HZ / elapsed;
+	if (load > irq_storm_rate)
+		wil6210_irq_storm_enter(wil, vec);
+
+	sv->window = jiffies;
+	sv->irqs = 0;
+	sv->spurious = 0;
+}
+
+static inline void wil6210_irq_account(struct wil6210_priv *wil, int vec)
+{
+	wil->irq_vec[vec].count++;
+	wil->irq_vec[vec].last_cpu = smp_processor_id();
+	wil6210_irq_storm_account(wil, vec, false);
+}
+
+static inline void wil6210_irq_spurious(struct wil6210_priv *wil, int vec)
+{
+	wil->irq_vec[vec].spurious++;
+	wil6210_irq_storm_account(wil, vec, true);
+}
+
 static irqreturn_t wil6210_irq_rx(int irq, void *cookie)
 {
 	struct wil6210_priv *wil = cookie;
-	u32 isr = wil_ioread32_and_clear(wil->csr +
+	u32 isr = wil_ioread32_and_clear(wil,
 					 HOSTADDR(RGF_DMA_EP_RX_ICR) +
 					 offsetof(struct RGF_ICR, ICR));
 
 	trace_wil6210_irq_rx(isr);
 	wil_dbg_irq(wil, "ISR RX 0x%08x\n", isr);
-
 	if (!isr) {
-		wil_err(wil, "spurious IRQ: RX\n");
+		wil6210_irq_spurious(wil, wil_irq_rx);
+		wil_err_ratelimited(wil, "spurious IRQ: RX\n");
 		return IRQ_NONE;
 	}
+	wil6210_irq_account(wil, wil_irq_rx);
 
 	wil6210_mask_irq_rx(wil);
+	/* combined poll reaps Tx as well, no need in Tx IRQ meanwhile */
+	if (wil->combined_poll)
+		wil6210_mask_irq_tx(wil);
+	atomic_inc(&wil->itr.irqs);
 
 	if (isr & BIT_DMA_EP_RX_ICR_RX_DONE) {
 		wil_dbg_irq(wil, "RX done\n");
 		isr &= ~BIT_DMA_EP_RX_ICR_RX_DONE;
 		wil_dbg_txrx(wil, "NAPI schedule\n");
-		napi_schedule(&wil->napi_rx);
+		wil6210_schedule_rx(wil);
 	}
 
-	if (isr)
-		wil_err(wil, "un-handled RX ISR bits 0x%08x\n", isr);
+	if (isr) {
+		wil->irq_vec[wil_irq_rx].unhandled++;
+		wil_err_ratelimited(wil, "un-handled RX ISR bits 0x%08x\n",
+				    isr);
+	}
 
 	/* Rx IRQ will be enabled when NAPI processing finished */
 
@@ -211,30 +625,34 @@ static irqreturn_t wil6210_irq_rx(int irq, void *cookie)
 static irqreturn_t wil6210_irq_tx(int irq, void *cookie)
 {
 	struct wil6210_priv *wil = cookie;
-	u32 isr = wil_ioread32_and_clear(wil->csr +
+	u32 isr = wil_ioread32_and_clear(wil,
 					 HOSTADDR(RGF_DMA_EP_TX_ICR) +
 					 offsetof(struct RGF_ICR, ICR));
 
 	trace_wil6210_irq_tx(isr);
 	wil_dbg_irq(wil, "ISR TX 0x%08x\n", isr);
-
 	if (!isr) {
-		wil_err(wil, "spurious IRQ: TX\n");
+		wil6210_irq_spurious(wil, wil_irq_tx);
+		wil_err_ratelimited(wil, "spurious IRQ: TX\n");
 		return IRQ_NONE;
 	}
+	wil6210_irq_account(wil, wil_irq_tx);
 
 	wil6210_mask_irq_tx(wil);
 
 	if (isr & BIT_DMA_EP_TX_ICR_TX_DONE) {
 		wil_dbg_irq(wil, "TX done\n");
-		napi_schedule(&wil->napi_tx);
+		wil6210_schedule_tx(wil);
 		isr &= ~BIT_DMA_EP_TX_ICR_TX_DONE;
 		/* clear also all VRING interrupts */
 		isr &= ~(BIT(25) - 1UL);
 	}
 
-	if (isr)
-		wil_err(wil, "un-handled TX ISR bits 0x%08x\n", isr);
+	if (isr) {
+		wil->irq_vec[wil_irq_tx].unhandled++;
+		wil_err_ratelimited(wil, "un-handled TX ISR bits 0x%08x\n",
+				    isr);
+	}
 
 	/* Tx IRQ will be enabled when NAPI processing finished */
 
@@ -264,17 +682,18 @@ static void wil_cache_mbox_regs(struct wil6210_priv *wil)
 static irqreturn_t wil6210_irq_misc(int irq, void *cookie)
 {
 	struct wil6210_priv *wil = cookie;
-	u32 isr = wil_ioread32_and_clear(wil->csr +
+	u32 isr = wil_ioread32_and_clear(wil,
 					 HOSTADDR(RGF_DMA_EP_MISC_ICR) +
 					 offsetof(struct RGF_ICR, ICR));
 
 	trace_wil6210_irq_misc(isr);
 	wil_dbg_irq(wil, "ISR MISC 0x%08x\n", isr);
-
 	if (!isr) {
-		wil_err(wil, "spurious IRQ: MISC\n");
+		wil6210_irq_spurious(wil, wil_irq_misc);
+		wil_err_ratelimited(wil, "spurious IRQ: MISC\n");
 		return IRQ_NONE;
 	}
+	wil6210_irq_account(wil, wil_irq_misc);
 
 	wil6210_mask_irq_misc(wil);
 
@@ -325,11 +744,16 @@ static irqreturn_t wil6210_irq_misc_thread(int irq, void *cookie)
 	if (isr & ISR_MISC_MBOX_EVT) {
 		wil_dbg_irq(wil, "MBOX event\n");
 		wmi_recv_cmd(wil);
+		/* FW likely freed Tx mailbox entries as well */
+		wake_up(&wil->wmi_mbox_wq);
 		isr &= ~ISR_MISC_MBOX_EVT;
 	}
 
-	if (isr)
-		wil_err(wil, "un-handled MISC ISR bits 0x%08x\n", isr);
+	if (isr) {
+		wil->irq_vec[wil_irq_misc].unhandled++;
+		wil_err_ratelimited(wil, "un-handled MISC ISR bits 0x%08x\n",
+				    isr);
+	}
 
 	wil->isr_misc = 0;
 
@@ -355,6 +779,7 @@ static irqreturn_t wil6210_thread_irq(int irq, void *cookie)
 	return IRQ_HANDLED;
 }
 
+#if defined(CONFIG_WIL6210_DEBUG_IRQ_MASK)
 /* DEBUG
  * There is subtle bug in hardware that causes IRQ to raise when it should be
  * masked. It is quite rare and hard to debug.
@@ -364,28 +789,28 @@ static irqreturn_t wil6210_thread_irq(int irq, void *cookie)
 static int wil6210_debug_irq_mask(struct wil6210_priv *wil, u32 pseudo_cause)
 {
 	if (!test_bit(wil_status_irqen, &wil->status)) {
-		u32 icm_rx = wil_ioread32_and_clear(wil->csr +
+		u32 icm_rx = wil_ioread32_and_clear(wil,
 				HOSTADDR(RGF_DMA_EP_RX_ICR) +
 				offsetof(struct RGF_ICR, ICM));
-		u32 icr_rx = wil_ioread32_and_clear(wil->csr +
+		u32 icr_rx = wil_ioread32_and_clear(wil,
 				HOSTADDR(RGF_DMA_EP_RX_ICR) +
 				offsetof(struct RGF_ICR, ICR));
 		u32 imv_rx = ioread32(wil->csr +
 				HOSTADDR(RGF_DMA_EP_RX_ICR) +
 				offsetof(struct RGF_ICR, IMV));
-		u32 icm_tx = wil_ioread32_and_clear(wil->csr +
+		u32 icm_tx = wil_ioread32_and_clear(wil,
 				HOSTADDR(RGF_DMA_EP_TX_ICR) +
 				offsetof(struct RGF_ICR, ICM));
-		u32 icr_tx = wil_ioread32_and_clear(wil->csr +
+		u32 icr_tx = wil_ioread32_and_clear(wil,
 				HOSTADDR(RGF_DMA_EP_TX_ICR) +
 				offsetof(struct RGF_ICR, ICR));
 		u32 imv_tx = ioread32(wil->csr +
 				HOSTADDR(RGF_DMA_EP_TX_ICR) +
 				offsetof(struct RGF_ICR, IMV));
-		u32 icm_misc = wil_ioread32_and_clear(wil->csr +
+		u32 icm_misc = wil_ioread32_and_clear(wil,
 				HOSTADDR(RGF_DMA_EP_MISC_ICR) +
 				offsetof(struct RGF_ICR, ICM));
-		u32 icr_misc = wil_ioread32_and_clear(wil->csr +
+		u32 icr_misc = wil_ioread32_and_clear(wil,
 				HOSTADDR(RGF_DMA_EP_MISC_ICR) +
 				offsetof(struct RGF_ICR, ICR));
 		u32 imv_misc = ioread32(wil->csr +
@@ -405,18 +830,29 @@ static int wil6210_debug_irq_mask(struct wil6210_priv *wil, u32 pseudo_cause)
 
 	return 0;
 }
+#else /* defined(CONFIG_WIL6210_DEBUG_IRQ_MASK) */
+static inline int wil6210_debug_irq_mask(struct wil6210_priv *wil,
+					 u32 pseudo_cause)
+{
+	return 0;
+}
+#endif /* defined(CONFIG_WIL6210_DEBUG_IRQ_MASK) */
 
 static irqreturn_t wil6210_hardirq(int irq, void *cookie)
 {
 	irqreturn_t rc = IRQ_HANDLED;
 	struct wil6210_priv *wil = cookie;
-	u32 pseudo_cause = ioread32(wil->csr + HOSTADDR(RGF_DMA_PSEUDO_CAUSE));
+	u32 pseudo_cause = wil_irq_ioread32(wil,
+					    HOSTADDR(RGF_DMA_PSEUDO_CAUSE));
+	bool misc;
 
 	/**
 	 * pseudo_cause is Clear-On-Read, no need to ACK
 	 */
-	if ((pseudo_cause == 0) || ((pseudo_cause & 0xff) == 0xff))
+	if ((pseudo_cause == 0) || ((pseudo_cause & 0xff) == 0xff)) {
+		wil->irq_shared_spurious++;
 		return IRQ_NONE;
+	}
 
 	/* FIXME: IRQ mask debug */
 	if (wil6210_debug_irq_mask(wil, pseudo_cause))
@@ -424,8 +860,15 @@ static irqreturn_t wil6210_hardirq(int irq, void *cookie)
 
 	trace_wil6210_irq_pseudo(pseudo_cause);
 	wil_dbg_irq(wil, "Pseudo IRQ 0x%08x\n", pseudo_cause);
+	wil->irq_shared_count++;
 
-	wil6210_mask_irq_pseudo(wil);
+	/*
+	 * Rx and Tx get masked at their own ICR and never wake the thread,
+	 * so pseudo mask/unmask pair is only needed for the Misc cause
+	 */
+	misc = !!(pseudo_cause & BIT_DMA_PSEUDO_CAUSE_MISC);
+	if (misc)
+		wil6210_mask_irq_pseudo(wil);
 
 	/* Discover real IRQ cause
 	 * There are 2 possible phases for every IRQ:
@@ -453,12 +896,69 @@ static irqreturn_t wil6210_hardirq(int irq, void *cookie)
 		rc = IRQ_WAKE_THREAD;
 
 	/* if thread is requested, it will unmask IRQ */
-	if (rc != IRQ_WAKE_THREAD)
+	if (misc && (rc != IRQ_WAKE_THREAD))
 		wil6210_unmask_irq_pseudo(wil);
 
 	return rc;
 }
 
+/*
+ * Choose CPU for vector @vec: explicit @param if online, otherwise
+ * spread vectors over online CPUs of the device's NUMA node -
+ * Rx, Tx, Misc on distinct CPUs while possible, Misc sharing with Tx
+ * when there are only 2 of them.
+ */
+static int wil6210_irq_cpu(struct wil6210_priv *wil, int param, int vec)
+{
+	static const int order[] = {
+		[wil_irq_rx] = 0,
+		[wil_irq_tx] = 1,
+		[wil_irq_misc] = 2,
+	};
+	int node = dev_to_node(&wil->pdev->dev);
+	const struct cpumask *mask = (node < 0) ? cpu_online_mask :
+					cpumask_of_node(node);
+	int n = 0, cpu, i;
+
+	if (param >= 0) {
+		if (param < nr_cpu_ids && cpu_online(param))
+			return param;
+		wil_err(wil, "CPU %d for IRQ vector %d is offline\n",
+			param, vec);
+	}
+
+	for_each_cpu_and(cpu, mask, cpu_online_mask)
+		n++;
+	if (!n) {
+		mask = cpu_online_mask;
+		n = num_online_cpus();
+	}
+	if (n < 2)
+		return -1;
+
+	i = min(order[vec], n - 1);
+	for_each_cpu_and(cpu, mask, cpu_online_mask)
+		if (i-- == 0)
+			return cpu;
+
+	return -1;
+}
+
+static void wil6210_irq_affinity(struct wil6210_priv *wil, int vec, int irq,
+				 int param)
+{
+	struct wil_irq_vec *v = &wil->irq_vec[vec];
+
+	v->irq = irq;
+	v->cpu = wil6210_irq_cpu(wil, param, vec);
+	if (v->cpu < 0)
+		return;
+
+	wil_dbg_irq(wil, "IRQ %d -> CPU %d\n", irq, v->cpu);
+	if (irq_set_affinity_hint(irq, cpumask_of(v->cpu)))
+		wil_err(wil, "Failed to set affinity hint for IRQ %d\n", irq);
+}
+
 static int wil6210_request_3msi(struct wil6210_priv *wil, int irq)
 {
 	int rc;
@@ -485,6 +985,10 @@ static int wil6210_request_3msi(struct wil6210_priv *wil, int irq)
 	if (rc)
 		goto free1;
 
+	wil6210_irq_affinity(wil, wil_irq_tx, irq, irq_cpu_tx);
+	wil6210_irq_affinity(wil, wil_irq_rx, irq + 1, irq_cpu_rx);
+	wil6210_irq_affinity(wil, wil_irq_misc, irq + 2, irq_cpu_misc);
+
 	return 0;
 	/* error branch */
 free1:
@@ -495,9 +999,34 @@ free0:
 	return rc;
 }
 
+/* wait for IRQ handlers running on other CPUs */
+void wil6210_synchronize_irq(struct wil6210_priv *wil)
+{
+	int irq = wil->pdev->irq;
+
+	synchronize_irq(irq);
+	if (wil->n_msi == 3) {
+		synchronize_irq(irq + 1);
+		synchronize_irq(irq + 2);
+	}
+}
+
 int wil6210_init_irq(struct wil6210_priv *wil, int irq)
 {
-	int rc;
+	int rc, i;
+
+	memset(wil->irq_vec, 0, sizeof(wil->irq_vec));
+	wil->irq_shared_count = 0;
+	wil->irq_shared_spurious = 0;
+	memset(&wil->irq_storm, 0, sizeof(wil->irq_storm));
+	for (i = 0; i < wil_irq_vecs; i++)
+		wil->irq_storm.vec[i].window = jiffies;
+	hrtimer_init(&wil->irq_storm.poll_timer, CLOCK_MONOTONIC,
+		     HRTIMER_MODE_REL);
+	wil->irq_storm.poll_timer.function = wil6210_irq_storm_poll;
+	for (i = 0; i < wil_irq_vecs; i++)
+		wil->irq_vec[i].cpu = -1;
+
 	if (wil->n_msi == 3)
 		rc = wil6210_request_3msi(wil, irq);
 	else
@@ -515,7 +1044,14 @@ int wil6210_init_irq(struct wil6210_priv *wil, int irq)
 
 void wil6210_fini_irq(struct wil6210_priv *wil, int irq)
 {
+	int i;
+
 	wil6210_disable_irq(wil);
+	hrtimer_cancel(&wil->irq_storm.poll_timer);
+	wil->irq_storm.active = 0;
+	for (i = 0; i < wil_irq_vecs; i++)
+		if (wil->irq_vec[i].cpu >= 0)
+			irq_set_affinity_hint(wil->irq_vec[i].irq, NULL);
 	free_irq(irq, wil);
 	if (wil->n_msi == 3) {
 		free_irq(irq + 1, wil);
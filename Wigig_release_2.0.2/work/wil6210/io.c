@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2012 Qualcomm Atheros, Inc.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <linux/prefetch.h>
+
+#include "wil6210.h"
+
+/*
+ * Due to a hardware issue,
+ * one has to read/write to/from NIC in 32-bit chunks;
+ * regular memcpy_fromio and siblings will
+ * not work on 64-bit platform - it uses 64-bit transactions
+ *
+ * Force 32-bit transactions to enable NIC on 64-bit platforms
+ *
+ * To avoid byte swap on big endian host, __raw_{read|write}l
+ * should be used - {read|write}l would swap bytes to provide
+ * little endian on PCI value in host endianness.
+ *
+ * Loops are unrolled by 4 words, with all 4 reads issued before the
+ * stores; for long copies (FW memory dumps via debugfs) host memory
+ * side is prefetched a cache line ahead. Device still sees 32-bit
+ * transactions only, in ascending address order.
+ *
+ * Trailing partial word is transferred as a whole word, callers
+ * provide buffers rounded up to 4 bytes.
+ */
+#define WIL_IO_PREFETCH_WORDS	(16) /* 64 bytes ahead */
+
+void wil_memcpy_fromio_32(void *dst, const volatile void __iomem *src,
+			  size_t count)
+{
+	u32 *d = dst;
+	const volatile u32 __iomem *s = src;
+	size_t n = DIV_ROUND_UP(count, 4);
+
+	for (; n >= 4; n -= 4, d += 4, s += 4) {
+		u32 w0 = __raw_readl(s);
+		u32 w1 = __raw_readl(s + 1);
+		u32 w2 = __raw_readl(s + 2);
+		u32 w3 = __raw_readl(s + 3);
+
+		if (n > WIL_IO_PREFETCH_WORDS)
+			prefetchw(d + WIL_IO_PREFETCH_WORDS);
+		d[0] = w0;
+		d[1] = w1;
+		d[2] = w2;
+		d[3] = w3;
+	}
+
+	while (n--)
+		*d++ = __raw_readl(s++);
+}
+
+void wil_memcpy_toio_32(volatile void __iomem *dst, const void *src,
+			size_t count)
+{
+	volatile u32 __iomem *d = dst;
+	const u32 *s = src;
+	size_t n = DIV_ROUND_UP(count, 4);
+
+	for (; n >= 4; n -= 4, d += 4, s += 4) {
+		if (n > WIL_IO_PREFETCH_WORDS)
+			prefetch(s + WIL_IO_PREFETCH_WORDS);
+		__raw_writel(s[0], d);
+		__raw_writel(s[1], d + 1);
+		__raw_writel(s[2], d + 2);
+		__raw_writel(s[3], d + 3);
+	}
+
+	while (n--)
+		__raw_writel(*s++, d++);
+}
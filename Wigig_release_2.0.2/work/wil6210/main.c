@@ -21,59 +21,38 @@
 #include "wil6210.h"
 #include "txrx.h"
 
-/*
- * Due to a hardware issue,
- * one has to read/write to/from NIC in 32-bit chunks;
- * regular memcpy_fromio and siblings will
- * not work on 64-bit platform - it uses 64-bit transactions
- *
- * Force 32-bit transactions to enable NIC on 64-bit platforms
- *
- * To avoid byte swap on big endian host, __raw_{read|write}l
- * should be used - {read|write}l would swap bytes to provide
- * little endian on PCI value in host endianness.
- */
-void wil_memcpy_fromio_32(void *dst, const volatile void __iomem *src,
-			  size_t count)
-{
-	u32 *d = dst;
-	const volatile u32 __iomem *s = src;
-
-	/* size_t is unsigned, if (count%4 != 0) it will wrap */
-	for (count += 4; count > 4; count -= 4)
-		*d++ = __raw_readl(s++);
-}
-
-void wil_memcpy_toio_32(volatile void __iomem *dst, const void *src,
-			size_t count)
-{
-	volatile u32 __iomem *d = dst;
-	const u32 *s = src;
-
-	for (count += 4; count > 4; count -= 4)
-		__raw_writel(*s++, d++);
-}
-
 static void wil_disconnect_cid(struct wil6210_priv *wil, int cid)
 {
 	uint i;
 	struct wil_sta_info *sta = &wil->sta[cid];
+	enum wil_sta_status status;
 
-	if (sta->status != wil_sta_unused) {
+	/* vs. wil_connect_vring_done() */
+	spin_lock(&wil->vring_cfg_lock);
+	status = sta->status;
+	sta->status = wil_sta_unused;
+	spin_unlock(&wil->vring_cfg_lock);
+
+	if (status != wil_sta_unused) {
 		wmi_disconnect_sta(wil, sta->addr, WLAN_REASON_DEAUTH_LEAVING);
-		sta->status = wil_sta_unused;
+		/* handshake frames are not for the next station on this CID */
+		wil_eapol_tx_purge(wil, sta->addr);
 	}
 
-	for (i = 0; i < WIL_STA_TID_NUM; i++) {
-		struct wil_tid_ampdu_rx *r = sta->tid_rx[i];
-		sta->tid_rx[i] = NULL;
-		wil_tid_ampdu_rx_free(wil, r);
-	}
+	clear_bit(cid, &wil->pending_connect);
+	for (i = 0; i < WIL_STA_TID_NUM; i++)
+		wil_tid_ampdu_rx_set(wil, sta, i, NULL);
+	wil_back_pool_drain(wil, cid);
 	for (i = 0; i < ARRAY_SIZE(wil->vring_tx); i++) {
 		if (wil->vring2cid_tid[i][0] == cid)
 			wil_vring_fini_tx(wil, i);
 	}
 	memset(&sta->stats, 0, sizeof(sta->stats));
+	memset(&sta->link, 0, sizeof(sta->link));
+	/*
+	 * @sinfo_notify_cid left as is: FW may keep reporting, next link
+	 * query stops it; reports for unused CID are not cached
+	 */
 }
 
 static void _wil6210_disconnect(struct wil6210_priv *wil, void *bssid)
@@ -171,29 +150,101 @@ static int wil_find_free_vring(struct wil6210_priv *wil)
 	return -EINVAL;
 }
 
+/* unless station left meanwhile, and maybe another one came */
+static void wil_connect_failed(struct wil6210_priv *wil, int cid)
+{
+	struct wil_sta_info *sta = &wil->sta[cid];
+
+	spin_lock(&wil->vring_cfg_lock);
+	if (sta->status == wil_sta_conn_pending &&
+	    !test_bit(cid, &wil->pending_connect))
+		sta->status = wil_sta_unused;
+	spin_unlock(&wil->vring_cfg_lock);
+}
+
+/*
+ * Tx vring configured by the firmware, called on wmi_wq.
+ * @ctx identifies the command, see wil_vring_init_tx()
+ */
+static void wil_connect_vring_done(struct wil6210_priv *wil, void *ctx,
+				   int rc, void *reply, u16 len)
+{
+	int ringid, cid;
+	struct wil_sta_info *sta;
+	bool gone;
+
+	rc = wil_vring_init_tx_done(wil, ctx, rc, reply, len, &ringid);
+	/* vring released while FW was busy with it; CID may be reused */
+	if (rc == -ESTALE)
+		return;
+
+	cid = wil->vring2cid_tid[ringid][0];
+	sta = &wil->sta[cid];
+
+	/*
+	 * Station may have left before the vring was recorded for its CID,
+	 * so that wil_disconnect_cid() did not see it; or a new one may
+	 * wait for wil_connect_worker() on the same CID.
+	 * Either way, the vring is nobody else's to free
+	 */
+	spin_lock(&wil->vring_cfg_lock);
+	gone = sta->status != wil_sta_conn_pending ||
+	       test_bit(cid, &wil->pending_connect);
+	if (!gone)
+		sta->status = rc ? wil_sta_unused : wil_sta_connected;
+	spin_unlock(&wil->vring_cfg_lock);
+
+	if (gone) {
+		if (!rc) {
+			wil_dbg_wmi(wil, "CID %d gone, drop Tx vring [%d]\n",
+				    cid, ringid);
+			wmi_vring_delete(wil, ringid);
+			wil_vring_fini_tx(wil, ringid);
+		}
+		return;
+	}
+
+	if (rc) {
+		wil_err(wil, "Tx vring [%d] for CID %d failed: %d\n",
+			ringid, cid, rc);
+		return;
+	}
+
+	wil_dbg_wmi(wil, "CID %d connected, Tx vring [%d]\n", cid, ringid);
+	wil_back_pool_fill(wil, cid);
+	wil_link_on(wil);
+}
+
+/*
+ * Start Tx vring configuration for all CIDs connected since the last run.
+ * Commands are pipelined, each station completes in
+ * wil_connect_vring_done() as its reply arrives
+ */
 static void wil_connect_worker(struct work_struct *work)
 {
 	int rc;
 	struct wil6210_priv *wil = container_of(work, struct wil6210_priv,
 						connect_worker);
-	int cid = wil->pending_connect_cid;
 	int tid = wil->tid_to_use & 0xf;
-	int ringid = wil_find_free_vring(wil);
+	int cid, ringid;
 
-	if (cid < 0) {
-		wil_err(wil, "No connection pending\n");
-		return;
-	}
+	for (cid = 0; cid < WIL6210_MAX_CID; cid++) {
+		if (!test_and_clear_bit(cid, &wil->pending_connect))
+			continue;
 
-	wil_dbg_wmi(wil, "Configure for connection CID %d\n", cid);
+		ringid = wil_find_free_vring(wil);
+		if (ringid < 0) {
+			wil_err(wil, "No free Tx vring for CID %d\n", cid);
+			wil_connect_failed(wil, cid);
+			continue;
+		}
 
-	rc = wil_vring_init_tx(wil, ringid, WIL6210_TX_RING_SIZE, cid, tid);
-	wil->pending_connect_cid = -1;
-	if (rc == 0) {
-		wil->sta[cid].status = wil_sta_connected;
-		wil_link_on(wil);
-	} else {
-		wil->sta[cid].status = wil_sta_unused;
+		wil_dbg_wmi(wil, "Configure for connection CID %d\n", cid);
+
+		rc = wil_vring_init_tx(wil, ringid, WIL6210_TX_RING_SIZE, cid,
+				       tid, wil_connect_vring_done);
+		if (rc)
+			wil_connect_failed(wil, cid);
 	}
 }
 
@@ -209,7 +260,11 @@ int wil_priv_init(struct wil6210_priv *wil)
 
 	init_completion(&wil->wmi_ready);
 
-	wil->pending_connect_cid = -1;
+	wil_back_policy_init(wil);
+
+	wil->pending_connect = 0;
+	wil->sinfo_notify_cid = -1;
+	atomic_set(&wil->cookie_counter, 0);
 	setup_timer(&wil->connect_timer, wil_connect_timer_fn, (ulong)wil);
 
 	INIT_WORK(&wil->connect_worker, wil_connect_worker);
@@ -220,6 +275,18 @@ int wil_priv_init(struct wil6210_priv *wil)
 	INIT_LIST_HEAD(&wil->pending_wmi_ev);
 	INIT_LIST_HEAD(&wil->back_pending);
 	spin_lock_init(&wil->wmi_ev_lock);
+	INIT_LIST_HEAD(&wil->wmi_ev_free);
+	INIT_LIST_HEAD(&wil->wmi_calls);
+	spin_lock_init(&wil->wmi_call_lock);
+	spin_lock_init(&wil->vring_cfg_lock);
+	sema_init(&wil->wmi_call_sem, WIL_WMI_CALLS_MAX);
+	spin_lock_init(&wil->wmi_cmd_stat_lock);
+	INIT_DELAYED_WORK(&wil->wmi_call_expire, wmi_call_expire);
+	init_waitqueue_head(&wil->wmi_mbox_wq);
+	spin_lock_init(&wil->tid_rx_lock);
+	INIT_LIST_HEAD(&wil->rx_reorder_retired);
+	wil_tx_coalesce_init(wil);
+	wil_eapol_tx_init(wil);
 
 	wil->wmi_wq = create_singlethread_workqueue(WIL_NAME"_wmi");
 	if (!wil->wmi_wq)
@@ -234,14 +301,21 @@ int wil_priv_init(struct wil6210_priv *wil)
 		goto out_wmi_wq_conn;
 
 	wil->roc_wq = create_singlethread_workqueue(WIL_NAME"_roc");
-	if (!wil->roc_wq) {
-		destroy_workqueue(wil->wmi_wq_conn);
-		destroy_workqueue(wil->wmi_wq);
-		return -EAGAIN;
-	}
+	if (!wil->roc_wq)
+		goto out_back_wq;
+
+	wil->eapol_wq = alloc_ordered_workqueue(WIL_NAME"_eapol", WQ_HIGHPRI);
+	if (!wil->eapol_wq)
+		goto out_roc_wq;
+
+	wil_tx_vring_pool_init(wil);
 
 	return 0;
 
+out_roc_wq:
+	destroy_workqueue(wil->roc_wq);
+out_back_wq:
+	destroy_workqueue(wil->back_wq);
 out_wmi_wq_conn:
 	destroy_workqueue(wil->wmi_wq_conn);
 out_wmi_wq:
@@ -259,13 +333,20 @@ void wil6210_disconnect(struct wil6210_priv *wil, void *bssid)
 void wil_priv_deinit(struct wil6210_priv *wil)
 {
 	cancel_work_sync(&wil->disconnect_worker);
+	wil_tx_coalesce_stop(wil);
+	wil_eapol_tx_stop(wil);
 	wil6210_disconnect(wil, NULL);
+	wmi_call_flush(wil, -ESHUTDOWN);
 	wmi_event_flush(wil);
 	wil_back_flush(wil);
+	destroy_workqueue(wil->eapol_wq);
 	destroy_workqueue(wil->roc_wq);
 	destroy_workqueue(wil->wmi_wq_conn);
 	destroy_workqueue(wil->wmi_wq);
 	destroy_workqueue(wil->back_wq);
+	wil_rx_reorder_purge(wil);
+	wmi_ev_pool_free(wil);
+	wil_tx_vring_pool_free(wil);
 }
 
 static void wil_target_reset(struct wil6210_priv *wil)
@@ -344,17 +425,21 @@ int wil_reset(struct wil6210_priv *wil)
 	wil6210_disable_irq(wil);
 	wil->status = 0;
 
+	wmi_call_flush(wil, -ESHUTDOWN);
 	wmi_event_flush(wil);
 
 	flush_workqueue(wil->wmi_wq_conn);
 	flush_workqueue(wil->wmi_wq);
 	flush_workqueue(wil->back_wq);
+	/* FW may come up with other mailbox entry size */
+	wmi_ev_pool_free(wil);
 
 	/* TODO: put MAC in reset */
 	wil_target_reset(wil);
 
 	/* init after reset */
-	wil->pending_connect_cid = -1;
+	wil->pending_connect = 0;
+	WRITE_ONCE(wil->sinfo_notify_cid, -1);
 	INIT_COMPLETION(wil->wmi_ready);
 
 	/* TODO: release MAC reset */
@@ -362,6 +447,8 @@ int wil_reset(struct wil6210_priv *wil)
 
 	/* we just started MAC, wait for FW ready */
 	rc = wil_wait_for_fw_ready(wil);
+	if (rc == 0)
+		wmi_ev_pool_init(wil);
 
 	return rc;
 }
@@ -467,8 +554,15 @@ static int __wil_up(struct wil6210_priv *wil)
 			return rc;
 	} 
 #endif
+	/* poll thread, if any, owns Rx before NAPI may run */
+	rc = wil6210_poll_thread_start(wil);
+	if (rc)
+		return rc;
+
 	napi_enable(&wil->napi_rx);
 	napi_enable(&wil->napi_tx);
+	wil_busy_poll_enable(wil);
+	set_bit(wil_status_napi_en, &wil->status);
 
 	return 0;
 }
@@ -486,8 +580,13 @@ int wil_up(struct wil6210_priv *wil)
 
 static int __wil_down(struct wil6210_priv *wil)
 {
+	clear_bit(wil_status_napi_en, &wil->status);
+	wil_tx_coalesce_stop(wil);
+	wil_eapol_tx_stop(wil);
+	wil6210_poll_thread_stop(wil);
 	napi_disable(&wil->napi_rx);
 	napi_disable(&wil->napi_tx);
+	wil_busy_poll_disable(wil);
 
 	if (wil->scan_request) {
 		cfg80211_scan_done(wil->scan_request, true);
@@ -495,6 +594,10 @@ static int __wil_down(struct wil6210_priv *wil)
 	}
 
 	wil6210_disconnect(wil, NULL);
+	/* report mgmt Tx status and such while interface is still there */
+	wmi_call_flush(wil, -ESHUTDOWN);
+	/* Rx poll is off, frames of the closed sessions would go stale */
+	wil_rx_reorder_purge(wil);
 	wil_rx_fini(wil);
 
 	return 0;
@@ -15,9 +15,39 @@
  */
 
 #include <linux/etherdevice.h>
+#include <linux/moduleparam.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#ifdef CONFIG_NET_RX_BUSY_POLL
+#include <net/busy_poll.h>
+#endif
 
 #include "wil6210.h"
 
+static bool combined_poll;
+module_param(combined_poll, bool, S_IRUGO);
+MODULE_PARM_DESC(combined_poll, " reap Tx completions in Rx NAPI context,"
+		 " single NAPI schedule and IRQ unmask per burst");
+
+static bool poll_thread;
+module_param(poll_thread, bool, S_IRUGO);
+MODULE_PARM_DESC(poll_thread, " run Rx/Tx poll in dedicated kernel thread"
+		 " instead of NAPI softirq; implies combined_poll");
+
+static int poll_thread_policy = SCHED_FIFO;
+module_param(poll_thread_policy, int, S_IRUGO);
+MODULE_PARM_DESC(poll_thread_policy, " poll thread scheduling policy:"
+		 " 0 - normal, 1 - (default) FIFO, 2 - RR");
+
+static int poll_thread_prio = 50;
+module_param(poll_thread_prio, int, S_IRUGO);
+MODULE_PARM_DESC(poll_thread_prio, " poll thread realtime priority, 1..99");
+
+static int poll_thread_cpu = -1;
+module_param(poll_thread_cpu, int, S_IRUGO);
+MODULE_PARM_DESC(poll_thread_cpu, " CPU to bind poll thread to,"
+		 " -1 (default) - don't bind");
+
 static int wil_open(struct net_device *ndev)
 {
 	struct wil6210_priv *wil = ndev_to_wil(ndev);
@@ -52,6 +82,134 @@ static int wil_set_features(struct net_device *netdev,
 	return 0;
 }
 
+#ifdef CONFIG_NET_RX_BUSY_POLL
+/*
+ * Busy poll: Rx vring is owned either by NAPI (or poll thread) or by the
+ * busy polling socket; the other one yields and retries later
+ */
+#define WIL_BP_IDLE		(0)
+#define WIL_BP_NAPI		BIT(0) /* NAPI owns Rx */
+#define WIL_BP_POLL		BIT(1) /* busy poll owns Rx */
+#define WIL_BP_DISABLED		BIT(2)
+#define WIL_BP_NAPI_YIELD	BIT(3) /* NAPI yielded to busy poll */
+#define WIL_BP_POLL_YIELD	BIT(4) /* busy poll yielded to NAPI */
+#define WIL_BP_LOCKED		(WIL_BP_NAPI | WIL_BP_POLL | WIL_BP_DISABLED)
+#define WIL_BP_BUDGET		(4)
+
+static bool wil_bp_lock_napi(struct wil6210_priv *wil)
+{
+	bool rc = true;
+
+	spin_lock(&wil->bp_lock);
+	if (wil->bp_state & WIL_BP_LOCKED) {
+		wil->bp_state |= WIL_BP_NAPI_YIELD;
+		wil->bp_stats.napi_yield++;
+		rc = false;
+	} else {
+		wil->bp_state = WIL_BP_NAPI;
+	}
+	spin_unlock(&wil->bp_lock);
+
+	return rc;
+}
+
+static void wil_bp_unlock_napi(struct wil6210_priv *wil)
+{
+	spin_lock(&wil->bp_lock);
+	wil->bp_state &= WIL_BP_DISABLED;
+	spin_unlock(&wil->bp_lock);
+}
+
+static bool wil_bp_lock_poll(struct wil6210_priv *wil)
+{
+	bool rc = true;
+
+	spin_lock_bh(&wil->bp_lock);
+	if (wil->bp_state & WIL_BP_LOCKED) {
+		wil->bp_state |= WIL_BP_POLL_YIELD;
+		wil->bp_stats.poll_yield++;
+		rc = false;
+	} else {
+		wil->bp_state |= WIL_BP_POLL;
+	}
+	spin_unlock_bh(&wil->bp_lock);
+
+	return rc;
+}
+
+static void wil_bp_unlock_poll(struct wil6210_priv *wil)
+{
+	spin_lock_bh(&wil->bp_lock);
+	wil->bp_state &= WIL_BP_DISABLED;
+	spin_unlock_bh(&wil->bp_lock);
+}
+
+static int wil_busy_poll(struct napi_struct *napi)
+{
+	struct wil6210_priv *wil = container_of(napi, struct wil6210_priv,
+						napi_rx);
+	int quota = WIL_BP_BUDGET;
+	int done;
+
+	if (!test_bit(wil_status_napi_en, &wil->status))
+		return LL_FLUSH_FAILED;
+
+	if (!wil_bp_lock_poll(wil))
+		return LL_FLUSH_BUSY;
+
+	wil_rx_handle(wil, &quota);
+	done = WIL_BP_BUDGET - quota;
+
+	wil_bp_unlock_poll(wil);
+
+	if (done)
+		wil->bp_stats.hits += done;
+	else
+		wil->bp_stats.misses++;
+
+	return done;
+}
+
+void wil_busy_poll_enable(struct wil6210_priv *wil)
+{
+	spin_lock_bh(&wil->bp_lock);
+	wil->bp_state = WIL_BP_IDLE;
+	spin_unlock_bh(&wil->bp_lock);
+}
+
+/* wait for busy poller to leave, and keep it out */
+void wil_busy_poll_disable(struct wil6210_priv *wil)
+{
+	for (;;) {
+		spin_lock_bh(&wil->bp_lock);
+		if (!(wil->bp_state & WIL_BP_POLL)) {
+			wil->bp_state |= WIL_BP_DISABLED;
+			spin_unlock_bh(&wil->bp_lock);
+			break;
+		}
+		spin_unlock_bh(&wil->bp_lock);
+		usleep_range(100, 200);
+	}
+}
+#else /* CONFIG_NET_RX_BUSY_POLL */
+static inline bool wil_bp_lock_napi(struct wil6210_priv *wil)
+{
+	return true;
+}
+
+static inline void wil_bp_unlock_napi(struct wil6210_priv *wil)
+{
+}
+
+void wil_busy_poll_enable(struct wil6210_priv *wil)
+{
+}
+
+void wil_busy_poll_disable(struct wil6210_priv *wil)
+{
+}
+#endif /* CONFIG_NET_RX_BUSY_POLL */
+
 static const struct net_device_ops wil_netdev_ops = {
 	.ndo_open		= wil_open,
 	.ndo_stop		= wil_stop,
@@ -59,7 +217,10 @@ static const struct net_device_ops wil_netdev_ops = {
 	.ndo_set_mac_address	= eth_mac_addr,
 	.ndo_validate_addr	= eth_validate_addr,
 	.ndo_fix_features       = wil_fix_features,
-	.ndo_set_features       = wil_set_features
+	.ndo_set_features       = wil_set_features,
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	.ndo_busy_poll		= wil_busy_poll,
+#endif
 };
 
 static int wil6210_netdev_poll_rx(struct napi_struct *napi, int budget)
@@ -69,11 +230,17 @@ static int wil6210_netdev_poll_rx(struct napi_struct *napi, int budget)
 	int quota = budget;
 	int done;
 
+	if (!wil_bp_lock_napi(wil))
+		return budget; /* busy poll owns Rx, poll again */
+
 	wil_rx_handle(wil, &quota);
 	done = budget - quota;
 
+	wil_bp_unlock_napi(wil);
+
 	if (done <= 1) { /* burst ends - only one packet processed */
 		napi_complete(napi);
+		wil6210_itr_update(wil);
 		wil6210_unmask_irq_rx(wil);
 		wil_dbg_txrx(wil, "NAPI RX complete\n");
 	}
@@ -83,23 +250,193 @@ static int wil6210_netdev_poll_rx(struct napi_struct *napi, int budget)
 	return done;
 }
 
-static int wil6210_netdev_poll_tx(struct napi_struct *napi, int budget)
+/*
+ * Reap Tx completions on all vrings.
+ * Stop once @budget exceeded, unless @budget is 0;
+ * next call starts from the vring where this one stopped
+ */
+static int wil6210_tx_reap(struct wil6210_priv *wil, int budget)
 {
-	struct wil6210_priv *wil = container_of(napi, struct wil6210_priv,
-						napi_tx);
 	int tx_done = 0;
-	uint i;
+	uint i, ringid;
 
-	/* always process ALL Tx complete, regardless budget - it is fast */
+	spin_lock(&wil->tx_reap_lock);
 	for (i = 0; i < WIL6210_MAX_TX_RINGS; i++) {
-		struct vring *vring = &wil->vring_tx[i];
+		ringid = (wil->tx_reap_next + i) % WIL6210_MAX_TX_RINGS;
+		if (!wil->vring_tx[ringid].va)
+			continue;
+
+		tx_done += wil_tx_complete(wil, ringid);
+		if (budget && tx_done >= budget) {
+			wil->tx_reap_next = (ringid + 1) % WIL6210_MAX_TX_RINGS;
+			break;
+		}
+	}
+	spin_unlock(&wil->tx_reap_lock);
 
-		if (!vring->va)
+	return tx_done;
+}
+
+/*
+ * Combined poll: Tx completions reaped first, then Rx within
+ * what's left of the budget. Both Tx and Rx IRQs stay masked
+ * until the burst ends.
+ *
+ * Returns true if burst ends; @done set to amount of work done
+ */
+static bool wil6210_poll_rx_tx(struct wil6210_priv *wil, int budget,
+			       int *done)
+{
+	int tx_done, rx_done;
+	int quota;
+
+	tx_done = min(wil6210_tx_reap(wil, budget), budget);
+	quota = budget - tx_done;
+	if (quota) {
+		if (!wil_bp_lock_napi(wil)) {
+			/* busy poll owns Rx, poll again */
+			*done = budget;
+			return false;
+		}
+		wil_rx_handle(wil, &quota);
+		wil_bp_unlock_napi(wil);
+	}
+	rx_done = budget - tx_done - quota;
+
+	wil_dbg_txrx(wil, "RX/TX poll(%d) done %d + %d\n", budget,
+		     tx_done, rx_done);
+
+	*done = tx_done + rx_done;
+
+	return (tx_done <= 1) && (rx_done <= 1);
+}
+
+static void wil6210_poll_rx_tx_complete(struct wil6210_priv *wil)
+{
+	wil6210_itr_update(wil);
+	wil6210_unmask_irq_tx(wil);
+	wil6210_unmask_irq_rx(wil);
+	wil_dbg_txrx(wil, "RX/TX poll complete\n");
+}
+
+static int wil6210_netdev_poll_rx_tx(struct napi_struct *napi, int budget)
+{
+	struct wil6210_priv *wil = container_of(napi, struct wil6210_priv,
+						napi_rx);
+	int done;
+
+	if (wil6210_poll_rx_tx(wil, budget, &done)) {
+		napi_complete(napi);
+		wil6210_poll_rx_tx_complete(wil);
+	}
+
+	return done;
+}
+
+/*
+ * Poll thread - same work as combined NAPI poll, in process context
+ * with configurable scheduling. Packets handed to the stack with BH
+ * disabled, as they would be from NAPI.
+ */
+static int wil6210_poll_thread(void *arg)
+{
+	struct wil6210_priv *wil = arg;
+	bool end;
+	int done;
+
+	while (!kthread_should_stop()) {
+		wait_event_interruptible(wil->poll_wq,
+					 test_bit(0, &wil->poll_sched) ||
+					 kthread_should_stop());
+		if (!test_and_clear_bit(0, &wil->poll_sched))
 			continue;
 
-		tx_done += wil_tx_complete(wil, i);
+		do {
+			local_bh_disable();
+			end = wil6210_poll_rx_tx(wil, WIL6210_NAPI_BUDGET,
+						 &done);
+			local_bh_enable();
+			if (!end)
+				cond_resched();
+		} while (!end && !kthread_should_stop());
+
+		wil6210_poll_rx_tx_complete(wil);
+	}
+
+	return 0;
+}
+
+/* called from IRQ, with Rx (and Tx) IRQ masked */
+void wil6210_poll_thread_wake(struct wil6210_priv *wil)
+{
+	set_bit(0, &wil->poll_sched);
+	wake_up(&wil->poll_wq);
+}
+
+int wil6210_poll_thread_start(struct wil6210_priv *wil)
+{
+	struct net_device *ndev = wil_to_ndev(wil);
+	struct sched_param param = {
+		.sched_priority = poll_thread_prio,
+	};
+	struct task_struct *t;
+	int rc;
+
+	if (!wil->poll_threaded)
+		return 0;
+
+	/* IRQ may have come, and left Rx masked, while no one polled */
+	set_bit(0, &wil->poll_sched);
+	t = kthread_create(wil6210_poll_thread, wil, "%s-poll", ndev->name);
+	if (IS_ERR(t)) {
+		wil_err(wil, "Failed to create poll thread: %ld\n",
+			PTR_ERR(t));
+		return PTR_ERR(t);
+	}
+
+	if (poll_thread_policy == SCHED_NORMAL)
+		param.sched_priority = 0;
+	rc = sched_setscheduler(t, poll_thread_policy, &param);
+	if (rc)
+		wil_err(wil, "Poll thread: policy %d prio %d failed: %d\n",
+			poll_thread_policy, poll_thread_prio, rc);
+
+	if (poll_thread_cpu >= 0) {
+		if (poll_thread_cpu < nr_cpu_ids && cpu_online(poll_thread_cpu))
+			kthread_bind(t, poll_thread_cpu);
+		else
+			wil_err(wil, "Poll thread: CPU %d is offline\n",
+				poll_thread_cpu);
 	}
 
+	WRITE_ONCE(wil->poll_task, t);
+	wake_up_process(t);
+
+	return 0;
+}
+
+void wil6210_poll_thread_stop(struct wil6210_priv *wil)
+{
+	struct task_struct *t = wil->poll_task;
+
+	if (!t)
+		return;
+
+	WRITE_ONCE(wil->poll_task, NULL);
+	/* IRQ handler that still sees the thread is done with it */
+	wil6210_synchronize_irq(wil);
+	kthread_stop(t);
+}
+
+static int wil6210_netdev_poll_tx(struct napi_struct *napi, int budget)
+{
+	struct wil6210_priv *wil = container_of(napi, struct wil6210_priv,
+						napi_tx);
+	int tx_done;
+
+	/* always process ALL Tx complete, regardless budget - it is fast */
+	tx_done = wil6210_tx_reap(wil, 0);
+
 	if (tx_done <= 1) { /* burst ends - only one packet processed */
 		napi_complete(napi);
 		wil6210_unmask_irq_tx(wil);
@@ -155,10 +492,19 @@ void *wil_if_alloc(struct device *dev, void __iomem *csr)
 	SET_NETDEV_DEV(ndev, wiphy_dev(wdev->wiphy));
 	wdev->netdev = ndev;
 
-	netif_napi_add(ndev, &wil->napi_rx, wil6210_netdev_poll_rx,
+	init_waitqueue_head(&wil->poll_wq);
+	wil->poll_threaded = poll_thread;
+	wil->combined_poll = combined_poll || poll_thread;
+	netif_napi_add(ndev, &wil->napi_rx, wil->combined_poll ?
+		       wil6210_netdev_poll_rx_tx : wil6210_netdev_poll_rx,
 		       WIL6210_NAPI_BUDGET);
 	netif_napi_add(ndev, &wil->napi_tx, wil6210_netdev_poll_tx,
 		       WIL6210_NAPI_BUDGET);
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	spin_lock_init(&wil->bp_lock);
+	wil->bp_state = WIL_BP_DISABLED;
+	napi_hash_add(&wil->napi_rx);
+#endif
 
 	wil_link_off(wil);
 
@@ -179,8 +525,13 @@ void wil_if_free(struct wil6210_priv *wil)
 	if (!ndev)
 		return;
 
-	free_netdev(ndev);
+	/* disconnect and WMI call flush report to cfg80211 via @ndev */
 	wil_priv_deinit(wil);
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	napi_hash_del(&wil->napi_rx);
+	synchronize_rcu(); /* busy poll looks up NAPI under RCU */
+#endif
+	free_netdev(ndev);
 	wil_wdev_free(wil);
 }
 
@@ -83,7 +83,7 @@ out_stop:
 
 int wil_prepare_roc(struct wil6210_priv *wil, struct ieee80211_channel *chan,
 		    const u8 *buf, size_t len, unsigned int duration,
-		    u64 *cookie)
+		    bool no_ack, u64 *cookie)
 {
 	struct wil_roc *roc = &wil->roc;
 	int rc = 0;
@@ -104,27 +104,23 @@ int wil_prepare_roc(struct wil6210_priv *wil, struct ieee80211_channel *chan,
 	if (!duration && !buf)
 		duration = 10;
 
-	wil->roc_counter++;
-	roc->cookie = wil->roc_counter;
-	if (WARN_ON(roc->cookie == 0)) {
-		roc->cookie = 1;
-		wil->roc_counter++;
-	}
+	roc->cookie = wil_cookie_alloc(wil);
 
 	roc->chan = chan;
 	roc->duration = duration;
 	if (buf) {
 		roc->buf = buf;
 		roc->len = len;
-		roc->mgmt_tx_cookie = (unsigned long)buf;
+		roc->mgmt_tx_cookie = wil_cookie_alloc(wil);
 	} else {
 		roc->mgmt_tx_cookie = 0;
 	}
 	rc = wil_start_roc(wil);
 	if (roc->mgmt_tx_cookie) {
 		*cookie = roc->mgmt_tx_cookie;
-		cfg80211_mgmt_tx_status(wil->wdev, *cookie, buf, len,
-					rc == 0, GFP_KERNEL);
+		if (!no_ack)
+			cfg80211_mgmt_tx_status(wil->wdev, *cookie, buf, len,
+						rc == 0, GFP_KERNEL);
 	}
 	if (rc == 0) {
 		if (!roc->mgmt_tx_cookie) {
@@ -21,11 +21,12 @@
 
 #include "wil6210.h"
 
-static int use_msi = 1;
+static int use_msi = 3;
 module_param(use_msi, int, S_IRUGO);
 MODULE_PARM_DESC(use_msi,
 		 " Use MSI interrupt: "
-		 "0 - don't, 1 - (default) - single, or 3");
+		 "0 - don't, 1 - single, or 3 - (default) separate Tx, Rx"
+		 " and Misc; falls back to 1");
 
 static bool debug_fw = false;
 module_param(debug_fw, bool, S_IRUGO);
@@ -49,9 +50,9 @@ static int wil_if_pcie_enable(struct wil6210_priv *wil)
 	case 0:
 		break;
 	default:
-		wil_err(wil, "Invalid use_msi=%d, default to 1\n",
+		wil_err(wil, "Invalid use_msi=%d, default to 3\n",
 			use_msi);
-		use_msi = 1;
+		use_msi = 3;
 	}
 	wil->n_msi = use_msi;
 	if (wil->n_msi) {
@@ -71,6 +72,17 @@ static int wil_if_pcie_enable(struct wil6210_priv *wil)
 	}
 
 	rc = wil6210_init_irq(wil, pdev->irq);
+	if (rc && (wil->n_msi == 3)) {
+		wil_err(wil, "3 MSI IRQ request failed, try 1 MSI\n");
+		pci_disable_msi(pdev);
+		wil->n_msi = 1;
+		rc = pci_enable_msi_block(pdev, wil->n_msi);
+		if (rc) {
+			wil_err(wil, "pci_enable_msi failed, use INTx\n");
+			wil->n_msi = 0;
+		}
+		rc = wil6210_init_irq(wil, pdev->irq);
+	}
 	if (rc)
 		goto stop_master;
 
@@ -1,6 +1,35 @@
+#include <linux/moduleparam.h>
+
 #include "wil6210.h"
 #include "txrx.h"
 
+static uint rx_agg_wsize = 16;
+module_param(rx_agg_wsize, uint, S_IRUGO);
+MODULE_PARM_DESC(rx_agg_wsize,
+		 " Max. Rx BACK window to accept, 0 - no aggregation, default - 16");
+
+static bool rx_agg_amsdu;
+module_param(rx_agg_amsdu, bool, S_IRUGO);
+MODULE_PARM_DESC(rx_agg_amsdu, " Accept A-MSDU within A-MPDU, default - no");
+
+static uint rx_agg_timeout;
+module_param(rx_agg_timeout, uint, S_IRUGO);
+MODULE_PARM_DESC(rx_agg_timeout,
+		 " Rx BACK timeout (TU) to respond with, default - 0 (peer's one)");
+
+static uint rx_reorder_budget = 1024;
+module_param(rx_reorder_budget, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rx_reorder_budget,
+		 " Total reorder slots for all Rx BACK sessions, 0 - unlimited");
+
+/*
+ * reorder slots in use by all the Rx BACK sessions, all devices.
+ * Only published contexts are counted; the per-station pools of idle
+ * contexts are excluded, they are bounded by WIL_STA_BACK_POOL per
+ * station and charged when taken for a session
+ */
+static atomic_t reorder_slots = ATOMIC_INIT(0);
+
 #define SEQ_MODULO 0x1000
 #define SEQ_MASK   0xfff
 
@@ -24,50 +53,57 @@ static inline int reorder_index(struct wil_tid_ampdu_rx *r, u16 seq)
 	return seq_sub(seq, r->ssn) % r->buf_size;
 }
 
-static void wil_release_reorder_frame(struct wil6210_priv *wil,
-				      struct wil_tid_ampdu_rx *r,
-				      int index)
+/* returns number of frames passed to the stack, 0 or 1 */
+static int wil_release_reorder_frame(struct wil6210_priv *wil,
+				     struct wil_tid_ampdu_rx *r,
+				     int index)
 {
 	struct net_device *ndev = wil_to_ndev(wil);
 	struct sk_buff *skb = r->reorder_buf[index];
 
+	r->head_seq_num = seq_inc(r->head_seq_num);
 	if (!skb)
-		goto no_frame;
+		return 0;
 
 	/* release the frame from the reorder ring buffer */
 	r->stored_mpdu_num--;
 	r->reorder_buf[index] = NULL;
 	wil_netif_rx_any(skb, ndev);
 
-no_frame:
-	r->head_seq_num = seq_inc(r->head_seq_num);
-
+	return 1;
 }
 
-static void wil_release_reorder_frames(struct wil6210_priv *wil,
-				       struct wil_tid_ampdu_rx *r,
-				       u16 hseq)
+static int wil_release_reorder_frames(struct wil6210_priv *wil,
+				      struct wil_tid_ampdu_rx *r,
+				      u16 hseq)
 {
-	int index;
+	int index, n = 0;
 
 	while (seq_less(r->head_seq_num, hseq)) {
 		index = reorder_index(r, r->head_seq_num);
-		wil_release_reorder_frame(wil, r, index);
+		n += wil_release_reorder_frame(wil, r, index);
 	}
 
+	return n;
 }
 
-static void wil_reorder_release(struct wil6210_priv *wil,
-				struct wil_tid_ampdu_rx *r)
+static int wil_reorder_release(struct wil6210_priv *wil,
+			       struct wil_tid_ampdu_rx *r)
 {
 	int index = reorder_index(r, r->head_seq_num);
+	int n = 0;
 
 	while (r->reorder_buf[index]) {
-		wil_release_reorder_frame(wil, r, index);
+		n += wil_release_reorder_frame(wil, r, index);
 		index = reorder_index(r, r->head_seq_num);
 	}
+
+	return n;
 }
 
+/*
+ * Runs in the Rx NAPI context, that is the only user of the reorder state
+ */
 void wil_rx_reorder(struct wil6210_priv *wil, struct sk_buff *skb)
 {
 	struct net_device *ndev = wil_to_ndev(wil);
@@ -77,22 +113,23 @@ void wil_rx_reorder(struct wil6210_priv *wil, struct sk_buff *skb)
 	int mid = wil_rxdesc_mid(d);
 	u16 seq = wil_rxdesc_seq(d);
 	struct wil_sta_info *sta = &wil->sta[cid];
-	struct wil_tid_ampdu_rx *r = sta->tid_rx[tid];
+	struct wil_tid_ampdu_rx *r;
 	u16 hseq;
 	int index;
 
 	wil_dbg_txrx(wil, "MID %d CID %d TID %d Seq 0x%03x\n",
 		     mid, cid, tid, seq);
 
+	rcu_read_lock();
+
+	r = rcu_dereference(sta->tid_rx[tid]);
 	if (!r) {
 		wil_netif_rx_any(skb, ndev);
-		return;
+		goto out;
 	}
 
 	hseq = r->head_seq_num;
 
-	spin_lock(&r->reorder_lock);
-
 	/* frame with out of date sequence number */
 	if (seq_less(seq, r->head_seq_num)) {
 		r->ssn_last_drop = seq;
@@ -139,7 +176,47 @@ void wil_rx_reorder(struct wil6210_priv *wil, struct sk_buff *skb)
 	wil_reorder_release(wil, r);
 
 out:
-	spin_unlock(&r->reorder_lock);
+	rcu_read_unlock();
+}
+
+/*
+ * Process BAR with starting sequence number @seq:
+ * frames preceding @seq are released to the stack, as well as
+ * in-order frames following it. Returns number of frames released
+ */
+int wil_rx_bar(struct wil6210_priv *wil, u8 cid, u8 tid, u16 seq)
+{
+	struct wil_sta_info *sta = &wil->sta[cid];
+	struct wil_tid_ampdu_rx *r;
+	int n = 0;
+
+	sta->stats.rx_bar++;
+
+	rcu_read_lock();
+
+	r = rcu_dereference(sta->tid_rx[tid]);
+	if (!r) {
+		wil_dbg_txrx(wil, "BAR for non-existing CID %d TID %d\n",
+			     cid, tid);
+		goto out;
+	}
+
+	if (seq_less(seq, r->head_seq_num)) {
+		sta->stats.rx_bar_old++;
+		wil_dbg_txrx(wil, "BAR Seq 0x%03x preceding head 0x%03x\n",
+			     seq, r->head_seq_num);
+		goto out;
+	}
+
+	wil_dbg_txrx(wil, "BAR: CID %d TID %d Seq 0x%03x head 0x%03x\n",
+		     cid, tid, seq, r->head_seq_num);
+	n = wil_release_reorder_frames(wil, r, seq);
+	n += wil_reorder_release(wil, r);
+
+out:
+	rcu_read_unlock();
+
+	return n;
 }
 
 struct wil_tid_ampdu_rx *wil_tid_ampdu_rx_alloc(struct wil6210_priv *wil,
@@ -160,26 +237,269 @@ struct wil_tid_ampdu_rx *wil_tid_ampdu_rx_alloc(struct wil6210_priv *wil,
 		return NULL;
 	}
 
-	spin_lock_init(&r->reorder_lock);
 	r->ssn = ssn;
 	r->head_seq_num = ssn;
 	r->buf_size = size;
 	r->stored_mpdu_num = 0;
+	r->wil = wil;
 	return r;
 }
 
-void wil_tid_ampdu_rx_free(struct wil6210_priv *wil,
-			   struct wil_tid_ampdu_rx *r)
+static void wil_tid_ampdu_rx_destroy(struct wil_tid_ampdu_rx *r)
 {
-	if (!r)
-		return;
-	wil_release_reorder_frames(wil, r, r->head_seq_num + r->buf_size);
 	kfree(r->reorder_buf);
 	kfree(r->reorder_time);
 	kfree(r);
 }
+
+static void wil_tid_ampdu_rx_free(struct wil_tid_ampdu_rx *r)
+{
+	atomic_sub(r->buf_size, &reorder_slots);
+	wil_tid_ampdu_rx_destroy(r);
+}
+
+/*
+ * RCU callback for the unpublished context, see wil_tid_ampdu_rx_set().
+ * Rx path let go of it by now. Frames still buffered go to the stack
+ * from the Rx poll, as the rest of Rx: stats are not atomic
+ */
+static void wil_tid_ampdu_rx_retire(struct rcu_head *head)
+{
+	struct wil_tid_ampdu_rx *r = container_of(head,
+						  struct wil_tid_ampdu_rx, rcu);
+	struct wil6210_priv *wil = r->wil;
+
+	if (!r->stored_mpdu_num) {
+		wil_tid_ampdu_rx_free(r);
+		return;
+	}
+
+	spin_lock(&wil->tid_rx_lock);
+	list_add_tail(&r->retired, &wil->rx_reorder_retired);
+	spin_unlock(&wil->tid_rx_lock);
+
+	wil6210_schedule_rx(wil);
+}
+
+static int __wil_rx_reorder_flush(struct wil6210_priv *wil, bool drop)
+{
+	struct net_device *ndev = wil_to_ndev(wil);
+	struct wil_tid_ampdu_rx *r, *t;
+	LIST_HEAD(retired);
+	int i, n = 0;
+
+	spin_lock_bh(&wil->tid_rx_lock);
+	list_splice_init(&wil->rx_reorder_retired, &retired);
+	spin_unlock_bh(&wil->tid_rx_lock);
+
+	list_for_each_entry_safe(r, t, &retired, retired) {
+		list_del(&r->retired);
+		if (!drop) {
+			n += wil_release_reorder_frames(wil, r,
+							r->head_seq_num +
+							r->buf_size);
+		} else {
+			for (i = 0; i < r->buf_size; i++) {
+				if (!r->reorder_buf[i])
+					continue;
+				kfree_skb(r->reorder_buf[i]);
+				ndev->stats.rx_dropped++;
+			}
+		}
+		wil_tid_ampdu_rx_free(r);
+	}
+
+	return n;
+}
+
+/*
+ * Release frames of the torn down sessions, in order.
+ * Called from the Rx poll; returns number of frames released
+ */
+int wil_rx_reorder_flush(struct wil6210_priv *wil)
+{
+	if (list_empty(&wil->rx_reorder_retired))
+		return 0;
+
+	return __wil_rx_reorder_flush(wil, false);
+}
+
+/*
+ * Drop frames of the torn down sessions, with Rx poll stopped.
+ * Sessions torn down before are all retired on return; may sleep
+ */
+void wil_rx_reorder_purge(struct wil6210_priv *wil)
+{
+	rcu_barrier();
+	__wil_rx_reorder_flush(wil, true);
+}
+
+/**
+ * wil_tid_ampdu_rx_set - publish reorder context for the @tid
+ * @r: new context, may be NULL to tear down the session
+ *
+ * Previous context, if any, is freed after RCU grace period; frames
+ * it buffered are released by the Rx poll. Does not wait for either
+ */
+void wil_tid_ampdu_rx_set(struct wil6210_priv *wil, struct wil_sta_info *sta,
+			  int tid, struct wil_tid_ampdu_rx *r)
+{
+	struct wil_tid_ampdu_rx *old;
+
+	/* reorder budget accounts published contexts only */
+	if (r)
+		atomic_add(r->buf_size, &reorder_slots);
+
+	spin_lock_bh(&wil->tid_rx_lock);
+	old = rcu_dereference_protected(sta->tid_rx[tid],
+					lockdep_is_held(&wil->tid_rx_lock));
+	rcu_assign_pointer(sta->tid_rx[tid], r);
+	spin_unlock_bh(&wil->tid_rx_lock);
+
+	if (old)
+		call_rcu(&old->rcu, wil_tid_ampdu_rx_retire);
+}
+
+/**
+ * wil_reorder_budget - report reorder slots budget
+ * @used: store number of slots in use here
+ *
+ * Return budget, 0 if unlimited
+ */
+int wil_reorder_budget(int *used)
+{
+	*used = atomic_read(&reorder_slots);
+	return rx_reorder_budget;
+}
+
 /* ADDBA processing */
 
+void wil_back_policy_init(struct wil6210_priv *wil)
+{
+	int i;
+	u16 wsize = min_t(uint, rx_agg_wsize, WIL_MAX_AGG_WSIZE);
+
+	for (i = 0; i < WIL_STA_TID_NUM; i++) {
+		struct wil_back_policy *p = &wil->back_policy[i];
+
+		p->agg_wsize = wsize;
+		p->agg_timeout = rx_agg_timeout;
+		p->agg_amsdu = rx_agg_amsdu;
+	}
+}
+
+/*
+ * Window size to agree on for the @tid, taking into account
+ * per-TID policy and remaining reorder budget.
+ * When many sessions are active, new ones get smaller windows;
+ * the budget is soft - window never shrinks below WIL_MIN_AGG_WSIZE.
+ */
+static u16 wil_agg_size(struct wil6210_priv *wil, int tid, u16 req_wsize)
+{
+	u16 max_wsize = wil->back_policy[tid].agg_wsize;
+	int budget = rx_reorder_budget;
+	int avail = budget - atomic_read(&reorder_slots);
+	u16 wsize;
+
+	if (!max_wsize)
+		return 0;
+
+	/* 0 in request means "no preference" */
+	wsize = req_wsize ? min(req_wsize, max_wsize) : max_wsize;
+
+	if (budget && avail < wsize)
+		wsize = max_t(int, avail, min_t(u16, wsize, WIL_MIN_AGG_WSIZE));
+
+	return wsize;
+}
+
+/*
+ * Preallocate reorder contexts for the station, sized for the largest
+ * window policy allows, so ADDBA handling need not allocate memory.
+ * Pooled contexts are not charged against rx_reorder_budget
+ */
+void wil_back_pool_fill(struct wil6210_priv *wil, int cid)
+{
+	struct wil_sta_info *sta = &wil->sta[cid];
+	u16 wsize = 0;
+	int i;
+
+	for (i = 0; i < WIL_STA_TID_NUM; i++)
+		wsize = max(wsize, wil->back_policy[i].agg_wsize);
+	if (!wsize)
+		return;
+
+	for (i = 0; i < WIL_STA_BACK_POOL; i++) {
+		struct wil_tid_ampdu_rx *r;
+
+		if (sta->back_pool[i])
+			continue;
+		r = wil_tid_ampdu_rx_alloc(wil, wsize, 0);
+		if (!r)
+			break;
+
+		spin_lock_bh(&wil->tid_rx_lock);
+		/* don't refill for station being disconnected */
+		if (!sta->back_pool[i] && sta->status == wil_sta_connected) {
+			sta->back_pool[i] = r;
+			r = NULL;
+		}
+		spin_unlock_bh(&wil->tid_rx_lock);
+
+		if (r)
+			wil_tid_ampdu_rx_destroy(r);
+	}
+}
+
+void wil_back_pool_drain(struct wil6210_priv *wil, int cid)
+{
+	struct wil_sta_info *sta = &wil->sta[cid];
+	struct wil_tid_ampdu_rx *pool[WIL_STA_BACK_POOL];
+	int i;
+
+	spin_lock_bh(&wil->tid_rx_lock);
+	for (i = 0; i < WIL_STA_BACK_POOL; i++) {
+		pool[i] = sta->back_pool[i];
+		sta->back_pool[i] = NULL;
+	}
+	spin_unlock_bh(&wil->tid_rx_lock);
+
+	for (i = 0; i < WIL_STA_BACK_POOL; i++)
+		if (pool[i])
+			wil_tid_ampdu_rx_destroy(pool[i]);
+}
+
+/*
+ * Get reorder context for window @size - from the station's pool,
+ * if there is large enough one, or allocate new one
+ */
+static struct wil_tid_ampdu_rx *wil_back_get_ctx(struct wil6210_priv *wil,
+						 struct wil_sta_info *sta,
+						 int size, u16 ssn)
+{
+	struct wil_tid_ampdu_rx *r = NULL;
+	int i;
+
+	spin_lock_bh(&wil->tid_rx_lock);
+	for (i = 0; i < WIL_STA_BACK_POOL; i++) {
+		if (sta->back_pool[i] && sta->back_pool[i]->buf_size >= size) {
+			r = sta->back_pool[i];
+			sta->back_pool[i] = NULL;
+			break;
+		}
+	}
+	spin_unlock_bh(&wil->tid_rx_lock);
+
+	if (!r)
+		return wil_tid_ampdu_rx_alloc(wil, size, ssn);
+
+	/* never used, buffers are clean */
+	r->ssn = ssn;
+	r->head_seq_num = ssn;
+	r->buf_size = size;
+	return r;
+}
+
 int wil_rcp_addba_request(struct wil6210_priv *wil, u8 cidxtid,
 			  u8 dialog_token, __le16 ba_param_set,
 			  __le16 ba_timeout, __le16 ba_seq_ctrl)
@@ -188,6 +508,7 @@ int wil_rcp_addba_request(struct wil6210_priv *wil, u8 cidxtid,
 	if (!req)
 		return -ENOMEM;
 
+	req->t_req = ktime_get();
 	req->cidxtid = cidxtid;
 	req->dialog_token = dialog_token;
 	req->ba_param_set = le16_to_cpu(ba_param_set);
@@ -198,18 +519,26 @@ int wil_rcp_addba_request(struct wil6210_priv *wil, u8 cidxtid,
 	list_add_tail(&req->list, &wil->back_pending);
 	mutex_unlock(&wil->back_mutex);
 
-wil_err(wil, "EREZK !!! wil_rcp_addba_request: param %x", req->ba_param_set);
 	queue_work(wil->back_wq, &wil->back_worker);
 
 	return 0;
 }
 
+/*
+ * Response is not waited for: reorder context published before
+ * the response sent, so frames following the agreement are reordered.
+ * Firmware confirms with WMI_ADDBA_RESP_SENT_EVENTID, see
+ * wil_addba_resp_sent()
+ */
 static void wil_back_handle(struct wil6210_priv *wil,
 			    struct wil_pending_back *req)
 {
 	u8 cid, tid;
 	u16 req_agg_wsize;
+	u16 status = WLAN_STATUS_SUCCESS;
 	struct wil_sta_info *sta;
+	struct wil_back_policy *policy;
+	struct wil_tid_ampdu_rx *r = NULL;
 	int rc;
 
 	parse_cidxtid(req->cidxtid, &cid, &tid);
@@ -226,28 +555,82 @@ static void wil_back_handle(struct wil6210_priv *wil,
 	}
 	req_agg_wsize = WIL_GET_BITS(req->ba_param_set, 6, 15);
 
-wil_err(wil, "EREZK !!! wil_rcp_addba_request: cid %x, tid %x, req_agg_wsize %d", cid, tid, req_agg_wsize);
-
-
 	wil_dbg_wmi(wil, "ADDBA request for CID %d %pM TID %d size %d\n",
 		    cid, sta->addr, tid, req_agg_wsize);
 
 	/* apply policies */
-	req->agg_timeout = req->ba_timeout;
-	req->agg_wsize = min_t(u16, 16, req_agg_wsize);
+	policy = &wil->back_policy[tid];
+	req->agg_timeout = policy->agg_timeout ? : req->ba_timeout;
+	req->agg_wsize = wil_agg_size(wil, tid, req_agg_wsize);
 	req->agg_policy = 1;
-	req->agg_amsdu = 0;
+	req->agg_amsdu = policy->agg_amsdu && (req->ba_param_set & BIT(0));
+
+	if (req->agg_wsize) {
+		r = wil_back_get_ctx(wil, sta, req->agg_wsize,
+				     req->ba_seq_ctrl >> 4);
+		if (r) {
+			r->timeout = req->agg_timeout;
+			r->amsdu = req->agg_amsdu;
+			r->dialog_token = req->dialog_token;
+		} else {
+			status = WLAN_STATUS_UNSPECIFIED_FAILURE;
+		}
+	} else {
+		status = WLAN_STATUS_REQUEST_DECLINED;
+	}
+
+	wil_dbg_wmi(wil, "ADDBA response for CID %d TID %d: status %d size %d"
+		    " timeout %d A-MSDU %d\n", cid, tid, status,
+		    req->agg_wsize, req->agg_timeout, req->agg_amsdu);
 
-	rc = wmi_rcp_addba_resp(wil, cid, tid, req->dialog_token, 0,
+	/* apply */
+	wil_tid_ampdu_rx_set(wil, sta, tid, r);
+
+	sta->addba_t_req[tid] = req->t_req;
+	rc = wmi_rcp_addba_resp(wil, cid, tid, req->dialog_token, status,
 				req->agg_amsdu, req->agg_wsize,
 				req->agg_timeout);
-	if (rc)
+	if (rc) {
+		sta->addba_t_req[tid] = ktime_set(0, 0);
+		if (r)
+			wil_tid_ampdu_rx_set(wil, sta, tid, NULL);
 		return;
+	}
+	wil_hist_add(&wil->back_lat_queued,
+		     ktime_to_us(ktime_sub(ktime_get(), req->t_req)));
 
-	/* apply */
-	wil_tid_ampdu_rx_free(wil, sta->tid_rx[tid]);
-	sta->tid_rx[tid] = wil_tid_ampdu_rx_alloc(wil, req->agg_wsize,
-						  req->ba_seq_ctrl >> 4);
+	/* replenish what was taken, off the critical path */
+	if (r)
+		wil_back_pool_fill(wil, cid);
+}
+
+/*
+ * Firmware reports ADDBA response transmitted
+ */
+void wil_addba_resp_sent(struct wil6210_priv *wil, u8 cidxtid, u16 status)
+{
+	u8 cid, tid;
+	struct wil_sta_info *sta;
+	ktime_t t_req;
+
+	parse_cidxtid(cidxtid, &cid, &tid);
+	if (cid >= WIL6210_MAX_CID) {
+		wil_err(wil, "ADDBA response sent: invalid CID %d\n", cid);
+		return;
+	}
+	sta = &wil->sta[cid];
+
+	t_req = sta->addba_t_req[tid];
+	sta->addba_t_req[tid] = ktime_set(0, 0);
+	if (ktime_to_ns(t_req))
+		wil_hist_add(&wil->back_lat_sent,
+			     ktime_to_us(ktime_sub(ktime_get(), t_req)));
+
+	if (status) {
+		wil_err(wil, "ADDBA response for CID %d TID %d failed: %d\n",
+			cid, tid, status);
+		wil_tid_ampdu_rx_set(wil, sta, tid, NULL);
+	}
 }
 
 void wil_back_flush(struct wil6210_priv *wil)
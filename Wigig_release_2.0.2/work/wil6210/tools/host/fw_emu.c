@@ -0,0 +1,630 @@
+/*
+ * Copyright (c) 2013 Qualcomm Atheros, Inc.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Firmware side of the WMI mailbox, see fw_emu.h
+ *
+ * Mailbox layout, in the FW data RAM (linker 0x800000 == AHB 0x900000):
+ *
+ *   AHB 0x900000  Tx ring descriptors, FW_EMU_TX_ENTRIES
+ *   AHB 0x900080  Rx ring descriptors, FW_EMU_RX_ENTRIES
+ *   0x801000      Tx buffers (linker address, as in the descriptors)
+ *   0x802000      Rx buffers
+ *
+ * Ring ownership follows the real firmware: FW advances tx.tail and
+ * rx.head, host - tx.head and rx.tail; descriptor @sync set by the
+ * producer, cleared by the consumer.
+ */
+#include "fw_emu.h"
+#include "wmi.h"
+
+#define FW_EMU_TX_ENTRIES	(16)
+#define FW_EMU_RX_ENTRIES	(32)
+#define FW_EMU_ENTRY_SIZE	(256)
+#define FW_EMU_RULES		(32)
+#define FW_EMU_MAX_CID		(WIL6210_MAX_CID)
+
+#define FW_DATA_LINKER		(0x800000)
+#define FW_DATA_AHB		(0x900000)
+#define FW_EMU_TX_RING		(FW_DATA_AHB)
+#define FW_EMU_RX_RING		(FW_DATA_AHB + 0x80)
+#define FW_EMU_TX_BUF		(FW_DATA_LINKER + 0x1000)
+#define FW_EMU_RX_BUF		(FW_DATA_LINKER + 0x2000)
+
+#define FW_EMU_VERSION		(0x0200)
+
+struct fw_emu {
+	void __iomem *bar;
+	void (*irq)(void *ctx, u32 isr);
+	void *irq_ctx;
+
+	pthread_t thread;
+	bool running;
+	volatile bool stop;
+	u32 spin_us;
+	u32 sleep_us;
+
+	pthread_mutex_t lock; /* rules, peers, Rx ring */
+	struct fw_emu_rule rules[FW_EMU_RULES];
+	uint n_rules;
+	u8 peers[FW_EMU_MAX_CID][ETH_ALEN];
+	bool peer_used[FW_EMU_MAX_CID];
+
+	u32 tx_tail; /* AHB */
+	u32 rx_head; /* AHB */
+	u16 seq;
+
+	struct fw_emu_stats stats;
+};
+
+/* BAR access; AHB address for registers and descriptors */
+static inline volatile u32 __iomem *fw_reg(struct fw_emu *fw, u32 ahb)
+{
+	return fw->bar + HOSTADDR(ahb);
+}
+
+static inline void __iomem *fw_buf(struct fw_emu *fw, u32 linker)
+{
+	return fw->bar + HOSTADDR(linker - FW_DATA_LINKER + FW_DATA_AHB);
+}
+
+#define MBOX_REG(fld) \
+	fw_reg(fw, RGF_USER_USER_SCRATCH_PAD + \
+	       offsetof(struct wil6210_mbox_ctl, fld))
+
+static u32 fw_now_us(void)
+{
+	return ktime_to_us(ktime_get());
+}
+
+/*=== replies ===*/
+
+static int fw_reply_echo(struct fw_emu *fw, u16 cmdid, const void *cmd,
+			 u16 len, void *evt, u16 room)
+{
+	const struct wmi_echo_cmd *c = cmd;
+	struct wmi_echo_event *e = evt;
+
+	e->echoed_value = len >= sizeof(*c) ? c->value : 0;
+
+	return sizeof(*e);
+}
+
+static int fw_reply_vring_cfg(struct fw_emu *fw, u16 cmdid, const void *cmd,
+			      u16 len, void *evt, u16 room)
+{
+	const struct wmi_vring_cfg_cmd *c = cmd;
+	struct wmi_vring_cfg_done_event *e = evt;
+
+	if (len < sizeof(*c))
+		return -EINVAL;
+
+	e->ringid = c->vring_cfg.ringid;
+	e->status = WMI_FW_STATUS_SUCCESS;
+	/* any valid register address will do */
+	e->tx_vring_tail_ptr = cpu_to_le32(0x881000 + 4 * e->ringid);
+
+	return sizeof(*e);
+}
+
+static int fw_reply_ba_en(struct fw_emu *fw, u16 cmdid, const void *cmd,
+			  u16 len, void *evt, u16 room)
+{
+	const struct wmi_vring_ba_en_cmd *c = cmd;
+	struct wmi_vring_ba_status_event *e = evt;
+
+	if (len < sizeof(*c))
+		return -EINVAL;
+
+	e->status = cpu_to_le16(WMI_BA_AGREED);
+	e->ringid = c->ringid;
+	e->agg_wsize = c->agg_max_wsize;
+	e->ba_timeout = c->ba_timeout;
+
+	return sizeof(*e);
+}
+
+static int fw_reply_connect(struct fw_emu *fw, u16 cmdid, const void *cmd,
+			    u16 len, void *evt, u16 room)
+{
+	static const u8 zero[ETH_ALEN];
+	const struct wmi_connect_cmd *c = cmd;
+	struct wmi_connect_event *e = evt;
+	const u8 *mac;
+	int cid;
+
+	if (len < sizeof(*c))
+		return -EINVAL;
+
+	mac = memcmp(c->bssid, zero, ETH_ALEN) ? c->bssid : c->dst_mac;
+	for (cid = 0; cid < FW_EMU_MAX_CID; cid++)
+		if (!fw->peer_used[cid])
+			break;
+	if (cid == FW_EMU_MAX_CID)
+		return -ENOSPC;
+
+	fw->peer_used[cid] = true;
+	memcpy(fw->peers[cid], mac, ETH_ALEN);
+
+	memset(e, 0, sizeof(*e));
+	e->channel = c->channel;
+	memcpy(e->bssid, mac, ETH_ALEN);
+	e->beacon_interval = cpu_to_le16(100);
+	e->network_type = c->network_type;
+	e->cid = cid;
+
+	return sizeof(*e);
+}
+
+static int fw_disconnect(struct fw_emu *fw, const u8 *mac, void *evt)
+{
+	struct wmi_disconnect_event *e = evt;
+	int cid;
+
+	for (cid = 0; cid < FW_EMU_MAX_CID; cid++) {
+		if (!fw->peer_used[cid])
+			continue;
+		if (mac && memcmp(fw->peers[cid], mac, ETH_ALEN))
+			continue;
+		break;
+	}
+	if (cid == FW_EMU_MAX_CID)
+		return -ENOENT;
+
+	fw->peer_used[cid] = false;
+
+	memset(e, 0, sizeof(*e));
+	memcpy(e->bssid, fw->peers[cid], ETH_ALEN);
+	e->disconnect_reason = WMI_DIS_REASON_DISCONNECT_CMD;
+
+	return sizeof(*e);
+}
+
+static int fw_reply_disconnect(struct fw_emu *fw, u16 cmdid, const void *cmd,
+			       u16 len, void *evt, u16 room)
+{
+	return fw_disconnect(fw, NULL, evt);
+}
+
+static int fw_reply_disconnect_sta(struct fw_emu *fw, u16 cmdid,
+				   const void *cmd, u16 len, void *evt,
+				   u16 room)
+{
+	const struct wmi_disconnect_sta_cmd *c = cmd;
+
+	if (len < sizeof(*c))
+		return -EINVAL;
+
+	return fw_disconnect(fw, c->dst_mac, evt);
+}
+
+static int fw_reply_status(struct fw_emu *fw, u16 cmdid, const void *cmd,
+			   u16 len, void *evt, u16 room)
+{
+	/* u8 status first; SW_TX_COMPLETE, PCP_STARTED, ... */
+	struct wmi_sw_tx_complete_event *e = evt;
+
+	memset(e, 0, sizeof(*e));
+
+	return sizeof(*e);
+}
+
+static int fw_reply_notify(struct fw_emu *fw, u16 cmdid, const void *cmd,
+			   u16 len, void *evt, u16 room)
+{
+	struct wmi_notify_req_done_event *e = evt;
+
+	memset(e, 0, sizeof(*e));
+	e->tsf = cpu_to_le64(fw_now_us());
+	e->snr_val = cpu_to_le32(20);
+	e->tx_tpt = cpu_to_le32(1000);
+	e->tx_goodput = cpu_to_le32(900);
+	e->rx_goodput = cpu_to_le32(900);
+	e->bf_mcs = cpu_to_le16(8);
+	e->sqi = 80;
+
+	return sizeof(*e);
+}
+
+static int fw_reply_temp(struct fw_emu *fw, u16 cmdid, const void *cmd,
+			 u16 len, void *evt, u16 room)
+{
+	struct wmi_temp_sense_done_event *e = evt;
+
+	e->marlon_m_t1000 = cpu_to_le32(45000);
+	e->marlon_r_t1000 = cpu_to_le32(50000);
+
+	return sizeof(*e);
+}
+
+static int fw_reply_rx_chain(struct fw_emu *fw, u16 cmdid, const void *cmd,
+			     u16 len, void *evt, u16 room)
+{
+	struct wmi_cfg_rx_chain_done_event *e = evt;
+
+	e->rx_ring_tail_ptr = cpu_to_le32(0x881100);
+	e->status = cpu_to_le32(WMI_CFG_RX_CHAIN_SUCCESS);
+
+	return sizeof(*e);
+}
+
+static const struct fw_emu_rule fw_emu_default_rules[] = {
+	{WMI_ECHO_CMDID, WMI_ECHO_RSP_EVENTID, fw_reply_echo},
+	{WMI_VRING_CFG_CMDID, WMI_VRING_CFG_DONE_EVENTID, fw_reply_vring_cfg},
+	{WMI_VRING_BA_EN_CMDID, WMI_BA_STATUS_EVENTID, fw_reply_ba_en},
+	{WMI_CONNECT_CMDID, WMI_CONNECT_EVENTID, fw_reply_connect},
+	{WMI_DISCONNECT_CMDID, WMI_DISCONNECT_EVENTID, fw_reply_disconnect},
+	{WMI_DISCONNECT_STA_CMDID, WMI_DISCONNECT_EVENTID,
+	 fw_reply_disconnect_sta},
+	{WMI_SW_TX_REQ_CMDID, WMI_SW_TX_COMPLETE_EVENTID, fw_reply_status},
+	{WMI_NOTIFY_REQ_CMDID, WMI_NOTIFY_REQ_DONE_EVENTID, fw_reply_notify},
+	{WMI_TEMP_SENSE_CMDID, WMI_TEMP_SENSE_DONE_EVENTID, fw_reply_temp},
+	{WMI_CFG_RX_CHAIN_CMDID, WMI_CFG_RX_CHAIN_DONE_EVENTID,
+	 fw_reply_rx_chain},
+	{WMI_PCP_START_CMDID, WMI_PCP_STARTED_EVENTID, fw_reply_status},
+	{WMI_PCP_STOP_CMDID, WMI_PCP_STOPPED_EVENTID, fw_reply_status},
+};
+
+/*=== mailbox ===*/
+
+static void fw_irq(struct fw_emu *fw, u32 isr)
+{
+	__atomic_add_fetch(&fw->stats.irqs, 1, __ATOMIC_RELAXED);
+	fw->irq(fw->irq_ctx, isr);
+}
+
+/* under @fw->lock; waits for the host to free Rx entry */
+static int fw_post_locked(struct fw_emu *fw, u16 evtid, const void *data,
+			  u16 len)
+{
+	struct {
+		struct wil6210_mbox_hdr hdr;
+		struct wil6210_mbox_hdr_wmi wmi;
+	} __packed evt = {
+		.hdr = {
+			.len = cpu_to_le16(sizeof(evt.wmi) + len),
+			.type = cpu_to_le16(WIL_MBOX_HDR_TYPE_WMI),
+		},
+		.wmi = {
+			.id = cpu_to_le16(evtid),
+		},
+	};
+	struct wil6210_mbox_ring_desc d;
+	volatile u32 __iomem *desc = fw_reg(fw, fw->rx_head);
+	u32 next = FW_EMU_RX_RING + (fw->rx_head - FW_EMU_RX_RING + sizeof(d)) %
+		   (FW_EMU_RX_ENTRIES * sizeof(d));
+	void __iomem *dst;
+	bool full = false;
+
+	if (sizeof(evt) + len > FW_EMU_ENTRY_SIZE)
+		return -ERANGE;
+
+	/*
+	 * One entry always stays free - host takes head == tail for
+	 * an empty ring
+	 */
+	while (__atomic_load_n(&desc[0], __ATOMIC_ACQUIRE) ||
+	       __atomic_load_n(MBOX_REG(rx.tail), __ATOMIC_ACQUIRE) == next) {
+		if (fw->stop)
+			return -ESHUTDOWN;
+		if (!full) {
+			full = true;
+			fw->stats.rx_full++;
+		}
+		usleep(10);
+	}
+
+	wil_memcpy_fromio_32(&d, desc, sizeof(d));
+	dst = fw_buf(fw, le32_to_cpu(d.addr));
+	evt.hdr.seq = cpu_to_le16(++fw->seq);
+	wil_memcpy_toio_32(dst, &evt, sizeof(evt));
+	wil_memcpy_toio_32(dst + sizeof(evt), data, len);
+
+	/* payload before ownership, ownership before head */
+	__atomic_store_n(&desc[0], 1, __ATOMIC_RELEASE);
+	fw->rx_head = next;
+	__atomic_store_n(MBOX_REG(rx.head), fw->rx_head, __ATOMIC_RELEASE);
+	fw->stats.events++;
+
+	return 0;
+}
+
+int fw_emu_post(struct fw_emu *fw, u16 evtid, const void *data, u16 len)
+{
+	int rc;
+
+	pthread_mutex_lock(&fw->lock);
+	rc = fw_post_locked(fw, evtid, data, len);
+	pthread_mutex_unlock(&fw->lock);
+
+	if (!rc)
+		fw_irq(fw, ISR_MISC_MBOX_EVT);
+
+	return rc;
+}
+
+/*
+ * @n events back to back; @update, if given, may modify @data
+ * before each one is posted
+ */
+int fw_emu_storm(struct fw_emu *fw, u16 evtid, void *data, u16 len,
+		 unsigned long n, void (*update)(void *data, unsigned long i))
+{
+	unsigned long i;
+	int rc = 0;
+
+	for (i = 0; i < n && !rc; i++) {
+		if (update)
+			update(data, i);
+		rc = fw_emu_post(fw, evtid, data, len);
+	}
+
+	return rc;
+}
+
+static void fw_handle_cmd(struct fw_emu *fw, u16 cmdid, const void *cmd,
+			  u16 len)
+{
+	u8 evt[FW_EMU_ENTRY_SIZE];
+	struct fw_emu_rule rule = {};
+	int rc = -ENOENT;
+	uint i;
+
+	fw->stats.cmds++;
+
+	pthread_mutex_lock(&fw->lock);
+	for (i = 0; i < fw->n_rules; i++)
+		if (fw->rules[i].cmdid == cmdid) {
+			rule = fw->rules[i];
+			break;
+		}
+	pthread_mutex_unlock(&fw->lock);
+
+	if (!rule.cmdid) {
+		fw->stats.cmds_unknown++;
+		return;
+	}
+	if (rule.drop || !rule.reply_id)
+		return;
+	if (rule.delay_us)
+		usleep(rule.delay_us);
+
+	pthread_mutex_lock(&fw->lock);
+	if (rule.reply)
+		rc = rule.reply(fw, cmdid, cmd, len, evt,
+				sizeof(evt) - sizeof(struct wil6210_mbox_hdr) -
+				sizeof(struct wil6210_mbox_hdr_wmi));
+	else
+		rc = 0;
+	if (rc >= 0)
+		rc = fw_post_locked(fw, rule.reply_id, evt, rc);
+	pthread_mutex_unlock(&fw->lock);
+
+	if (!rc)
+		fw_irq(fw, ISR_MISC_MBOX_EVT);
+}
+
+/* consume everything host put to the Tx ring */
+static void fw_tx_ring(struct fw_emu *fw)
+{
+	struct {
+		struct wil6210_mbox_hdr hdr;
+		struct wil6210_mbox_hdr_wmi wmi;
+		u8 data[FW_EMU_ENTRY_SIZE];
+	} __packed cmd;
+	struct wil6210_mbox_ring_desc d;
+	u32 head = __atomic_load_n(MBOX_REG(tx.head), __ATOMIC_ACQUIRE);
+
+	while (fw->tx_tail != head) {
+		volatile u32 __iomem *desc = fw_reg(fw, fw->tx_tail);
+		void __iomem *src;
+		u16 len;
+
+		wil_memcpy_fromio_32(&d, desc, sizeof(d));
+		if (!d.sync) {
+			fprintf(stderr, "fw_emu: Tx entry 0x%08x not owned\n",
+				fw->tx_tail);
+			return;
+		}
+		src = fw_buf(fw, le32_to_cpu(d.addr));
+		wil_memcpy_fromio_32(&cmd, src, sizeof(cmd.hdr));
+		len = le16_to_cpu(cmd.hdr.len);
+		if (len < sizeof(cmd.wmi) ||
+		    sizeof(cmd.hdr) + len > FW_EMU_ENTRY_SIZE) {
+			fprintf(stderr, "fw_emu: bad command length %d\n", len);
+			len = sizeof(cmd.wmi);
+			cmd.wmi.id = 0;
+		} else {
+			wil_memcpy_fromio_32(&cmd.wmi, src + sizeof(cmd.hdr),
+					     len);
+		}
+
+		/* entry is free once copied */
+		__atomic_store_n(&desc[0], 0, __ATOMIC_RELEASE);
+		fw->tx_tail = FW_EMU_TX_RING + (fw->tx_tail - FW_EMU_TX_RING +
+			      sizeof(d)) % (FW_EMU_TX_ENTRIES * sizeof(d));
+		__atomic_store_n(MBOX_REG(tx.tail), fw->tx_tail,
+				 __ATOMIC_RELEASE);
+
+		fw_handle_cmd(fw, le16_to_cpu(cmd.wmi.id), cmd.data,
+			      len - sizeof(cmd.wmi));
+		if (fw->tx_tail == head)
+			head = __atomic_load_n(MBOX_REG(tx.head),
+					       __ATOMIC_ACQUIRE);
+	}
+}
+
+static void *fw_thread(void *arg)
+{
+	struct fw_emu *fw = arg;
+	volatile u32 __iomem *doorbell = fw->bar + HOST_SW_INT;
+	u32 idle = fw_now_us();
+
+	while (!fw->stop) {
+		/* ICS is write-only for the host; take whatever was set */
+		if (__atomic_exchange_n(doorbell, 0, __ATOMIC_ACQ_REL) &
+		    SW_INT_MBOX) {
+			fw_tx_ring(fw);
+			idle = fw_now_us();
+		} else if (fw_now_us() - idle < fw->spin_us) {
+			cpu_relax();
+		} else {
+			usleep(fw->sleep_us);
+		}
+	}
+
+	return NULL;
+}
+
+/*=== setup ===*/
+
+static void fw_ring_init(struct fw_emu *fw, struct wil6210_mbox_ring *r,
+			 u32 base, uint entries, u32 buf)
+{
+	struct wil6210_mbox_ring_desc d = {};
+	uint i;
+
+	r->base = cpu_to_le32(base);
+	r->entry_size = cpu_to_le16(FW_EMU_ENTRY_SIZE);
+	r->size = cpu_to_le16(entries * sizeof(d));
+	r->tail = r->base;
+	r->head = r->base;
+
+	for (i = 0; i < entries; i++) {
+		d.addr = cpu_to_le32(buf + i * FW_EMU_ENTRY_SIZE);
+		wil_memcpy_toio_32(fw_reg(fw, base + i * sizeof(d)), &d,
+				   sizeof(d));
+	}
+}
+
+int fw_emu_start(struct fw_emu *fw)
+{
+	struct wil6210_mbox_ctl ctl;
+	struct wmi_ready_event ready = {
+		.sw_version = cpu_to_le32(FW_EMU_VERSION),
+		.mac = {0x04, 0xce, 0x14, 0x00, 0x00, 0x01},
+	};
+	int rc;
+
+	if (fw->running)
+		return -EBUSY;
+
+	memset(fw->bar, 0, WIL6210_MEM_SIZE);
+	memset(fw->peer_used, 0, sizeof(fw->peer_used));
+	fw_ring_init(fw, &ctl.tx, FW_EMU_TX_RING, FW_EMU_TX_ENTRIES,
+		     FW_EMU_TX_BUF);
+	fw_ring_init(fw, &ctl.rx, FW_EMU_RX_RING, FW_EMU_RX_ENTRIES,
+		     FW_EMU_RX_BUF);
+	wil_memcpy_toio_32(fw->bar + HOST_MBOX, &ctl, sizeof(ctl));
+	fw->tx_tail = FW_EMU_TX_RING;
+	fw->rx_head = FW_EMU_RX_RING;
+	fw->seq = 0;
+
+	fw->stop = false;
+	rc = pthread_create(&fw->thread, NULL, fw_thread, fw);
+	if (rc)
+		return -rc;
+	fw->running = true;
+
+	/* boot done - host caches mailbox registers on this */
+	fw_irq(fw, ISR_MISC_FW_READY);
+
+	rc = fw_emu_post(fw, WMI_READY_EVENTID, &ready, sizeof(ready));
+	if (!rc)
+		rc = fw_emu_post(fw, WMI_FW_READY_EVENTID, NULL, 0);
+
+	return rc;
+}
+
+void fw_emu_stop(struct fw_emu *fw)
+{
+	if (!fw->running)
+		return;
+
+	fw->stop = true;
+	pthread_join(fw->thread, NULL);
+	fw->running = false;
+}
+
+struct fw_emu_rule *fw_emu_rule(struct fw_emu *fw, u16 cmdid)
+{
+	struct fw_emu_rule *r = NULL;
+	uint i;
+
+	pthread_mutex_lock(&fw->lock);
+	for (i = 0; i < fw->n_rules; i++)
+		if (fw->rules[i].cmdid == cmdid) {
+			r = &fw->rules[i];
+			break;
+		}
+	if (!r && fw->n_rules < FW_EMU_RULES) {
+		r = &fw->rules[fw->n_rules++];
+		memset(r, 0, sizeof(*r));
+		r->cmdid = cmdid;
+	}
+	pthread_mutex_unlock(&fw->lock);
+
+	return r;
+}
+
+void fw_emu_get_stats(struct fw_emu *fw, struct fw_emu_stats *st)
+{
+	pthread_mutex_lock(&fw->lock);
+	*st = fw->stats;
+	pthread_mutex_unlock(&fw->lock);
+}
+
+void fw_emu_set_poll(struct fw_emu *fw, u32 spin_us, u32 sleep_us)
+{
+	fw->spin_us = spin_us;
+	fw->sleep_us = sleep_us ? : 1;
+}
+
+void __iomem *fw_emu_bar(struct fw_emu *fw)
+{
+	return fw->bar;
+}
+
+struct fw_emu *fw_emu_create(void (*irq)(void *ctx, u32 isr), void *ctx)
+{
+	struct fw_emu *fw = calloc(1, sizeof(*fw));
+
+	if (!fw)
+		return NULL;
+
+	fw->bar = aligned_alloc(4096, WIL6210_MEM_SIZE);
+	if (!fw->bar) {
+		free(fw);
+		return NULL;
+	}
+
+	fw->irq = irq;
+	fw->irq_ctx = ctx;
+	pthread_mutex_init(&fw->lock, NULL);
+	BUILD_BUG_ON(ARRAY_SIZE(fw_emu_default_rules) > FW_EMU_RULES);
+	memcpy(fw->rules, fw_emu_default_rules, sizeof(fw_emu_default_rules));
+	fw->n_rules = ARRAY_SIZE(fw_emu_default_rules);
+	fw_emu_set_poll(fw, 100, 50);
+
+	return fw;
+}
+
+void fw_emu_destroy(struct fw_emu *fw)
+{
+	fw_emu_stop(fw);
+	free(fw->bar);
+	free(fw);
+}
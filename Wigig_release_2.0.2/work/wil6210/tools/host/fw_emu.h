@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2013 Qualcomm Atheros, Inc.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef __FW_EMU_H__
+#define __FW_EMU_H__
+
+#include "wil6210.h"
+
+/*
+ * Device side of the WMI mailbox, in software.
+ *
+ * Owns an emulated BAR0 with struct wil6210_mbox_ctl at HOST_MBOX and
+ * both rings in the FW data RAM, laid out the way firmware does it.
+ * Firmware thread watches the SW_INT_MBOX doorbell, consumes commands
+ * from the Tx ring and answers them according to the rule table,
+ * posting events to the Rx ring and raising the misc. IRQ through
+ * @irq callback with ISR_MISC_* bits.
+ */
+
+struct fw_emu;
+
+/*
+ * Build reply for the command. @cmd/@len - command payload after the WMI
+ * header; reply payload goes to @evt, up to @room bytes.
+ * Returns payload length, or negative to send nothing
+ */
+typedef int (*fw_emu_reply_fn)(struct fw_emu *fw, u16 cmdid,
+			       const void *cmd, u16 len, void *evt, u16 room);
+
+struct fw_emu_rule {
+	u16 cmdid;
+	u16 reply_id; /* 0 - no reply */
+	fw_emu_reply_fn reply;
+	u32 delay_us; /* before the reply is posted */
+	bool drop; /* consume, never reply */
+};
+
+struct fw_emu_stats {
+	unsigned long cmds;
+	unsigned long cmds_unknown;
+	unsigned long events;
+	unsigned long irqs;
+	unsigned long rx_full; /* waits for the host to free Rx entry */
+};
+
+struct fw_emu *fw_emu_create(void (*irq)(void *ctx, u32 isr), void *ctx);
+void fw_emu_destroy(struct fw_emu *fw);
+void __iomem *fw_emu_bar(struct fw_emu *fw);
+/* boot: mailbox setup, FW_READY IRQ, WMI_READY and WMI_FW_READY events */
+int fw_emu_start(struct fw_emu *fw);
+void fw_emu_stop(struct fw_emu *fw);
+
+/* rule for @cmdid, created if not in the table; NULL if table full */
+struct fw_emu_rule *fw_emu_rule(struct fw_emu *fw, u16 cmdid);
+/* unsolicited event(s), as if firmware decided to send them */
+int fw_emu_post(struct fw_emu *fw, u16 evtid, const void *data, u16 len);
+int fw_emu_storm(struct fw_emu *fw, u16 evtid, void *data, u16 len,
+		 unsigned long n, void (*update)(void *data, unsigned long i));
+
+void fw_emu_get_stats(struct fw_emu *fw, struct fw_emu_stats *st);
+/* busy poll for @spin_us, then sleep @sleep_us between doorbell checks */
+void fw_emu_set_poll(struct fw_emu *fw, u32 spin_us, u32 sleep_us);
+
+#endif /* __FW_EMU_H__ */
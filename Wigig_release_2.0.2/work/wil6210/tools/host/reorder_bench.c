@@ -0,0 +1,641 @@
+/*
+ * Copyright (c) 2013 Qualcomm Atheros, Inc.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Rx reorder replay harness.
+ *
+ * Runs rx_reorder.c, compiled as is against shim/, in user space.
+ * Feeds it with sequence of Rx frames and reports reorder throughput,
+ * delivery order and time frames spend held in the reorder buffer.
+ *
+ * Frames either read from the trace file (-f), or synthesized.
+ * Trace file may be either output of the wil6210_rx tracepoint, i.e.
+ *
+ *   cat /sys/kernel/debug/tracing/trace_pipe > rx.trace
+ *
+ * or plain text, one frame per line: "<cid> <tid> <seq> [bar]"
+ *
+ * Hold times are measured in virtual time - frame timestamp from the
+ * trace, or frame index times inter-frame gap (-g) for synthetic traffic.
+ */
+#include <getopt.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "wil6210.h"
+#include "txrx.h"
+
+#define SEQ_MASK	(0xfff)
+
+struct rec {
+	u8 cid;
+	u8 tid;
+	u8 bar;
+	u16 seq;
+	u64 t_ns; /* arrival time, virtual */
+};
+
+enum {
+	FRAME_PENDING = 0,
+	FRAME_DELIVERED,
+	FRAME_DROPPED,
+};
+
+struct frame {
+	struct sk_buff skb;
+	int idx; /* arrival index */
+	int state;
+};
+
+struct stream {
+	bool used;
+	u16 first_seq;
+	u16 last_seq;
+	unsigned long delivered;
+	unsigned long ooo; /* out of order or duplicate deliveries */
+	unsigned long gaps; /* sequence numbers never delivered */
+};
+
+static struct {
+	unsigned long delivered;
+	unsigned long dropped;
+	unsigned long flushed;
+	unsigned long bars;
+	u64 *hold_ns;
+	int *hold_frames;
+	unsigned long n_hold;
+	bool teardown;
+	bool record;
+} st;
+
+static struct stream streams[WIL6210_MAX_CID][WIL_STA_TID_NUM];
+static struct rec *recs;
+static struct frame *frames;
+static int n_recs, cap_recs;
+static int cur_idx; /* index of frame being processed */
+static u64 cur_t;
+static bool verbose;
+
+unsigned long jiffies;
+
+/* kernel API implemented by the harness */
+
+bool queue_work(struct workqueue_struct *wq, struct work_struct *work)
+{
+	work->func(work);
+	return true;
+}
+
+static void account_delivery(struct frame *f)
+{
+	struct rec *r = &recs[f->idx];
+	struct stream *s = &streams[r->cid][r->tid];
+	u16 d;
+
+	f->state = FRAME_DELIVERED;
+	if (!st.record)
+		return;
+
+	st.delivered++;
+	s->delivered++;
+
+	d = (r->seq - s->last_seq) & SEQ_MASK;
+	if (d == 0 || d > (SEQ_MASK + 1) / 2) {
+		s->ooo++;
+	} else {
+		s->gaps += d - 1;
+		s->last_seq = r->seq;
+	}
+
+	if (st.teardown) {
+		st.flushed++;
+		return;
+	}
+
+	st.hold_ns[st.n_hold] = cur_t - r->t_ns;
+	st.hold_frames[st.n_hold] = cur_idx - f->idx;
+	st.n_hold++;
+}
+
+void wil_netif_rx_any(struct sk_buff *skb, struct net_device *ndev)
+{
+	struct frame *f = container_of(skb, struct frame, skb);
+
+	if (verbose)
+		printf("  deliver seq 0x%03x\n", recs[f->idx].seq);
+	account_delivery(f);
+}
+
+void kfree_skb(struct sk_buff *skb)
+{
+	struct frame *f = container_of(skb, struct frame, skb);
+
+	if (!skb)
+		return;
+	if (verbose)
+		printf("  drop seq 0x%03x\n", recs[f->idx].seq);
+	f->state = FRAME_DROPPED;
+	if (!st.record)
+		return;
+	if (st.teardown)
+		st.flushed++;
+	else
+		st.dropped++;
+}
+
+/* Rx poll is run by the replay, see sessions_teardown() */
+void wil6210_schedule_rx(struct wil6210_priv *wil)
+{
+}
+
+int wmi_rcp_addba_resp(struct wil6210_priv *wil, u8 cid, u8 tid, u8 token,
+		       u16 status, bool amsdu, u16 agg_wsize, u16 timeout)
+{
+	if (verbose)
+		printf("ADDBA response CID %d TID %d status %d wsize %d\n",
+		       cid, tid, status, agg_wsize);
+	return 0;
+}
+
+void wil_hist_add(struct wil_hist *h, u32 usec)
+{
+}
+
+int wil_err(struct wil6210_priv *wil, const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	return 0;
+}
+
+int wil_info(struct wil6210_priv *wil, const char *fmt, ...)
+{
+	return 0;
+}
+
+int wil_dbg_trace(struct wil6210_priv *wil, const char *fmt, ...)
+{
+	return 0;
+}
+
+/* trace input */
+
+static struct rec *new_rec(void)
+{
+	if (n_recs == cap_recs) {
+		cap_recs = cap_recs ? 2 * cap_recs : 4096;
+		recs = realloc(recs, cap_recs * sizeof(*recs));
+		if (!recs) {
+			perror("realloc");
+			exit(1);
+		}
+	}
+	memset(&recs[n_recs], 0, sizeof(*recs));
+	return &recs[n_recs++];
+}
+
+/*
+ * " <task>-<pid> [cpu] <flags> <sec>.<usec>: wil6210_rx: index .. cid 0
+ *   tid 0 mcs 0 seq 0x123 type 0x2 subtype 0x0"
+ */
+static int parse_trace_line(const char *line, struct rec *r, u64 *t_ns)
+{
+	const char *p = strstr(line, "wil6210_rx:");
+	const char *q;
+	unsigned int cid, tid, seq, type = 2, subtype = 0;
+	double t;
+
+	if (!p)
+		return -EINVAL;
+
+	/* timestamp is the token preceding tracepoint name */
+	for (q = p - 1; q > line && (q[-1] != ' ' || q[0] == ' '); q--)
+		;
+	if (q > line && sscanf(q, "%lf:", &t) == 1)
+		*t_ns = (u64)(t * 1e9);
+
+	q = strstr(p, " cid ");
+	if (!q || sscanf(q, " cid %u tid %u", &cid, &tid) != 2)
+		return -EINVAL;
+	q = strstr(p, " seq ");
+	if (!q || sscanf(q, " seq %x type %x subtype %x",
+			 &seq, &type, &subtype) < 1)
+		return -EINVAL;
+
+	r->cid = cid;
+	r->tid = tid;
+	r->seq = seq & SEQ_MASK;
+	/* control frame, BlockAckReq */
+	r->bar = (type == 1 && subtype == 8);
+
+	return 0;
+}
+
+static int read_trace(const char *fname, u64 gap_ns)
+{
+	FILE *f = fopen(fname, "r");
+	char line[512];
+	u64 t0 = 0, t_ns = 0;
+	bool have_t0 = false;
+
+	if (!f) {
+		perror(fname);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		struct rec tmp = {0};
+		unsigned int cid, tid, seq;
+		char kw[8] = "";
+		u64 t = 0;
+
+		if (line[0] == '#')
+			continue;
+		if (!parse_trace_line(line, &tmp, &t)) {
+			if (t) {
+				if (!have_t0) {
+					t0 = t;
+					have_t0 = true;
+				}
+				tmp.t_ns = t - t0;
+			} else {
+				tmp.t_ns = t_ns;
+			}
+		} else if (sscanf(line, "%u %u %i %7s", &cid, &tid, &seq,
+				  kw) >= 3) {
+			tmp.cid = cid;
+			tmp.tid = tid;
+			tmp.seq = seq & SEQ_MASK;
+			tmp.bar = !strcmp(kw, "bar");
+			tmp.t_ns = t_ns;
+		} else {
+			continue;
+		}
+		if (tmp.cid >= WIL6210_MAX_CID || tmp.tid >= WIL_STA_TID_NUM) {
+			fprintf(stderr, "bad CID/TID: %s", line);
+			continue;
+		}
+		*new_rec() = tmp;
+		t_ns += gap_ns;
+	}
+	fclose(f);
+
+	return 0;
+}
+
+/*
+ * Synthetic traffic: @n frames for each of @n_cid * @n_tid streams,
+ * sent in A-MPDUs of @ampdu frames. Within A-MPDU, frames are displaced
+ * by up to @disp positions with probability @reorder_pct and lost
+ * with probability @loss_pct. Optionally, BAR follows A-MPDU with loss.
+ */
+static void gen_trace(int n, int n_cid, int n_tid, int ampdu, int disp,
+		      int reorder_pct, int loss_pct, bool bar, u64 gap_ns,
+		      unsigned int seed)
+{
+	int base, i, c, t;
+	u64 t_ns = 0;
+	u16 *seqs = calloc(ampdu, sizeof(*seqs));
+	bool *lost = calloc(ampdu, sizeof(*lost));
+
+	srandom(seed);
+	for (base = 0; base < n; base += ampdu) {
+		int len = min(ampdu, n - base);
+
+		for (c = 0; c < n_cid; c++)
+		for (t = 0; t < n_tid; t++) {
+			bool any_lost = false;
+
+			for (i = 0; i < len; i++) {
+				seqs[i] = (base + i) & SEQ_MASK;
+				lost[i] = (random() % 100) < loss_pct;
+			}
+			for (i = 0; i < len; i++) {
+				int j;
+				u16 s;
+				bool l;
+
+				if ((random() % 100) >= reorder_pct || disp < 1)
+					continue;
+				j = i + 1 + random() % disp;
+				if (j >= len)
+					continue;
+				s = seqs[i]; seqs[i] = seqs[j]; seqs[j] = s;
+				l = lost[i]; lost[i] = lost[j]; lost[j] = l;
+			}
+			for (i = 0; i < len; i++) {
+				struct rec *r;
+
+				if (lost[i]) {
+					any_lost = true;
+					continue;
+				}
+				r = new_rec();
+				r->cid = c;
+				r->tid = t;
+				r->seq = seqs[i];
+				r->t_ns = t_ns;
+				t_ns += gap_ns;
+			}
+			if (bar && any_lost) {
+				struct rec *r = new_rec();
+
+				r->cid = c;
+				r->tid = t;
+				r->seq = (base + len) & SEQ_MASK;
+				r->bar = 1;
+				r->t_ns = t_ns;
+				t_ns += gap_ns;
+			}
+		}
+	}
+	free(seqs);
+	free(lost);
+}
+
+/* replay */
+
+static void sessions_setup(struct wil6210_priv *wil, int wsize)
+{
+	int cid, tid;
+
+	for (cid = 0; cid < WIL6210_MAX_CID; cid++)
+	for (tid = 0; tid < WIL_STA_TID_NUM; tid++) {
+		struct stream *s = &streams[cid][tid];
+		u16 param_set = BIT(1) | (tid << 2) | (wsize << 6);
+
+		if (!s->used)
+			continue;
+		wil->sta[cid].status = wil_sta_connected;
+		wil_rcp_addba_request(wil, mk_cidxtid(cid, tid), 1,
+				      cpu_to_le16(param_set), 0,
+				      cpu_to_le16(s->first_seq << 4));
+		s->last_seq = (s->first_seq - 1) & SEQ_MASK;
+	}
+}
+
+static void sessions_teardown(struct wil6210_priv *wil)
+{
+	int cid, tid;
+
+	st.teardown = true;
+	for (cid = 0; cid < WIL6210_MAX_CID; cid++) {
+		struct wil_sta_info *sta = &wil->sta[cid];
+
+		for (tid = 0; tid < WIL_STA_TID_NUM; tid++)
+			wil_tid_ampdu_rx_set(wil, sta, tid, NULL);
+	}
+	/* next Rx poll releases what torn down sessions held */
+	wil_rx_reorder_flush(wil);
+	st.teardown = false;
+}
+
+static void replay(struct wil6210_priv *wil)
+{
+	int i;
+
+	for (i = 0; i < n_recs; i++) {
+		struct rec *r = &recs[i];
+		struct frame *f = &frames[i];
+
+		cur_idx = i;
+		cur_t = r->t_ns;
+		jiffies = r->t_ns / (1000000000 / HZ);
+		f->state = FRAME_PENDING;
+		if (verbose)
+			printf("%s CID %d TID %d seq 0x%03x\n",
+			       r->bar ? "BAR" : "Rx ", r->cid, r->tid, r->seq);
+		if (r->bar) {
+			st.bars++;
+			wil_rx_bar(wil, r->cid, r->tid, r->seq);
+			continue;
+		}
+		wil_rx_reorder(wil, &f->skb);
+	}
+}
+
+static void prepare_frames(void)
+{
+	int i;
+
+	frames = calloc(n_recs, sizeof(*frames));
+	st.hold_ns = calloc(n_recs, sizeof(*st.hold_ns));
+	st.hold_frames = calloc(n_recs, sizeof(*st.hold_frames));
+	if (!frames || !st.hold_ns || !st.hold_frames) {
+		perror("calloc");
+		exit(1);
+	}
+
+	for (i = 0; i < n_recs; i++) {
+		struct rec *r = &recs[i];
+		struct vring_rx_desc *d = wil_skb_rxdesc(&frames[i].skb);
+		struct stream *s = &streams[r->cid][r->tid];
+
+		frames[i].idx = i;
+		/* ftype 2 - data */
+		d->mac.d0 = r->tid | (r->cid << 4) | (2 << 10) |
+			    (r->seq << 16);
+		if (!s->used && !r->bar) {
+			s->used = true;
+			s->first_seq = r->seq;
+		}
+	}
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(void)
+{
+	unsigned long ooo = 0, gaps = 0, held = 0;
+	unsigned long n = st.n_hold;
+	u64 sum_ns = 0;
+	long sum_frames = 0;
+	unsigned long i;
+	int cid, tid;
+
+	for (cid = 0; cid < WIL6210_MAX_CID; cid++)
+	for (tid = 0; tid < WIL_STA_TID_NUM; tid++) {
+		struct stream *s = &streams[cid][tid];
+
+		if (!s->used)
+			continue;
+		ooo += s->ooo;
+		gaps += s->gaps;
+		printf("CID %d TID %d: delivered %lu out-of-order %lu"
+		       " gaps %lu\n", cid, tid, s->delivered, s->ooo, s->gaps);
+	}
+	for (i = 0; i < (unsigned long)n_recs; i++)
+		if (!recs[i].bar && frames[i].state == FRAME_PENDING)
+			held++;
+	/* frames still buffered at teardown are dropped */
+
+	printf("frames %d (BAR %lu)\n", n_recs, st.bars);
+	printf("delivered %lu dropped %lu flushed %lu held %lu\n",
+	       st.delivered, st.dropped, st.flushed, held);
+	printf("order: %s, out-of-order %lu, gaps %lu\n",
+	       ooo ? "VIOLATED" : "ok", ooo, gaps);
+
+	if (!n)
+		return;
+	for (i = 0; i < n; i++) {
+		sum_ns += st.hold_ns[i];
+		sum_frames += st.hold_frames[i];
+	}
+	qsort(st.hold_ns, n, sizeof(*st.hold_ns), cmp_u64);
+	qsort(st.hold_frames, n, sizeof(*st.hold_frames), cmp_int);
+	printf("hold, frames: avg %.2f p99 %d max %d\n",
+	       (double)sum_frames / n, st.hold_frames[n * 99 / 100],
+	       st.hold_frames[n - 1]);
+	printf("hold, usec  : avg %.2f p99 %.2f max %.2f\n",
+	       sum_ns / 1e3 / n, st.hold_ns[n * 99 / 100] / 1e3,
+	       st.hold_ns[n - 1] / 1e3);
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [options]\n"
+	       "  -f <file>  replay trace file\n"
+	       "  -n <num>   synthetic: frames per stream (10000)\n"
+	       "  -c <num>   synthetic: number of CIDs (1)\n"
+	       "  -t <num>   synthetic: number of TIDs per CID (1)\n"
+	       "  -a <num>   synthetic: A-MPDU length (32)\n"
+	       "  -r <pct>   synthetic: reorder probability (0)\n"
+	       "  -d <num>   synthetic: max. reorder displacement (8)\n"
+	       "  -l <pct>   synthetic: loss probability (0)\n"
+	       "  -B         synthetic: send BAR after A-MPDU with loss\n"
+	       "  -s <seed>  synthetic: random seed (1)\n"
+	       "  -g <ns>    inter-frame gap, virtual time (1000)\n"
+	       "  -w <num>   window requested by peer (64)\n"
+	       "  -W <num>   max. window accepted by policy (module default)\n"
+	       "  -L <num>   timed loops (10)\n"
+	       "  -v         print every frame event\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	static struct wil6210_priv wil;
+	static struct wireless_dev wdev;
+	static struct net_device ndev;
+	const char *fname = NULL;
+	int n = 10000, n_cid = 1, n_tid = 1, ampdu = 32, disp = 8;
+	int reorder_pct = 0, loss_pct = 0, wsize = 64, policy_wsize = -1;
+	int loops = 10;
+	bool bar = false;
+	unsigned int seed = 1;
+	u64 gap_ns = 1000;
+	double t0, elapsed;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "f:n:c:t:a:r:d:l:Bs:g:w:W:L:vh")) != -1) {
+		switch (c) {
+		case 'f': fname = optarg; break;
+		case 'n': n = atoi(optarg); break;
+		case 'c': n_cid = atoi(optarg); break;
+		case 't': n_tid = atoi(optarg); break;
+		case 'a': ampdu = atoi(optarg); break;
+		case 'r': reorder_pct = atoi(optarg); break;
+		case 'd': disp = atoi(optarg); break;
+		case 'l': loss_pct = atoi(optarg); break;
+		case 'B': bar = true; break;
+		case 's': seed = strtoul(optarg, NULL, 0); break;
+		case 'g': gap_ns = strtoull(optarg, NULL, 0); break;
+		case 'w': wsize = atoi(optarg); break;
+		case 'W': policy_wsize = atoi(optarg); break;
+		case 'L': loops = atoi(optarg); break;
+		case 'v': verbose = true; break;
+		default:
+			usage(argv[0]);
+			return c == 'h' ? 0 : 1;
+		}
+	}
+	if (n_cid < 1 || n_cid > WIL6210_MAX_CID ||
+	    n_tid < 1 || n_tid > WIL_STA_TID_NUM || ampdu < 1 || loops < 1) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (fname) {
+		if (read_trace(fname, gap_ns))
+			return 1;
+	} else {
+		gen_trace(n, n_cid, n_tid, ampdu, disp, reorder_pct, loss_pct,
+			  bar, gap_ns, seed);
+	}
+	if (!n_recs) {
+		fprintf(stderr, "no frames\n");
+		return 1;
+	}
+	prepare_frames();
+
+	/* minimal device */
+	ndev.ieee80211_ptr = &wdev;
+	wdev.netdev = &ndev;
+	wdev.iftype = NL80211_IFTYPE_STATION;
+	wil.wdev = &wdev;
+	mutex_init(&wil.back_mutex);
+	spin_lock_init(&wil.tid_rx_lock);
+	INIT_LIST_HEAD(&wil.rx_reorder_retired);
+	INIT_LIST_HEAD(&wil.back_pending);
+	INIT_WORK(&wil.back_worker, wil_back_worker);
+	wil_back_policy_init(&wil);
+	if (policy_wsize >= 0)
+		for (i = 0; i < WIL_STA_TID_NUM; i++)
+			wil.back_policy[i].agg_wsize = policy_wsize;
+
+	/* first pass verifies order and measures hold times */
+	sessions_setup(&wil, wsize);
+	st.record = true;
+	replay(&wil);
+	sessions_teardown(&wil);
+	st.record = false;
+	report();
+
+	elapsed = 0;
+	for (i = 0; i < loops; i++) {
+		sessions_setup(&wil, wsize);
+		t0 = now_sec();
+		replay(&wil);
+		elapsed += now_sec() - t0;
+		sessions_teardown(&wil);
+	}
+	printf("throughput: %.2f Mframes/s (%.1f ns/frame), %d loops\n",
+	       n_recs * (double)loops / elapsed / 1e6,
+	       elapsed * 1e9 / n_recs / loops, loops);
+
+	return 0;
+}
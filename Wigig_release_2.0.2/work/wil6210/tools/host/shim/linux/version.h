@@ -0,0 +1,2 @@
+/* host build - see wil_shim.h */
+#include <wil_shim.h>
@@ -0,0 +1,887 @@
+/*
+ * Copyright (c) 2013 Qualcomm Atheros, Inc.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Minimal user space replacement for the kernel API used by the driver
+ * sources, so they can be compiled unmodified into host tools.
+ *
+ * Only what driver actually uses is provided. Locks are pthread mutexes,
+ * atomics are compiler builtins, sleeping primitives (completions,
+ * semaphores, wait queues) are pthread condition variables on
+ * CLOCK_MONOTONIC. Functions that depend on the tool (skb allocation
+ * and release, work queueing, jiffies, cfg80211 notifications) are
+ * declared here and implemented by the tool itself.
+ */
+#ifndef __WIL_SHIM_H__
+#define __WIL_SHIM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+/* types */
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef unsigned long long u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef long long s64;
+typedef uint16_t __le16;
+typedef uint32_t __le32;
+typedef unsigned long long __le64;
+typedef uint16_t __be16;
+typedef uint32_t __be32;
+typedef u64 dma_addr_t;
+typedef unsigned long long cycles_t;
+typedef unsigned int uint;
+typedef unsigned long ulong;
+typedef unsigned int gfp_t;
+typedef int netdev_tx_t;
+
+#define __packed		__attribute__((packed))
+#define __iomem
+#define __force
+#define __user
+#define __rcu
+#define __always_unused		__attribute__((unused))
+#define likely(x)		__builtin_expect(!!(x), 1)
+#define unlikely(x)		__builtin_expect(!!(x), 0)
+
+#define BIT(n)			(1UL << (n))
+#define BITS_PER_LONG		(8 * sizeof(long))
+#define BITS_TO_LONGS(n)	(((n) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define DIV_ROUND_UP(n, d)	(((n) + (d) - 1) / (d))
+#define ALIGN(x, a)		(((x) + (a) - 1) & ~((typeof(x))(a) - 1))
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+#define BUILD_BUG_ON(c)		((void)sizeof(char[1 - 2 * !!(c)]))
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define min(a, b)		((a) < (b) ? (a) : (b))
+#define max(a, b)		((a) > (b) ? (a) : (b))
+#define min_t(t, a, b)		((t)(a) < (t)(b) ? (t)(a) : (t)(b))
+#define max_t(t, a, b)		((t)(a) > (t)(b) ? (t)(a) : (t)(b))
+
+#define lower_32_bits(n)	((u32)(n))
+#define upper_32_bits(n)	((u32)(((n) >> 16) >> 16))
+
+/* host is assumed little endian */
+#define le16_to_cpu(x)		((u16)(x))
+#define le32_to_cpu(x)		((u32)(x))
+#define le64_to_cpu(x)		((u64)(x))
+#define cpu_to_le16(x)		((__le16)(x))
+#define cpu_to_le32(x)		((__le32)(x))
+#define cpu_to_le64(x)		((__le64)(x))
+#define le16_to_cpus(p)		do { } while (0)
+#define __le16_to_cpu(x)	le16_to_cpu(x)
+#define cpu_to_be16(x)		((__be16)__builtin_bswap16(x))
+#define le32_to_cpus(p)		do { } while (0)
+
+#define ETH_ALEN		6
+#define ETH_HLEN		14
+#define ETH_P_PAE		0x888E
+#define ARPHRD_IEEE80211_RADIOTAP	803
+
+/* MMIO: BAR is plain memory, keep the access width */
+#define __raw_readl(a)		(*(const volatile u32 *)(a))
+#define __raw_writel(v, a)	(*(volatile u32 *)(a) = (v))
+#define ioread32(a)		__raw_readl(a)
+#define iowrite32(v, a)		__raw_writel(v, a)
+#define prefetch(p)		__builtin_prefetch(p, 0)
+#define prefetchw(p)		__builtin_prefetch(p, 1)
+
+/* printk */
+#define KERN_ERR		""
+#define KERN_INFO		""
+#define KERN_DEBUG		""
+#define pr_err(fmt, ...)	fprintf(stderr, fmt, ##__VA_ARGS__)
+#define pr_info(fmt, ...)	fprintf(stderr, fmt, ##__VA_ARGS__)
+#define pr_debug(fmt, ...)	do { if (0) printf(fmt, ##__VA_ARGS__); } while (0)
+#define netdev_dbg(dev, fmt, ...) \
+	do { if (0) printf(fmt, ##__VA_ARGS__); } while (0)
+#define print_hex_dump(level, prefix, type, rowsize, groupsize, buf, len, \
+		       ascii) \
+	do { (void)(buf); } while (0)
+#define print_hex_dump_debug(prefix, type, rowsize, groupsize, buf, len, \
+			     ascii) \
+	do { (void)(buf); } while (0)
+#define DUMP_PREFIX_NONE	0
+#define DUMP_PREFIX_OFFSET	1
+
+/* module */
+#define module_param(name, type, perm)
+#define MODULE_PARM_DESC(name, desc)
+#define S_IRUGO			0444
+#define S_IWUSR			0200
+
+/* memory */
+#define GFP_KERNEL		0
+#define GFP_ATOMIC		1
+
+static inline void *kmalloc(size_t size, gfp_t flags)
+{
+	return malloc(size);
+}
+
+static inline void *kzalloc(size_t size, gfp_t flags)
+{
+	return calloc(1, size);
+}
+
+static inline void *kcalloc(size_t n, size_t size, gfp_t flags)
+{
+	return calloc(n, size);
+}
+
+static inline void kfree(const void *p)
+{
+	free((void *)p);
+}
+
+/* locking */
+typedef struct {
+	pthread_mutex_t m;
+} spinlock_t;
+
+struct mutex {
+	pthread_mutex_t m;
+};
+
+#define spin_lock_init(l)	pthread_mutex_init(&(l)->m, NULL)
+#define spin_lock(l)		pthread_mutex_lock(&(l)->m)
+#define spin_unlock(l)		pthread_mutex_unlock(&(l)->m)
+#define local_bh_disable()	do { } while (0)
+#define local_bh_enable()	do { } while (0)
+#define spin_lock_bh(l)		spin_lock(l)
+#define spin_unlock_bh(l)	spin_unlock(l)
+#define spin_lock_irqsave(l, f)	do { (f) = 0; spin_lock(l); } while (0)
+#define spin_unlock_irqrestore(l, f) \
+	do { (void)(f); spin_unlock(l); } while (0)
+#define mutex_init(l)		pthread_mutex_init(&(l)->m, NULL)
+#define mutex_lock(l)		pthread_mutex_lock(&(l)->m)
+#define mutex_unlock(l)		pthread_mutex_unlock(&(l)->m)
+
+typedef struct {
+	int counter;
+} atomic_t;
+
+#define ATOMIC_INIT(i)		{ (i) }
+#define atomic_read(v)		__atomic_load_n(&(v)->counter, __ATOMIC_RELAXED)
+#define atomic_set(v, i)	__atomic_store_n(&(v)->counter, (i), \
+						 __ATOMIC_RELAXED)
+#define atomic_add(i, v)	((void)__atomic_add_fetch(&(v)->counter, (i), \
+							  __ATOMIC_SEQ_CST))
+#define atomic_sub(i, v)	((void)__atomic_sub_fetch(&(v)->counter, (i), \
+							  __ATOMIC_SEQ_CST))
+#define atomic_inc(v)		atomic_add(1, v)
+#define atomic_dec(v)		atomic_sub(1, v)
+#define atomic_inc_return(v)	__atomic_add_fetch(&(v)->counter, 1, \
+						   __ATOMIC_SEQ_CST)
+
+typedef struct {
+	long long counter;
+} atomic64_t;
+
+#define atomic64_read(v)	atomic_read(v)
+#define atomic64_set(v, i)	atomic_set(v, i)
+#define atomic64_inc(v)		atomic_inc(v)
+
+#define smp_wmb()		__atomic_thread_fence(__ATOMIC_RELEASE)
+#define smp_rmb()		__atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define smp_mb()		__atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define ACCESS_ONCE(x)		(*(volatile typeof(x) *)&(x))
+#define cpu_relax()		__asm__ __volatile__("" ::: "memory")
+#define might_sleep()		do { } while (0)
+
+/* bitops */
+#define set_bit(nr, p)		((void)__atomic_or_fetch((p) + (nr) / \
+				 BITS_PER_LONG, 1UL << ((nr) % BITS_PER_LONG), \
+				 __ATOMIC_SEQ_CST))
+#define clear_bit(nr, p)	((void)__atomic_and_fetch((p) + (nr) / \
+				 BITS_PER_LONG, \
+				 ~(1UL << ((nr) % BITS_PER_LONG)), \
+				 __ATOMIC_SEQ_CST))
+#define test_bit(nr, p)		(!!(__atomic_load_n((p) + (nr) / \
+				 BITS_PER_LONG, __ATOMIC_SEQ_CST) & \
+				 (1UL << ((nr) % BITS_PER_LONG))))
+#define test_and_clear_bit(nr, p) (!!(__atomic_fetch_and((p) + (nr) / \
+				 BITS_PER_LONG, \
+				 ~(1UL << ((nr) % BITS_PER_LONG)), \
+				 __ATOMIC_SEQ_CST) & (1UL << ((nr) % BITS_PER_LONG))))
+
+/*
+ * RCU - tools are either single threaded, or don't free objects
+ * while readers active; callbacks invoked immediately
+ */
+struct rcu_head {
+	void (*func)(struct rcu_head *head);
+};
+
+#define rcu_read_lock()			do { } while (0)
+#define rcu_read_unlock()		do { } while (0)
+#define rcu_dereference(p)		(p)
+#define rcu_dereference_protected(p, c)	(p)
+#define rcu_assign_pointer(p, v)	__atomic_store_n(&(p), (v), \
+							 __ATOMIC_RELEASE)
+#define RCU_INIT_POINTER(p, v)		((p) = (v))
+#define lockdep_is_held(l)		1
+#define rcu_barrier()			do { } while (0)
+#define synchronize_rcu()		do { } while (0)
+
+static inline void call_rcu(struct rcu_head *head,
+			    void (*func)(struct rcu_head *head))
+{
+	func(head);
+}
+
+/* lists */
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+#define LIST_HEAD_INIT(name)	{ &(name), &(name) }
+#define LIST_HEAD(name)		struct list_head name = LIST_HEAD_INIT(name)
+
+static inline void INIT_LIST_HEAD(struct list_head *l)
+{
+	l->next = l;
+	l->prev = l;
+}
+
+static inline void list_add_tail(struct list_head *n, struct list_head *h)
+{
+	n->prev = h->prev;
+	n->next = h;
+	h->prev->next = n;
+	h->prev = n;
+}
+
+static inline void list_add(struct list_head *n, struct list_head *h)
+{
+	n->next = h->next;
+	n->prev = h;
+	h->next->prev = n;
+	h->next = n;
+}
+
+static inline void list_del(struct list_head *e)
+{
+	e->prev->next = e->next;
+	e->next->prev = e->prev;
+	e->next = e->prev = NULL;
+}
+
+static inline void list_del_init(struct list_head *e)
+{
+	e->prev->next = e->next;
+	e->next->prev = e->prev;
+	INIT_LIST_HEAD(e);
+}
+
+static inline void list_replace_init(struct list_head *o, struct list_head *n)
+{
+	n->next = o->next;
+	n->next->prev = n;
+	n->prev = o->prev;
+	n->prev->next = n;
+	INIT_LIST_HEAD(o);
+}
+
+static inline void list_move_tail(struct list_head *e, struct list_head *h)
+{
+	e->prev->next = e->next;
+	e->next->prev = e->prev;
+	list_add_tail(e, h);
+}
+
+static inline int list_empty(const struct list_head *h)
+{
+	return h->next == h;
+}
+
+static inline void list_splice_init(struct list_head *l, struct list_head *h)
+{
+	if (list_empty(l))
+		return;
+	l->next->prev = h;
+	l->prev->next = h->next;
+	h->next->prev = l->prev;
+	h->next = l->next;
+	INIT_LIST_HEAD(l);
+}
+
+#define list_entry(ptr, type, member) container_of(ptr, type, member)
+#define list_first_entry(ptr, type, member) \
+	list_entry((ptr)->next, type, member)
+#define list_for_each_entry(pos, head, member) \
+	for (pos = list_entry((head)->next, typeof(*pos), member); \
+	     &pos->member != (head); \
+	     pos = list_entry(pos->member.next, typeof(*pos), member))
+#define list_for_each_entry_safe(pos, n, head, member) \
+	for (pos = list_entry((head)->next, typeof(*pos), member), \
+	     n = list_entry(pos->member.next, typeof(*pos), member); \
+	     &pos->member != (head); \
+	     pos = n, n = list_entry(n->member.next, typeof(*n), member))
+
+/* time; HZ is 1000 so jiffy is a msec. jiffies provided by the tool */
+#define HZ			1000
+extern unsigned long jiffies;
+
+static inline unsigned long msecs_to_jiffies(unsigned int m)
+{
+	return m * HZ / 1000;
+}
+
+#define usecs_to_jiffies(u)	(DIV_ROUND_UP((unsigned long)(u), 1000))
+#define jiffies_to_msecs(j)	((unsigned int)(j))
+#define jiffies_to_usecs(j)	((unsigned int)(j) * 1000)
+#define time_after(a, b)	((long)((b) - (a)) < 0)
+#define time_before(a, b)	time_after(b, a)
+#define time_after_eq(a, b)	((long)((a) - (b)) >= 0)
+
+static inline void usleep_range(unsigned long min, unsigned long max)
+{
+	usleep(min);
+}
+
+static inline cycles_t get_cycles(void)
+{
+	return 0;
+}
+
+typedef union {
+	s64 tv64;
+} ktime_t;
+
+static inline ktime_t ktime_set(long secs, unsigned long nsecs)
+{
+	ktime_t t = { .tv64 = (s64)secs * 1000000000 + nsecs };
+
+	return t;
+}
+
+static inline ktime_t ktime_get(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ktime_set(ts.tv_sec, ts.tv_nsec);
+}
+
+static inline ktime_t ktime_sub(ktime_t a, ktime_t b)
+{
+	ktime_t t = { .tv64 = a.tv64 - b.tv64 };
+
+	return t;
+}
+
+#define ktime_to_ns(t)		((t).tv64)
+#define ktime_to_us(t)		((t).tv64 / 1000)
+
+/* deferred work */
+struct work_struct;
+typedef void (*work_func_t)(struct work_struct *work);
+
+struct work_struct {
+	work_func_t func;
+	struct list_head entry; /* for the tool's queue, if any */
+	bool pending;
+};
+
+struct timer_list {
+	void (*function)(unsigned long);
+	unsigned long data;
+	unsigned long expires;
+};
+
+struct delayed_work {
+	struct work_struct work;
+	struct timer_list timer;
+};
+
+struct workqueue_struct;
+
+#define INIT_WORK(w, f)		((w)->func = (f))
+#define INIT_DELAYED_WORK(w, f)	INIT_WORK(&(w)->work, f)
+#define to_delayed_work(w)	container_of(w, struct delayed_work, work)
+
+/* provided by the tool */
+bool queue_work(struct workqueue_struct *wq, struct work_struct *work);
+bool mod_delayed_work(struct workqueue_struct *wq, struct delayed_work *dw,
+		      unsigned long delay);
+bool cancel_delayed_work_sync(struct delayed_work *dw);
+
+/* timers never fire in the harness */
+struct hrtimer {
+	int dummy;
+};
+
+static inline int del_timer_sync(struct timer_list *t)
+{
+	return 0;
+}
+
+/*
+ * Sleeping primitives. Timeouts are in jiffies, measured on
+ * CLOCK_MONOTONIC regardless of how the tool advances jiffies
+ */
+static inline void shim_cond_init(pthread_cond_t *c)
+{
+	pthread_condattr_t a;
+
+	pthread_condattr_init(&a);
+	pthread_condattr_setclock(&a, CLOCK_MONOTONIC);
+	pthread_cond_init(c, &a);
+	pthread_condattr_destroy(&a);
+}
+
+static inline struct timespec shim_deadline(unsigned long timeout)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ts.tv_sec += timeout / HZ;
+	ts.tv_nsec += (timeout % HZ) * (1000000000 / HZ);
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	return ts;
+}
+
+/* jiffies left till @ts, rounded up; 0 if passed */
+static inline unsigned long shim_remain(const struct timespec *ts)
+{
+	struct timespec now;
+	s64 ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ns = (s64)(ts->tv_sec - now.tv_sec) * 1000000000 +
+	     ts->tv_nsec - now.tv_nsec;
+
+	return ns > 0 ? DIV_ROUND_UP((u64)ns, 1000000000 / HZ) : 0;
+}
+
+/*
+ * Wait queue. Condition is evaluated without the lock, so wake up
+ * between the check and the sleep is missed; sleep is sliced to a jiffy
+ * to bound the damage
+ */
+typedef struct {
+	pthread_mutex_t m;
+	pthread_cond_t c;
+} wait_queue_head_t;
+
+static inline void init_waitqueue_head(wait_queue_head_t *q)
+{
+	pthread_mutex_init(&q->m, NULL);
+	shim_cond_init(&q->c);
+}
+
+static inline void wake_up(wait_queue_head_t *q)
+{
+	pthread_mutex_lock(&q->m);
+	pthread_cond_broadcast(&q->c);
+	pthread_mutex_unlock(&q->m);
+}
+
+#define wait_event_timeout(wq, condition, timeout) ({			\
+	struct timespec __end = shim_deadline(timeout);			\
+	unsigned long __ret;						\
+									\
+	while (!(condition) && shim_remain(&__end)) {			\
+		struct timespec __slice = shim_deadline(1);		\
+									\
+		pthread_mutex_lock(&(wq).m);				\
+		pthread_cond_timedwait(&(wq).c, &(wq).m, &__slice);	\
+		pthread_mutex_unlock(&(wq).m);				\
+	}								\
+	__ret = shim_remain(&__end);					\
+	(condition) ? (__ret ? __ret : 1) : 0;				\
+})
+
+struct completion {
+	pthread_mutex_t m;
+	pthread_cond_t c;
+	unsigned int done;
+};
+
+static inline void init_completion(struct completion *x)
+{
+	pthread_mutex_init(&x->m, NULL);
+	shim_cond_init(&x->c);
+	x->done = 0;
+}
+
+static inline void complete(struct completion *x)
+{
+	pthread_mutex_lock(&x->m);
+	x->done++;
+	pthread_cond_signal(&x->c);
+	pthread_mutex_unlock(&x->m);
+}
+
+static inline unsigned long
+wait_for_completion_timeout(struct completion *x, unsigned long timeout)
+{
+	struct timespec end = shim_deadline(timeout);
+	unsigned long ret = 0;
+
+	pthread_mutex_lock(&x->m);
+	while (!x->done &&
+	       pthread_cond_timedwait(&x->c, &x->m, &end) != ETIMEDOUT)
+		;
+	if (x->done) {
+		x->done--;
+		ret = shim_remain(&end) ? : 1;
+	}
+	pthread_mutex_unlock(&x->m);
+
+	return ret;
+}
+
+static inline void wait_for_completion(struct completion *x)
+{
+	pthread_mutex_lock(&x->m);
+	while (!x->done)
+		pthread_cond_wait(&x->c, &x->m);
+	x->done--;
+	pthread_mutex_unlock(&x->m);
+}
+
+struct semaphore {
+	pthread_mutex_t m;
+	pthread_cond_t c;
+	int count;
+};
+
+static inline void sema_init(struct semaphore *sem, int val)
+{
+	pthread_mutex_init(&sem->m, NULL);
+	shim_cond_init(&sem->c);
+	sem->count = val;
+}
+
+static inline int down_timeout(struct semaphore *sem, long timeout)
+{
+	struct timespec end = shim_deadline(timeout);
+	int ret = 0;
+
+	pthread_mutex_lock(&sem->m);
+	while (sem->count <= 0 &&
+	       pthread_cond_timedwait(&sem->c, &sem->m, &end) != ETIMEDOUT)
+		;
+	if (sem->count > 0)
+		sem->count--;
+	else
+		ret = -ETIME;
+	pthread_mutex_unlock(&sem->m);
+
+	return ret;
+}
+
+/* 0 if acquired, as in the kernel */
+static inline int down_trylock(struct semaphore *sem)
+{
+	int ret = 1;
+
+	pthread_mutex_lock(&sem->m);
+	if (sem->count > 0) {
+		sem->count--;
+		ret = 0;
+	}
+	pthread_mutex_unlock(&sem->m);
+
+	return ret;
+}
+
+static inline void up(struct semaphore *sem)
+{
+	pthread_mutex_lock(&sem->m);
+	sem->count++;
+	pthread_cond_signal(&sem->c);
+	pthread_mutex_unlock(&sem->m);
+}
+
+/* networking */
+struct sk_buff {
+	char cb[48];
+	unsigned char *data;
+	unsigned int len;
+	u16 protocol;
+};
+
+struct sk_buff_head {
+	struct sk_buff *next, *prev;
+	u32 qlen;
+	spinlock_t lock;
+};
+
+struct net_device_stats {
+	unsigned long rx_packets;
+	unsigned long tx_packets;
+	unsigned long rx_bytes;
+	unsigned long tx_bytes;
+	unsigned long rx_dropped;
+	unsigned long tx_errors;
+};
+
+struct wireless_dev;
+
+#define NETIF_F_RXCSUM		BIT(0)
+
+struct net_device {
+	char name[16];
+	unsigned short type;
+	unsigned long features;
+	unsigned char dev_addr[ETH_ALEN];
+	unsigned char perm_addr[32];
+	struct net_device_stats stats;
+	struct wireless_dev *ieee80211_ptr;
+};
+
+struct ethhdr {
+	unsigned char h_dest[ETH_ALEN];
+	unsigned char h_source[ETH_ALEN];
+	__be16 h_proto;
+} __packed;
+
+#define NET_RX_SUCCESS		0
+#define NET_RX_DROP		1
+
+static inline unsigned char *skb_put(struct sk_buff *skb, unsigned int len)
+{
+	unsigned char *tail = skb->data + skb->len;
+
+	skb->len += len;
+
+	return tail;
+}
+
+#define skb_set_mac_header(skb, off)	do { } while (0)
+#define eth_hdr(skb)		((struct ethhdr *)(skb)->data)
+
+/* no header pull - frame stays intact for the tool to inspect */
+static inline __be16 eth_type_trans(struct sk_buff *skb,
+				    struct net_device *dev)
+{
+	return eth_hdr(skb)->h_proto;
+}
+
+static inline bool is_valid_ether_addr(const u8 *a)
+{
+	static const u8 zero[ETH_ALEN];
+
+	return !(a[0] & 1) && memcmp(a, zero, ETH_ALEN);
+}
+
+static inline bool ether_addr_equal(const u8 *a, const u8 *b)
+{
+	return !memcmp(a, b, ETH_ALEN);
+}
+
+struct napi_struct {
+	int weight;
+};
+
+/* provided by the tool */
+struct sk_buff *alloc_skb(unsigned int size, gfp_t flags);
+void kfree_skb(struct sk_buff *skb);
+#define dev_kfree_skb(skb)	kfree_skb(skb)
+int netif_rx_ni(struct sk_buff *skb);
+void netif_carrier_on(struct net_device *dev);
+void netif_carrier_off(struct net_device *dev);
+
+/* cfg80211 */
+enum nl80211_iftype {
+	NL80211_IFTYPE_UNSPECIFIED,
+	NL80211_IFTYPE_ADHOC,
+	NL80211_IFTYPE_STATION,
+	NL80211_IFTYPE_AP,
+	NL80211_IFTYPE_AP_VLAN,
+	NL80211_IFTYPE_WDS,
+	NL80211_IFTYPE_MONITOR,
+	NL80211_IFTYPE_MESH_POINT,
+	NL80211_IFTYPE_P2P_CLIENT,
+	NL80211_IFTYPE_P2P_GO,
+};
+
+enum ieee80211_band {
+	IEEE80211_BAND_2GHZ,
+	IEEE80211_BAND_5GHZ,
+	IEEE80211_BAND_60GHZ,
+};
+
+struct device;
+struct cfg80211_scan_request;
+struct cfg80211_bss;
+
+struct wiphy {
+	char fw_version[32];
+};
+
+struct ieee80211_channel {
+	enum ieee80211_band band;
+	u16 center_freq;
+	u16 hw_value;
+};
+
+struct cfg80211_chan_def {
+	struct ieee80211_channel *chan;
+};
+
+enum {
+	CFG80211_SME_IDLE,
+	CFG80211_SME_CONNECTING,
+	CFG80211_SME_CONNECTED,
+};
+
+struct wireless_dev {
+	struct wiphy *wiphy;
+	struct net_device *netdev;
+	enum nl80211_iftype iftype;
+	int sme_state;
+	struct cfg80211_chan_def preset_chandef;
+};
+
+#define MONITOR_FLAG_CONTROL		BIT(3)
+
+#define STATION_INFO_ASSOC_REQ_IES	BIT(21)
+
+struct station_info {
+	u32 filled;
+	int generation;
+	const u8 *assoc_req_ies;
+	size_t assoc_req_ies_len;
+};
+
+#define WLAN_STATUS_SUCCESS		0
+#define WLAN_STATUS_UNSPECIFIED_FAILURE	1
+#define WLAN_STATUS_REQUEST_DECLINED	37
+
+#define WLAN_CAPABILITY_ESS		BIT(0)
+#define WLAN_CAPABILITY_PRIVACY		BIT(4)
+#define WLAN_EID_RSN			48
+
+#define IEEE80211_FCTL_FTYPE		0x000c
+#define IEEE80211_FCTL_STYPE		0x00f0
+#define IEEE80211_FTYPE_MGMT		0x0000
+#define IEEE80211_STYPE_PROBE_RESP	0x0050
+#define IEEE80211_STYPE_BEACON		0x0080
+
+struct ieee80211_mgmt {
+	__le16 frame_control;
+	__le16 duration;
+	u8 da[ETH_ALEN];
+	u8 sa[ETH_ALEN];
+	u8 bssid[ETH_ALEN];
+	__le16 seq_ctrl;
+	union {
+		struct {
+			__le64 timestamp;
+			__le16 beacon_int;
+			__le16 capab_info;
+			u8 variable[0];
+		} __packed beacon;
+	} u;
+} __packed;
+
+static inline bool ieee80211_is_beacon(__le16 fc)
+{
+	return (fc & cpu_to_le16(IEEE80211_FCTL_FTYPE | IEEE80211_FCTL_STYPE))
+	       == cpu_to_le16(IEEE80211_FTYPE_MGMT | IEEE80211_STYPE_BEACON);
+}
+
+static inline bool ieee80211_is_probe_resp(__le16 fc)
+{
+	return (fc & cpu_to_le16(IEEE80211_FCTL_FTYPE | IEEE80211_FCTL_STYPE))
+	       == cpu_to_le16(IEEE80211_FTYPE_MGMT |
+			      IEEE80211_STYPE_PROBE_RESP);
+}
+
+static inline int ieee80211_channel_to_frequency(int chan,
+						 enum ieee80211_band band)
+{
+	return chan * 2160 + 56160;
+}
+
+static inline const u8 *cfg80211_find_ie(u8 eid, const u8 *ies, int len)
+{
+	while (len > 2 && ies[0] != eid) {
+		len -= ies[1] + 2;
+		ies += ies[1] + 2;
+	}
+	if (len < 2 || len < 2 + ies[1])
+		return NULL;
+
+	return ies;
+}
+
+/* provided by the tool */
+struct ieee80211_channel *ieee80211_get_channel(struct wiphy *wiphy,
+						int freq);
+void cfg80211_scan_done(struct cfg80211_scan_request *request, bool aborted);
+bool cfg80211_rx_mgmt(struct wireless_dev *wdev, int freq, int sig_dbm,
+		      const u8 *buf, size_t len, gfp_t gfp);
+struct cfg80211_bss *cfg80211_inform_bss(struct wiphy *wiphy,
+					 struct ieee80211_channel *channel,
+					 const u8 *bssid, u64 tsf, u16 capability,
+					 u16 beacon_interval, const u8 *ie,
+					 size_t ielen, s32 signal, gfp_t gfp);
+void cfg80211_put_bss(struct wiphy *wiphy, struct cfg80211_bss *bss);
+void cfg80211_connect_result(struct net_device *dev, const u8 *bssid,
+			     const u8 *req_ie, size_t req_ie_len,
+			     const u8 *resp_ie, size_t resp_ie_len,
+			     u16 status, gfp_t gfp);
+void cfg80211_new_sta(struct net_device *dev, const u8 *mac_addr,
+		      struct station_info *sinfo, gfp_t gfp);
+void cfg80211_mgmt_tx_status(struct wireless_dev *wdev, u64 cookie,
+			     const u8 *buf, size_t len, bool ack, gfp_t gfp);
+
+/* debugfs */
+struct dentry;
+
+struct debugfs_blob_wrapper {
+	void *data;
+	unsigned long size;
+};
+
+/* tracing is compiled out, see trace.h */
+struct va_format {
+	const char *fmt;
+	va_list *va;
+};
+
+
+#define TP_PROTO(args...)	args
+#define TP_ARGS(args...)	args
+
+/* version */
+#define KERNEL_VERSION(a, b, c)	(((a) << 16) + ((b) << 8) + (c))
+#define LINUX_VERSION_CODE	KERNEL_VERSION(3, 10, 0)
+
+#endif /* __WIL_SHIM_H__ */
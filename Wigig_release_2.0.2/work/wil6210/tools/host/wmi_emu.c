@@ -0,0 +1,1570 @@
+/*
+ * Copyright (c) 2013 Qualcomm Atheros, Inc.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * WMI control path without hardware.
+ *
+ * Runs wmi.c and rx_reorder.c, compiled as is against shim/, on top of
+ * the firmware mailbox emulator (fw_emu.c). Harness plays the rest of
+ * the kernel: work queues are threads, misc. IRQ thread calls
+ * wmi_recv_cmd() as interrupt.c does, cfg80211 notifications are
+ * counted. Connect worker is a cut down wil_connect_worker() - Tx vring
+ * configured with WMI_VRING_CFG_CMDID, no DMA memory behind it.
+ *
+ * Default run is a functional test of the control path: boot, blocking
+ * and async calls, timeouts, connect with vring config, BACK,
+ * unsolicited events, disconnect and a burst of connections. Exit
+ * status is non-zero on failure.
+ *
+ * With -b it benchmarks wmi_call() round trip, pipelined
+ * wmi_call_async() and event storm handling. Latency includes firmware
+ * polling of the doorbell (-s/-S) and 3 thread wake ups: IRQ thread,
+ * event worker and the caller.
+ */
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "wil6210.h"
+#include "wmi.h"
+#include "txrx.h"
+#include "fw_emu.h"
+
+static struct fw_emu *fw;
+static struct wil6210_priv *wil;
+static bool verbose;
+
+static struct {
+	int new_sta;
+	int connect_result;
+	int disconnect;
+	int mgmt_tx_ack;
+	int mgmt_tx_nack;
+	u64 mgmt_tx_cookie;
+	int rx_mgmt;
+	int eapol_rx;
+	int carrier;
+	int errors; /* wil_err() */
+	int async_done;
+	int async_err;
+	int vring_pooled; /* Tx vring freed, FW done with it */
+	int vring_freed; /* ... FW may still use it */
+} ev;
+
+#define EV_INC(x)	__atomic_add_fetch(&ev.x, 1, __ATOMIC_SEQ_CST)
+#define EV(x)		__atomic_load_n(&ev.x, __ATOMIC_SEQ_CST)
+
+/* poll @cond for up to @ms */
+#define wait_for(cond, ms) ({					\
+	int __left = (ms) * 10;					\
+								\
+	while (!(cond) && __left--)				\
+		usleep(100);					\
+	(cond);							\
+})
+
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*=== kernel API implemented by the harness ===*/
+
+unsigned long jiffies;
+static volatile bool ticker_stop;
+
+static void *ticker_thread(void *arg)
+{
+	double t0 = now_sec();
+
+	while (!ticker_stop) {
+		__atomic_store_n(&jiffies,
+				 1 + (unsigned long)((now_sec() - t0) * HZ),
+				 __ATOMIC_RELAXED);
+		usleep(1000000 / HZ);
+	}
+
+	return NULL;
+}
+
+/* single threaded work queue, like create_singlethread_workqueue() */
+#define WQ_TIMERS	(4)
+
+struct workqueue_struct {
+	const char *name;
+	pthread_t thread;
+	pthread_mutex_t m;
+	pthread_cond_t c; /* work added, timer changed or work done */
+	struct list_head works;
+	struct delayed_work *timers[WQ_TIMERS];
+	struct work_struct *running;
+	bool stop;
+};
+
+static void wq_fire_timers(struct workqueue_struct *wq, unsigned long *next)
+{
+	unsigned long now = jiffies;
+	bool armed = false;
+	int i;
+
+	for (i = 0; i < WQ_TIMERS; i++) {
+		struct delayed_work *dw = wq->timers[i];
+
+		if (!dw)
+			continue;
+		if (time_after_eq(now, dw->timer.expires)) {
+			wq->timers[i] = NULL;
+			if (!dw->work.pending) {
+				dw->work.pending = true;
+				list_add_tail(&dw->work.entry, &wq->works);
+			}
+		} else if (!armed || time_before(dw->timer.expires, *next)) {
+			*next = dw->timer.expires;
+			armed = true;
+		}
+	}
+	if (!armed)
+		*next = 0;
+}
+
+static void *wq_thread(void *arg)
+{
+	struct workqueue_struct *wq = arg;
+	struct work_struct *w;
+	unsigned long next = 0;
+
+	pthread_mutex_lock(&wq->m);
+	while (!wq->stop) {
+		wq_fire_timers(wq, &next);
+		if (!list_empty(&wq->works)) {
+			w = list_first_entry(&wq->works, struct work_struct,
+					     entry);
+			list_del_init(&w->entry);
+			w->pending = false;
+			wq->running = w;
+			pthread_mutex_unlock(&wq->m);
+			w->func(w);
+			pthread_mutex_lock(&wq->m);
+			wq->running = NULL;
+			pthread_cond_broadcast(&wq->c);
+			continue;
+		}
+		if (next) {
+			struct timespec ts = shim_deadline(next - jiffies);
+
+			pthread_cond_timedwait(&wq->c, &wq->m, &ts);
+		} else {
+			pthread_cond_wait(&wq->c, &wq->m);
+		}
+	}
+	pthread_mutex_unlock(&wq->m);
+
+	return NULL;
+}
+
+static struct workqueue_struct *wq_create(const char *name)
+{
+	struct workqueue_struct *wq = calloc(1, sizeof(*wq));
+
+	if (!wq)
+		return NULL;
+	wq->name = name;
+	pthread_mutex_init(&wq->m, NULL);
+	shim_cond_init(&wq->c);
+	INIT_LIST_HEAD(&wq->works);
+	if (pthread_create(&wq->thread, NULL, wq_thread, wq)) {
+		free(wq);
+		return NULL;
+	}
+
+	return wq;
+}
+
+/* pending works are dropped, as after cancel_work_sync() */
+static void wq_destroy(struct workqueue_struct *wq)
+{
+	pthread_mutex_lock(&wq->m);
+	wq->stop = true;
+	pthread_cond_broadcast(&wq->c);
+	pthread_mutex_unlock(&wq->m);
+	pthread_join(wq->thread, NULL);
+	free(wq);
+}
+
+bool queue_work(struct workqueue_struct *wq, struct work_struct *work)
+{
+	bool queued = false;
+
+	pthread_mutex_lock(&wq->m);
+	if (!work->pending) {
+		work->pending = true;
+		list_add_tail(&work->entry, &wq->works);
+		pthread_cond_broadcast(&wq->c);
+		queued = true;
+	}
+	pthread_mutex_unlock(&wq->m);
+
+	return queued;
+}
+
+bool mod_delayed_work(struct workqueue_struct *wq, struct delayed_work *dw,
+		      unsigned long delay)
+{
+	int i, slot = -1;
+
+	pthread_mutex_lock(&wq->m);
+	dw->timer.data = (unsigned long)wq;
+	if (dw->work.pending) {
+		list_del_init(&dw->work.entry);
+		dw->work.pending = false;
+	}
+	dw->timer.expires = jiffies + delay;
+	for (i = 0; i < WQ_TIMERS; i++) {
+		if (wq->timers[i] == dw) {
+			slot = i;
+			break;
+		}
+		if (!wq->timers[i] && slot < 0)
+			slot = i;
+	}
+	if (slot < 0) {
+		fprintf(stderr, "%s: out of timers\n", wq->name);
+		abort();
+	}
+	wq->timers[slot] = dw;
+	pthread_cond_broadcast(&wq->c);
+	pthread_mutex_unlock(&wq->m);
+
+	return true;
+}
+
+bool cancel_delayed_work_sync(struct delayed_work *dw)
+{
+	struct workqueue_struct *wq = (void *)dw->timer.data;
+	bool pending = false;
+	int i;
+
+	if (!wq)
+		return false;
+
+	pthread_mutex_lock(&wq->m);
+	for (i = 0; i < WQ_TIMERS; i++)
+		if (wq->timers[i] == dw) {
+			wq->timers[i] = NULL;
+			pending = true;
+		}
+	if (dw->work.pending) {
+		list_del_init(&dw->work.entry);
+		dw->work.pending = false;
+		pending = true;
+	}
+	while (wq->running == &dw->work)
+		pthread_cond_wait(&wq->c, &wq->m);
+	pthread_mutex_unlock(&wq->m);
+
+	return pending;
+}
+
+struct sk_buff *alloc_skb(unsigned int size, gfp_t flags)
+{
+	struct sk_buff *skb = calloc(1, sizeof(*skb) + size);
+
+	if (skb)
+		skb->data = (void *)&skb[1];
+
+	return skb;
+}
+
+void kfree_skb(struct sk_buff *skb)
+{
+	free(skb);
+}
+
+int netif_rx_ni(struct sk_buff *skb)
+{
+	EV_INC(eapol_rx);
+	kfree_skb(skb);
+
+	return NET_RX_SUCCESS;
+}
+
+void netif_carrier_on(struct net_device *dev)
+{
+	__atomic_store_n(&ev.carrier, 1, __ATOMIC_SEQ_CST);
+}
+
+void netif_carrier_off(struct net_device *dev)
+{
+	__atomic_store_n(&ev.carrier, 0, __ATOMIC_SEQ_CST);
+}
+
+/* cfg80211 */
+static struct ieee80211_channel channels[] = {
+	{IEEE80211_BAND_60GHZ, 58320, 1},
+	{IEEE80211_BAND_60GHZ, 60480, 2},
+	{IEEE80211_BAND_60GHZ, 62640, 3},
+};
+
+struct ieee80211_channel *ieee80211_get_channel(struct wiphy *wiphy,
+						int freq)
+{
+	uint i;
+
+	for (i = 0; i < ARRAY_SIZE(channels); i++)
+		if (channels[i].center_freq == freq)
+			return &channels[i];
+
+	return NULL;
+}
+
+void cfg80211_scan_done(struct cfg80211_scan_request *request, bool aborted)
+{
+}
+
+bool cfg80211_rx_mgmt(struct wireless_dev *wdev, int freq, int sig_dbm,
+		      const u8 *buf, size_t len, gfp_t gfp)
+{
+	EV_INC(rx_mgmt);
+	return true;
+}
+
+struct cfg80211_bss *cfg80211_inform_bss(struct wiphy *wiphy,
+					 struct ieee80211_channel *channel,
+					 const u8 *bssid, u64 tsf, u16 capability,
+					 u16 beacon_interval, const u8 *ie,
+					 size_t ielen, s32 signal, gfp_t gfp)
+{
+	EV_INC(rx_mgmt);
+	return NULL;
+}
+
+void cfg80211_put_bss(struct wiphy *wiphy, struct cfg80211_bss *bss)
+{
+}
+
+void cfg80211_connect_result(struct net_device *dev, const u8 *bssid,
+			     const u8 *req_ie, size_t req_ie_len,
+			     const u8 *resp_ie, size_t resp_ie_len,
+			     u16 status, gfp_t gfp)
+{
+	EV_INC(connect_result);
+}
+
+void cfg80211_new_sta(struct net_device *dev, const u8 *mac_addr,
+		      struct station_info *sinfo, gfp_t gfp)
+{
+	EV_INC(new_sta);
+}
+
+void cfg80211_mgmt_tx_status(struct wireless_dev *wdev, u64 cookie,
+			     const u8 *buf, size_t len, bool ack, gfp_t gfp)
+{
+	__atomic_store_n(&ev.mgmt_tx_cookie, cookie, __ATOMIC_SEQ_CST);
+	if (ack)
+		EV_INC(mgmt_tx_ack);
+	else
+		EV_INC(mgmt_tx_nack);
+}
+
+/*=== driver functions outside of wmi.c/rx_reorder.c ===*/
+
+bool use_pcp_for_ap;
+char *passphrase;
+
+int wil_err(struct wil6210_priv *wil, const char *fmt, ...)
+{
+	va_list args;
+
+	EV_INC(errors);
+	if (!verbose)
+		return 0;
+
+	va_start(args, fmt);
+	fprintf(stderr, "wil6210: ");
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	return 0;
+}
+
+int wil_info(struct wil6210_priv *wil, const char *fmt, ...)
+{
+	return 0;
+}
+
+int wil_dbg_trace(struct wil6210_priv *wil, const char *fmt, ...)
+{
+	return 0;
+}
+
+/* summary only, no buckets */
+void wil_hist_add(struct wil_hist *h, u32 usec)
+{
+	if (!h->count || usec < h->min)
+		h->min = usec;
+	if (usec > h->max)
+		h->max = usec;
+	h->count++;
+	h->sum += usec;
+}
+
+void wil_netif_rx_any(struct sk_buff *skb, struct net_device *ndev)
+{
+	kfree_skb(skb);
+}
+
+/* no Rx here, reorder contexts never hold frames */
+void wil6210_schedule_rx(struct wil6210_priv *wil)
+{
+}
+
+void wil_mbox_ring_le2cpus(struct wil6210_mbox_ring *r)
+{
+	le32_to_cpus(&r->base);
+	le16_to_cpus(&r->entry_size);
+	le16_to_cpus(&r->size);
+	le32_to_cpus(&r->tail);
+	le32_to_cpus(&r->head);
+}
+
+int wil_find_cid(struct wil6210_priv *wil, const u8 *mac)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(wil->sta); i++)
+		if (wil->sta[i].status != wil_sta_unused &&
+		    !memcmp(wil->sta[i].addr, mac, ETH_ALEN))
+			return i;
+
+	return -ENOENT;
+}
+
+/*
+ * Tx vring reservation of wil_vring_init_tx(), wil_vring_init_tx_done()
+ * and wil_vring_fini_tx(), and wil_tx_vring_fw_done(), without DMA:
+ * txrx.c does not build here. Keep in sync with the driver
+ */
+#define EMU_VRING_CFG_CTX(id, gen) ((void *)(((ulong)(gen) << 8) | (id)))
+#define EMU_VRING_CFG_ID(ctx) ((int)((ulong)(ctx) & 0xff))
+#define EMU_VRING_CFG_GEN(ctx) ((u16)((ulong)(ctx) >> 8))
+
+static u32 emu_vring_mem; /* stands for descriptors of any vring */
+
+static void emu_vring_fini_tx(struct wil6210_priv *wil, int id)
+{
+	struct vring_tx_data *txdata = &wil->vring_tx_data[id];
+
+	if (!wil->vring_tx[id].va)
+		return;
+
+	spin_lock(&wil->vring_cfg_lock);
+	if (txdata->cfg_pending) {
+		txdata->cfg_orphan = true;
+		spin_unlock(&wil->vring_cfg_lock);
+		return;
+	}
+	spin_unlock(&wil->vring_cfg_lock);
+
+	/* wil_tx_vring_pool_put() */
+	if (txdata->fw_done)
+		EV_INC(vring_pooled);
+	else
+		EV_INC(vring_freed);
+	wil->vring_tx[id].va = NULL;
+}
+
+void wil_tx_vring_fw_done(struct wil6210_priv *wil, int cid)
+{
+	uint i;
+
+	spin_lock(&wil->vring_cfg_lock);
+	for (i = 0; i < ARRAY_SIZE(wil->vring_tx); i++) {
+		if (!wil->vring_tx[i].va)
+			continue;
+		if (cid < 0 || wil->vring2cid_tid[i][0] == cid)
+			wil->vring_tx_data[i].fw_done = true;
+	}
+	spin_unlock(&wil->vring_cfg_lock);
+}
+
+static int emu_vring_init_tx(struct wil6210_priv *wil, int id, int cid,
+			     wil_wmi_cb cb)
+{
+	struct wmi_vring_cfg_cmd cmd = {
+		.action = cpu_to_le32(WMI_VRING_CMD_ADD),
+		.vring_cfg = {
+			.tx_sw_ring = {
+				.max_mpdu_size = cpu_to_le16(TX_BUF_LEN),
+				.ring_size = cpu_to_le16(WIL6210_TX_RING_SIZE),
+			},
+			.ringid = id,
+			.cidxtid = mk_cidxtid(cid, 0),
+			.encap_trans_type = WMI_VRING_ENC_TYPE_802_3,
+		},
+	};
+	struct vring_tx_data *txdata = &wil->vring_tx_data[id];
+	u16 gen;
+	int rc;
+
+	spin_lock(&wil->vring_cfg_lock);
+	gen = txdata->cfg_gen + 1;
+	memset(txdata, 0, sizeof(*txdata));
+	txdata->cfg_gen = gen;
+	spin_unlock(&wil->vring_cfg_lock);
+
+	wil->vring_tx[id].va = (void *)&emu_vring_mem;
+	wil->vring2cid_tid[id][0] = cid;
+	wil->vring2cid_tid[id][1] = 0;
+
+	spin_lock(&wil->vring_cfg_lock);
+	txdata->cfg_pending = true;
+	spin_unlock(&wil->vring_cfg_lock);
+	rc = wmi_call_async(wil, WMI_VRING_CFG_CMDID, &cmd, sizeof(cmd),
+			    WMI_VRING_CFG_DONE_EVENTID,
+			    sizeof(struct wil6210_mbox_hdr_wmi) +
+			    sizeof(struct wmi_vring_cfg_done_event),
+			    100, cb, EMU_VRING_CFG_CTX(id, gen));
+	if (rc) {
+		spin_lock(&wil->vring_cfg_lock);
+		txdata->cfg_pending = false;
+		txdata->cfg_orphan = false;
+		txdata->fw_done = true;
+		spin_unlock(&wil->vring_cfg_lock);
+		wil->vring_tx[id].va = NULL;
+	}
+
+	return rc;
+}
+
+static int emu_vring_init_tx_done(struct wil6210_priv *wil, void *ctx,
+				  int rc, void *reply, u16 len, int *id)
+{
+	struct {
+		struct wil6210_mbox_hdr_wmi wmi;
+		struct wmi_vring_cfg_done_event cmd;
+	} __packed *r = reply;
+	struct vring_tx_data *txdata;
+	bool orphan;
+
+	*id = EMU_VRING_CFG_ID(ctx);
+	txdata = &wil->vring_tx_data[*id];
+
+	spin_lock(&wil->vring_cfg_lock);
+	if (!txdata->cfg_pending ||
+	    txdata->cfg_gen != EMU_VRING_CFG_GEN(ctx)) {
+		spin_unlock(&wil->vring_cfg_lock);
+		return -ESTALE;
+	}
+	txdata->cfg_pending = false;
+	orphan = txdata->cfg_orphan;
+	txdata->cfg_orphan = false;
+	spin_unlock(&wil->vring_cfg_lock);
+
+	if (!rc && (len < sizeof(*r) || r->cmd.ringid != *id))
+		rc = -EINVAL;
+	if (!rc && r->cmd.status != WMI_FW_STATUS_SUCCESS) {
+		txdata->fw_done = true;
+		rc = -EINVAL;
+	}
+	if (!rc && !orphan)
+		return 0;
+
+	emu_vring_fini_tx(wil, *id);
+
+	return orphan ? -ESTALE : rc;
+}
+
+static void emu_disconnect_cid(struct wil6210_priv *wil, int cid)
+{
+	struct wil_sta_info *sta = &wil->sta[cid];
+	uint i;
+
+	spin_lock(&wil->vring_cfg_lock);
+	sta->status = wil_sta_unused;
+	spin_unlock(&wil->vring_cfg_lock);
+	clear_bit(cid, &wil->pending_connect);
+	for (i = 0; i < WIL_STA_TID_NUM; i++)
+		wil_tid_ampdu_rx_set(wil, sta, i, NULL);
+	for (i = 0; i < ARRAY_SIZE(wil->vring_tx); i++)
+		if (wil->vring2cid_tid[i][0] == cid)
+			emu_vring_fini_tx(wil, i);
+	memset(&sta->link, 0, sizeof(sta->link));
+	if (wil->sinfo_notify_cid == cid)
+		wil->sinfo_notify_cid = -1;
+}
+
+void wil6210_disconnect(struct wil6210_priv *wil, void *bssid)
+{
+	int cid;
+
+	EV_INC(disconnect);
+	cid = bssid ? wil_find_cid(wil, bssid) : -ENOENT;
+	if (cid >= 0) {
+		emu_disconnect_cid(wil, cid);
+		return;
+	}
+	for (cid = 0; cid < WIL6210_MAX_CID; cid++)
+		emu_disconnect_cid(wil, cid);
+}
+
+/*
+ * wil_connect_worker(), wil_connect_failed() and wil_connect_vring_done(),
+ * as in main.c
+ */
+static void emu_connect_failed(struct wil6210_priv *wil, int cid)
+{
+	struct wil_sta_info *sta = &wil->sta[cid];
+
+	spin_lock(&wil->vring_cfg_lock);
+	if (sta->status == wil_sta_conn_pending &&
+	    !test_bit(cid, &wil->pending_connect))
+		sta->status = wil_sta_unused;
+	spin_unlock(&wil->vring_cfg_lock);
+}
+
+static void emu_connect_vring_done(struct wil6210_priv *wil, void *ctx,
+				   int rc, void *reply, u16 len)
+{
+	int ringid, cid;
+	struct wil_sta_info *sta;
+	bool gone;
+
+	rc = emu_vring_init_tx_done(wil, ctx, rc, reply, len, &ringid);
+	if (rc == -ESTALE)
+		return;
+
+	cid = wil->vring2cid_tid[ringid][0];
+	sta = &wil->sta[cid];
+
+	spin_lock(&wil->vring_cfg_lock);
+	gone = sta->status != wil_sta_conn_pending ||
+	       test_bit(cid, &wil->pending_connect);
+	if (!gone)
+		sta->status = rc ? wil_sta_unused : wil_sta_connected;
+	spin_unlock(&wil->vring_cfg_lock);
+
+	if (gone && !rc) {
+		wmi_vring_delete(wil, ringid);
+		emu_vring_fini_tx(wil, ringid);
+	}
+}
+
+static void emu_connect_worker(struct work_struct *work)
+{
+	struct wil6210_priv *wil = container_of(work, struct wil6210_priv,
+						connect_worker);
+	int cid, ringid, rc;
+
+	for (cid = 0; cid < WIL6210_MAX_CID; cid++) {
+		if (!test_and_clear_bit(cid, &wil->pending_connect))
+			continue;
+
+		/* wil_find_free_vring() */
+		for (ringid = 0; ringid < WIL6210_MAX_TX_RINGS; ringid++)
+			if (!wil->vring_tx[ringid].va)
+				break;
+		if (ringid == WIL6210_MAX_TX_RINGS) {
+			emu_connect_failed(wil, cid);
+			continue;
+		}
+
+		rc = emu_vring_init_tx(wil, ringid, cid,
+				       emu_connect_vring_done);
+		if (rc)
+			emu_connect_failed(wil, cid);
+	}
+}
+
+/*=== misc. IRQ, as in interrupt.c ===*/
+
+static struct {
+	pthread_t thread;
+	pthread_mutex_t m;
+	pthread_cond_t c;
+	u32 isr;
+	bool stop;
+} irq;
+
+static void emu_irq(void *ctx, u32 isr)
+{
+	pthread_mutex_lock(&irq.m);
+	irq.isr |= isr;
+	pthread_cond_signal(&irq.c);
+	pthread_mutex_unlock(&irq.m);
+}
+
+static void *irq_thread(void *arg)
+{
+	struct wil6210_priv *wil = arg;
+	u32 isr;
+
+	pthread_mutex_lock(&irq.m);
+	while (!irq.stop) {
+		if (!irq.isr) {
+			pthread_cond_wait(&irq.c, &irq.m);
+			continue;
+		}
+		isr = irq.isr;
+		irq.isr = 0;
+		pthread_mutex_unlock(&irq.m);
+
+		/* hard IRQ part */
+		if (isr & ISR_MISC_FW_READY) {
+			wil_memcpy_fromio_32(&wil->mbox_ctl,
+					     wil->csr + HOST_MBOX,
+					     sizeof(struct wil6210_mbox_ctl));
+			wil_mbox_ring_le2cpus(&wil->mbox_ctl.rx);
+			wil_mbox_ring_le2cpus(&wil->mbox_ctl.tx);
+			set_bit(wil_status_reset_done, &wil->status);
+		}
+		/* thread part */
+		if (isr & ISR_MISC_MBOX_EVT) {
+			wmi_recv_cmd(wil);
+			wake_up(&wil->wmi_mbox_wq);
+		}
+
+		pthread_mutex_lock(&irq.m);
+	}
+	pthread_mutex_unlock(&irq.m);
+
+	return NULL;
+}
+
+/*=== device ===*/
+
+static struct wiphy wiphy;
+static struct wireless_dev wdev;
+static struct net_device ndev;
+
+/* wil_priv_init() subset */
+static int emu_init(void)
+{
+	static struct wil6210_priv priv;
+
+	wil = &priv;
+	ndev.ieee80211_ptr = &wdev;
+	wdev.netdev = &ndev;
+	wdev.wiphy = &wiphy;
+	wdev.iftype = NL80211_IFTYPE_AP;
+	wil->wdev = &wdev;
+
+	mutex_init(&wil->mutex);
+	mutex_init(&wil->wmi_mutex);
+	mutex_init(&wil->back_mutex);
+	init_completion(&wil->wmi_ready);
+	wil_back_policy_init(wil);
+	wil->pending_connect = 0;
+	wil->sinfo_notify_cid = -1;
+
+	INIT_WORK(&wil->connect_worker, emu_connect_worker);
+	INIT_WORK(&wil->wmi_event_worker, wmi_event_worker);
+	INIT_WORK(&wil->back_worker, wil_back_worker);
+	INIT_LIST_HEAD(&wil->pending_wmi_ev);
+	INIT_LIST_HEAD(&wil->back_pending);
+	spin_lock_init(&wil->wmi_ev_lock);
+	INIT_LIST_HEAD(&wil->wmi_ev_free);
+	INIT_LIST_HEAD(&wil->wmi_calls);
+	spin_lock_init(&wil->wmi_call_lock);
+	spin_lock_init(&wil->vring_cfg_lock);
+	sema_init(&wil->wmi_call_sem, WIL_WMI_CALLS_MAX);
+	spin_lock_init(&wil->wmi_cmd_stat_lock);
+	INIT_DELAYED_WORK(&wil->wmi_call_expire, wmi_call_expire);
+	init_waitqueue_head(&wil->wmi_mbox_wq);
+	spin_lock_init(&wil->tid_rx_lock);
+	INIT_LIST_HEAD(&wil->rx_reorder_retired);
+
+	wil->wmi_wq = wq_create(WIL_NAME"_wmi");
+	wil->wmi_wq_conn = wq_create(WIL_NAME"_connect");
+	wil->back_wq = wq_create(WIL_NAME"_back");
+	if (!wil->wmi_wq || !wil->wmi_wq_conn || !wil->back_wq)
+		return -ENOMEM;
+
+	fw = fw_emu_create(emu_irq, wil);
+	if (!fw)
+		return -ENOMEM;
+	wil->csr = fw_emu_bar(fw);
+
+	pthread_mutex_init(&irq.m, NULL);
+	pthread_cond_init(&irq.c, NULL);
+	if (pthread_create(&irq.thread, NULL, irq_thread, wil))
+		return -EAGAIN;
+
+	return 0;
+}
+
+static void emu_fini(void)
+{
+	fw_emu_stop(fw);
+
+	pthread_mutex_lock(&irq.m);
+	irq.stop = true;
+	pthread_cond_signal(&irq.c);
+	pthread_mutex_unlock(&irq.m);
+	pthread_join(irq.thread, NULL);
+
+	/* expiry work lives on wmi_wq */
+	wmi_call_flush(wil, -ESHUTDOWN);
+	wq_destroy(wil->wmi_wq_conn);
+	wq_destroy(wil->wmi_wq);
+	wmi_event_flush(wil);
+	wil6210_disconnect(wil, NULL);
+	wil_back_flush(wil);
+	wq_destroy(wil->back_wq);
+	wmi_ev_pool_free(wil);
+	fw_emu_destroy(fw);
+}
+
+/*=== functional test ===*/
+
+static const u8 peer[ETH_ALEN] = {0x04, 0xce, 0x14, 0x00, 0x00, 0x02};
+static int peer_cid = -1;
+
+#define FAIL(fmt, ...) do { \
+	printf("  " fmt "\n", ##__VA_ARGS__); \
+	return -1; \
+} while (0)
+
+static int test_boot(void)
+{
+	int rc = fw_emu_start(fw);
+
+	if (rc)
+		FAIL("fw_emu_start: %d", rc);
+	if (!wait_for_completion_timeout(&wil->wmi_ready,
+					 msecs_to_jiffies(1000)))
+		FAIL("no WMI_FW_READY");
+	if (!test_bit(wil_status_fwready, &wil->status))
+		FAIL("FW ready status not set");
+	if (!is_valid_ether_addr(ndev.dev_addr))
+		FAIL("MAC not set from WMI_READY");
+	if (!wiphy.fw_version[0])
+		FAIL("FW version not set from WMI_READY");
+	/* as wil_reset() does */
+	wmi_ev_pool_init(wil);
+	if (!wil->wmi_ev_pool)
+		FAIL("no event pool");
+
+	return 0;
+}
+
+static int test_echo(void)
+{
+	int rc = wmi_echo(wil);
+
+	if (rc)
+		FAIL("wmi_echo: %d", rc);
+
+	return 0;
+}
+
+static int test_timeout(void)
+{
+	struct fw_emu_rule *rule = fw_emu_rule(fw, WMI_ECHO_CMDID);
+	struct wmi_echo_event late = {
+		.echoed_value = cpu_to_le32(0x12345678),
+	};
+	u32 stale = wil->wmi_calls_stale;
+	int rc;
+
+	rule->drop = true;
+	rc = wmi_echo(wil);
+	rule->drop = false;
+	if (rc != -ETIME)
+		FAIL("dropped echo: %d, expected %d", rc, -ETIME);
+	if (!wil->wmi_calls_timeout)
+		FAIL("timeout not counted");
+	if (wil->wmi_calls_inflight)
+		FAIL("%d calls left in flight", wil->wmi_calls_inflight);
+	/* late reply absorbed, doesn't complete the next call */
+	fw_emu_post(fw, WMI_ECHO_RSP_EVENTID, &late, sizeof(late));
+	if (!wait_for(wil->wmi_calls_stale == stale + 1, 1000))
+		FAIL("late reply not absorbed");
+	rc = wmi_echo(wil);
+	if (rc)
+		FAIL("echo after late reply: %d", rc);
+
+	/* no late reply: stand-in expires, nothing stuck behind it */
+	rule->drop = true;
+	rc = wmi_echo(wil);
+	rule->drop = false;
+	if (rc != -ETIME)
+		FAIL("dropped echo: %d, expected %d", rc, -ETIME);
+	if (!wait_for(list_empty(&wil->wmi_calls), 1000))
+		FAIL("stale call not expired");
+	rc = wmi_echo(wil);
+	if (rc)
+		FAIL("echo after timeout: %d", rc);
+
+	return 0;
+}
+
+static int test_mgmt_tx(void)
+{
+	struct ieee80211_mgmt frame = {
+		.frame_control = cpu_to_le16(IEEE80211_FTYPE_MGMT | 0x00d0),
+	};
+	int ack = EV(mgmt_tx_ack);
+	int rc;
+
+	memcpy(frame.da, peer, ETH_ALEN);
+	rc = wmi_mgmt_tx(wil, (void *)&frame, 24, 0x1234, false);
+	if (rc)
+		FAIL("wmi_mgmt_tx: %d", rc);
+	if (!wait_for(EV(mgmt_tx_ack) == ack + 1, 1000))
+		FAIL("no Tx status");
+	if (ev.mgmt_tx_cookie != 0x1234)
+		FAIL("cookie 0x%llx", ev.mgmt_tx_cookie);
+
+	return 0;
+}
+
+static int test_flush(void)
+{
+	struct fw_emu_rule *rule = fw_emu_rule(fw, WMI_SW_TX_REQ_CMDID);
+	struct ieee80211_mgmt frame = {};
+	int nack = EV(mgmt_tx_nack);
+	int rc;
+
+	rule->drop = true;
+	memcpy(frame.da, peer, ETH_ALEN);
+	rc = wmi_mgmt_tx(wil, (void *)&frame, 24, 0x5678, false);
+	if (rc) {
+		rule->drop = false;
+		FAIL("wmi_mgmt_tx: %d", rc);
+	}
+	/* as on FW reset */
+	wmi_call_flush(wil, -ESHUTDOWN);
+	rule->drop = false;
+	if (EV(mgmt_tx_nack) != nack + 1 || ev.mgmt_tx_cookie != 0x5678)
+		FAIL("flushed call not reported");
+
+	return 0;
+}
+
+/* no Tx status with no_ack; no free call slot fails without waiting */
+static int test_mgmt_tx_busy(void)
+{
+	struct fw_emu_rule *rule = fw_emu_rule(fw, WMI_SW_TX_REQ_CMDID);
+	struct ieee80211_mgmt frame = {};
+	int ack = EV(mgmt_tx_ack), nack = EV(mgmt_tx_nack);
+	struct timespec t0, t1;
+	int rc, i;
+
+	memcpy(frame.da, peer, ETH_ALEN);
+	rc = wmi_mgmt_tx(wil, (void *)&frame, 24, 0x9abc, true);
+	if (rc)
+		FAIL("wmi_mgmt_tx: %d", rc);
+	if (!wait_for(list_empty(&wil->wmi_calls), 1000))
+		FAIL("no_ack frame not completed");
+	if (EV(mgmt_tx_ack) != ack || EV(mgmt_tx_nack) != nack)
+		FAIL("Tx status reported for no_ack frame");
+
+	rule->drop = true;
+	for (i = 0; i < WIL_WMI_CALLS_MAX; i++) {
+		rc = wmi_mgmt_tx(wil, (void *)&frame, 24, 0x100 + i, false);
+		if (rc) {
+			rule->drop = false;
+			wmi_call_flush(wil, -ESHUTDOWN);
+			FAIL("wmi_mgmt_tx #%d: %d", i, rc);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	rc = wmi_mgmt_tx(wil, (void *)&frame, 24, 0x200, false);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	rule->drop = false;
+	wmi_call_flush(wil, -ESHUTDOWN);
+	if (rc != -EBUSY)
+		FAIL("no free slot: %d", rc);
+	if ((t1.tv_sec - t0.tv_sec) * 1000 +
+	    (t1.tv_nsec - t0.tv_nsec) / 1000000 > 100)
+		FAIL("waited for a free slot");
+	if (EV(mgmt_tx_nack) != nack + WIL_WMI_CALLS_MAX)
+		FAIL("%d frames flushed", EV(mgmt_tx_nack) - nack);
+
+	return 0;
+}
+
+static int test_connect(void)
+{
+	struct wmi_connect_cmd cmd = {
+		.network_type = WMI_NETTYPE_P2P,
+		.channel = 0,
+	};
+	int new_sta = EV(new_sta);
+	int rc;
+
+	memcpy(cmd.bssid, peer, ETH_ALEN);
+	rc = wmi_send(wil, WMI_CONNECT_CMDID, &cmd, sizeof(cmd));
+	if (rc)
+		FAIL("wmi_send(CONNECT): %d", rc);
+	if (!wait_for(EV(new_sta) == new_sta + 1, 1000))
+		FAIL("no cfg80211_new_sta()");
+	peer_cid = wil_find_cid(wil, peer);
+	if (peer_cid < 0)
+		FAIL("peer not found");
+	/* connect worker configures Tx vring */
+	if (!wait_for(wil->sta[peer_cid].status == wil_sta_connected, 1000))
+		FAIL("CID %d not connected, status %d", peer_cid,
+		     wil->sta[peer_cid].status);
+
+	return 0;
+}
+
+static int test_back(void)
+{
+	int rc;
+
+	if (peer_cid < 0)
+		FAIL("not connected");
+	rc = wmi_addba(wil, peer_cid, 16, 0);
+	if (rc)
+		FAIL("wmi_addba: %d", rc);
+	if (!wait_for(wil->sta[peer_cid].tid_rx[0] != NULL, 1000))
+		FAIL("no reorder buffer after BA_STATUS");
+	if (wil->vring_tx_data[peer_cid].agg_wsize != 16)
+		FAIL("agg_wsize %d", wil->vring_tx_data[peer_cid].agg_wsize);
+
+	return 0;
+}
+
+static int test_notify(void)
+{
+	struct wmi_notify_req_done_event evt = {
+		.tsf = cpu_to_le64(0x1000),
+		.bf_mcs = cpu_to_le16(5),
+		.sqi = 70,
+	};
+	int rc;
+
+	if (peer_cid < 0)
+		FAIL("not connected");
+	wil->sinfo_notify_cid = peer_cid;
+	rc = fw_emu_post(fw, WMI_NOTIFY_REQ_DONE_EVENTID, &evt, sizeof(evt));
+	if (rc)
+		FAIL("fw_emu_post: %d", rc);
+	if (!wait_for(wil->sta[peer_cid].link.updated, 1000))
+		FAIL("link status not updated");
+	if (wil->sta[peer_cid].link.bf_mcs != 5 ||
+	    wil->sta[peer_cid].link.sqi != 70)
+		FAIL("link status garbled");
+
+	return 0;
+}
+
+static int test_disconnect(void)
+{
+	int disconnect = EV(disconnect), pooled = EV(vring_pooled);
+	int rc;
+
+	if (peer_cid < 0)
+		FAIL("not connected");
+	rc = wmi_disconnect_sta(wil, peer, WLAN_STATUS_UNSPECIFIED_FAILURE);
+	if (rc)
+		FAIL("wmi_disconnect_sta: %d", rc);
+	if (!wait_for(EV(disconnect) == disconnect + 1, 1000))
+		FAIL("no disconnect");
+	if (wil->sta[peer_cid].status != wil_sta_unused ||
+	    wil->sta[peer_cid].tid_rx[0])
+		FAIL("CID %d not cleaned up", peer_cid);
+	/* FW reported the station gone */
+	if (EV(vring_pooled) != pooled + 1)
+		FAIL("Tx vring not pooled");
+	peer_cid = -1;
+
+	return 0;
+}
+
+/* AP after reboot: all stations connect at once */
+static int test_connect_burst(void)
+{
+	struct wmi_connect_cmd cmd = {
+		.network_type = WMI_NETTYPE_P2P,
+	};
+	int new_sta = EV(new_sta), disconnect = EV(disconnect);
+	int cid, i, rc;
+
+	for (i = 0; i < WIL6210_MAX_CID; i++) {
+		memcpy(cmd.bssid, peer, ETH_ALEN);
+		cmd.bssid[5] = 0x10 + i;
+		rc = wmi_send(wil, WMI_CONNECT_CMDID, &cmd, sizeof(cmd));
+		if (rc)
+			FAIL("wmi_send(CONNECT) #%d: %d", i, rc);
+	}
+	if (!wait_for(EV(new_sta) == new_sta + WIL6210_MAX_CID, 1000))
+		FAIL("%d of %d stations reported", EV(new_sta) - new_sta,
+		     WIL6210_MAX_CID);
+	for (cid = 0; cid < WIL6210_MAX_CID; cid++)
+		if (!wait_for(wil->sta[cid].status == wil_sta_connected, 1000))
+			FAIL("CID %d not connected, status %d", cid,
+			     wil->sta[cid].status);
+
+	for (cid = 0; cid < WIL6210_MAX_CID; cid++) {
+		rc = wmi_disconnect_sta(wil, wil->sta[cid].addr,
+					WLAN_STATUS_UNSPECIFIED_FAILURE);
+		if (rc)
+			FAIL("wmi_disconnect_sta(CID %d): %d", cid, rc);
+	}
+	if (!wait_for(EV(disconnect) == disconnect + WIL6210_MAX_CID, 1000))
+		FAIL("%d of %d stations disconnected",
+		     EV(disconnect) - disconnect, WIL6210_MAX_CID);
+
+	return 0;
+}
+
+/* Tx vring of @cid waiting for its config reply; -1 if none */
+static int emu_cfg_vring(int cid, bool orphan)
+{
+	int i;
+
+	for (i = 0; i < WIL6210_MAX_TX_RINGS; i++)
+		if (wil->vring_tx[i].va && wil->vring2cid_tid[i][0] == cid &&
+		    wil->vring_tx_data[i].cfg_pending &&
+		    wil->vring_tx_data[i].cfg_orphan == orphan)
+			return i;
+
+	return -1;
+}
+
+/*
+ * peer leaves after the connect worker took it, before its Tx vring is
+ * recorded for the CID: vring is dropped when configured
+ */
+static int test_connect_gone(void)
+{
+	int cid = 2, left = 0;
+	int freed = EV(vring_freed), pooled = EV(vring_pooled);
+	uint i;
+
+	/* wmi_evt_connect() then wil_disconnect_cid() in the window */
+	wil->sta[cid].status = wil_sta_unused;
+	set_bit(cid, &wil->pending_connect);
+	queue_work(wil->wmi_wq_conn, &wil->connect_worker);
+
+	if (!wait_for(EV(vring_freed) + EV(vring_pooled) ==
+		      freed + pooled + 1, 1000))
+		FAIL("Tx vring of gone CID %d leaked", cid);
+	for (i = 0; i < WIL6210_MAX_TX_RINGS; i++)
+		if (wil->vring_tx[i].va)
+			left++;
+	if (left)
+		FAIL("%d Tx vrings left", left);
+	if (wil->sta[cid].status != wil_sta_unused)
+		FAIL("CID %d status %d", cid, wil->sta[cid].status);
+	/* delete command completes */
+	if (!wait_for(list_empty(&wil->wmi_calls), 1000))
+		FAIL("calls left in flight");
+
+	return 0;
+}
+
+/* peer leaves while its Tx vring is configured, and comes back at once */
+static int test_reconnect(void)
+{
+	struct fw_emu_rule *rule = fw_emu_rule(fw, WMI_VRING_CFG_CMDID);
+	struct wmi_connect_cmd cmd = {
+		.network_type = WMI_NETTYPE_P2P,
+	};
+	int new_sta = EV(new_sta), disconnect = EV(disconnect);
+	int pooled = EV(vring_pooled), freed = EV(vring_freed);
+	int cid, old, ring, rc;
+
+	memcpy(cmd.bssid, peer, ETH_ALEN);
+	/* no config reply: both commands stay in flight till timeout */
+	rule->drop = true;
+	rc = wmi_send(wil, WMI_CONNECT_CMDID, &cmd, sizeof(cmd));
+	if (rc)
+		FAIL("wmi_send(CONNECT): %d", rc);
+	if (!wait_for(EV(new_sta) == new_sta + 1, 1000))
+		FAIL("no cfg80211_new_sta()");
+	cid = wil_find_cid(wil, peer);
+	if (cid < 0)
+		FAIL("peer not found");
+	if (!wait_for(emu_cfg_vring(cid, false) >= 0, 1000))
+		FAIL("no Tx vring config for CID %d", cid);
+	old = emu_cfg_vring(cid, false);
+	/* apart enough for the two timeouts to expire one by one */
+	usleep(50 * 1000);
+
+	rc = wmi_disconnect_sta(wil, peer, WLAN_STATUS_UNSPECIFIED_FAILURE);
+	if (rc)
+		FAIL("wmi_disconnect_sta: %d", rc);
+	if (!wait_for(EV(disconnect) == disconnect + 1, 1000))
+		FAIL("no disconnect");
+	if (emu_cfg_vring(cid, true) != old)
+		FAIL("vring [%d] released during config", old);
+
+	rc = wmi_send(wil, WMI_CONNECT_CMDID, &cmd, sizeof(cmd));
+	if (rc)
+		FAIL("wmi_send(CONNECT) again: %d", rc);
+	if (!wait_for(EV(new_sta) == new_sta + 2, 1000))
+		FAIL("no cfg80211_new_sta() on reconnect");
+	if (wil_find_cid(wil, peer) != cid)
+		FAIL("CID %d not reused", cid);
+	if (!wait_for(emu_cfg_vring(cid, false) >= 0, 1000))
+		FAIL("no Tx vring config for CID %d again", cid);
+	ring = emu_cfg_vring(cid, false);
+	if (ring == old)
+		FAIL("vring [%d] reused while configured", old);
+
+	/* first timeout frees the released vring, nothing else */
+	if (!wait_for(!wil->vring_tx[old].va, 1000))
+		FAIL("released vring [%d] not freed", old);
+	/* FW reported disconnect after the command, it is done with it */
+	if (EV(vring_pooled) != pooled + 1)
+		FAIL("released vring [%d] not pooled", old);
+	if (wil->sta[cid].status != wil_sta_conn_pending ||
+	    emu_cfg_vring(cid, false) != ring)
+		FAIL("stale completion hit CID %d, status %d", cid,
+		     wil->sta[cid].status);
+	rule->drop = false;
+	if (!wait_for(wil->sta[cid].status == wil_sta_unused, 1000))
+		FAIL("CID %d config did not time out", cid);
+	if (wil->vring_tx[ring].va)
+		FAIL("vring [%d] not freed on timeout", ring);
+	/* FW may configure it yet */
+	if (EV(vring_freed) != freed + 1)
+		FAIL("vring [%d] pooled on timeout", ring);
+
+	/* stand-ins for the lost replies would absorb the next ones */
+	if (!wait_for(list_empty(&wil->wmi_calls), 1000))
+		FAIL("stale calls not expired");
+	rc = wmi_disconnect_sta(wil, peer, WLAN_STATUS_UNSPECIFIED_FAILURE);
+	if (rc)
+		FAIL("wmi_disconnect_sta: %d", rc);
+	if (!wait_for(EV(disconnect) == disconnect + 2, 1000))
+		FAIL("no disconnect from FW");
+
+	return 0;
+}
+
+static const struct {
+	const char *name;
+	int (*fn)(void);
+} tests[] = {
+	{"boot", test_boot},
+	{"echo", test_echo},
+	{"timeout", test_timeout},
+	{"mgmt_tx", test_mgmt_tx},
+	{"flush", test_flush},
+	{"mgmt_tx_busy", test_mgmt_tx_busy},
+	{"connect", test_connect},
+	{"back", test_back},
+	{"notify", test_notify},
+	{"disconnect", test_disconnect},
+	{"burst", test_connect_burst},
+	{"connect_gone", test_connect_gone},
+	{"reconnect", test_reconnect},
+};
+
+static int run_tests(void)
+{
+	int failed = 0;
+	uint i;
+
+	for (i = 0; i < ARRAY_SIZE(tests); i++) {
+		int rc = tests[i].fn();
+
+		printf("%-12s %s\n", tests[i].name, rc ? "FAILED" : "ok");
+		if (rc) {
+			failed++;
+			if (i == 0) /* no FW - nothing else will work */
+				break;
+		}
+	}
+	printf("%d of %d tests failed\n", failed, (int)ARRAY_SIZE(tests));
+
+	return failed;
+}
+
+/*=== benchmarks ===*/
+
+static int cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void report_lat(const char *name, u32 *lat, unsigned long n,
+		       double elapsed)
+{
+	u64 sum = 0;
+	unsigned long i;
+
+	if (!n)
+		return;
+	for (i = 0; i < n; i++)
+		sum += lat[i];
+	qsort(lat, n, sizeof(*lat), cmp_u32);
+	printf("%-10s %8.0f calls/s, usec: avg %.1f p50 %u p99 %u max %u\n",
+	       name, n / elapsed, (double)sum / n, lat[n / 2],
+	       lat[n * 99 / 100], lat[n - 1]);
+}
+
+struct call_thread {
+	pthread_t thread;
+	u32 *lat;
+	unsigned long n;
+	int errors;
+};
+
+static void *call_thread(void *arg)
+{
+	struct call_thread *t = arg;
+	struct wmi_echo_cmd cmd = {
+		.value = cpu_to_le32(0x12345678),
+	};
+	unsigned long i;
+
+	for (i = 0; i < t->n; i++) {
+		ktime_t t0 = ktime_get();
+
+		if (wmi_call(wil, WMI_ECHO_CMDID, &cmd, sizeof(cmd),
+			     WMI_ECHO_RSP_EVENTID, NULL, 0, 1000))
+			t->errors++;
+		t->lat[i] = ktime_to_us(ktime_sub(ktime_get(), t0));
+	}
+
+	return NULL;
+}
+
+static int bench_calls(unsigned long n, int threads)
+{
+	struct call_thread *t = calloc(threads, sizeof(*t));
+	u32 *lat = calloc(n, sizeof(*lat));
+	unsigned long per = n / threads;
+	double t0, elapsed;
+	int errors = 0;
+	int i;
+
+	if (!t || !lat) {
+		free(t);
+		free(lat);
+		return -ENOMEM;
+	}
+
+	t0 = now_sec();
+	for (i = 0; i < threads; i++) {
+		t[i].lat = lat + i * per;
+		t[i].n = per;
+		pthread_create(&t[i].thread, NULL, call_thread, &t[i]);
+	}
+	for (i = 0; i < threads; i++) {
+		pthread_join(t[i].thread, NULL);
+		errors += t[i].errors;
+	}
+	elapsed = now_sec() - t0;
+
+	report_lat("wmi_call", lat, per * threads, elapsed);
+	if (errors)
+		printf("  %d calls failed\n", errors);
+
+	free(lat);
+	free(t);
+
+	return errors ? -EIO : 0;
+}
+
+static void async_cb(struct wil6210_priv *wil, void *ctx, int rc,
+		     void *reply, u16 len)
+{
+	if (rc)
+		EV_INC(async_err);
+	EV_INC(async_done);
+}
+
+static int bench_async(unsigned long n)
+{
+	struct wmi_echo_cmd cmd = {
+		.value = cpu_to_le32(0x12345678),
+	};
+	int done = EV(async_done), err = EV(async_err);
+	unsigned long i;
+	double t0, elapsed;
+	int rc;
+
+	t0 = now_sec();
+	/* submit blocks once WIL_WMI_CALLS_MAX are in flight */
+	for (i = 0; i < n; i++) {
+		rc = wmi_call_async(wil, WMI_ECHO_CMDID, &cmd, sizeof(cmd),
+				    WMI_ECHO_RSP_EVENTID, 0, 1000, async_cb,
+				    NULL);
+		if (rc) {
+			printf("  wmi_call_async: %d\n", rc);
+			return rc;
+		}
+	}
+	if (!wait_for(EV(async_done) == done + n, 10000)) {
+		printf("  %lu of %lu async calls completed\n",
+		       (unsigned long)(EV(async_done) - done), n);
+		return -ETIME;
+	}
+	elapsed = now_sec() - t0;
+
+	printf("%-10s %8.0f calls/s, max. in flight %u\n", "async",
+	       n / elapsed, wil->wmi_calls_inflight_max);
+	if (EV(async_err) != err)
+		printf("  %d calls failed\n", EV(async_err) - err);
+
+	return 0;
+}
+
+static void storm_update(void *data, unsigned long i)
+{
+	struct wmi_notify_req_done_event *evt = data;
+
+	evt->tsf = cpu_to_le64(i + 1);
+}
+
+static int bench_storm(unsigned long n)
+{
+	struct wmi_notify_req_done_event evt = {};
+	u32 empty = wil->wmi_ev_pool_empty;
+	struct wil_wmi_evt_stat *st = NULL;
+	struct fw_emu_stats fs0, fs1;
+	double t0, elapsed;
+	u16 id;
+	uint slot;
+	int rc;
+
+	for (slot = 0; slot < WIL_WMI_EVT_SLOTS; slot++)
+		if (wmi_evt_name(slot, &id) &&
+		    id == WMI_NOTIFY_REQ_DONE_EVENTID)
+			st = &wil->wmi_evt_stats[slot];
+
+	wil->sinfo_notify_cid = -1;
+	wil->stats.tsf = 0;
+	fw_emu_get_stats(fw, &fs0);
+	t0 = now_sec();
+	rc = fw_emu_storm(fw, WMI_NOTIFY_REQ_DONE_EVENTID, &evt, sizeof(evt),
+			  n, storm_update);
+	if (rc) {
+		printf("  fw_emu_storm: %d\n", rc);
+		return rc;
+	}
+	/* events handled in order, last one carries TSF @n */
+	if (!wait_for(__atomic_load_n(&wil->stats.tsf, __ATOMIC_SEQ_CST) == n,
+		      10000)) {
+		printf("  storm not drained, TSF %llu of %lu\n",
+		       wil->stats.tsf, n);
+		return -ETIME;
+	}
+	elapsed = now_sec() - t0;
+	fw_emu_get_stats(fw, &fs1);
+
+	printf("%-10s %8.0f events/s, IRQs %lu, Rx ring full %lu, "
+	       "pool empty %u\n", "storm", n / elapsed, fs1.irqs - fs0.irqs,
+	       fs1.rx_full - fs0.rx_full, wil->wmi_ev_pool_empty - empty);
+	if (st && st->count)
+		printf("  handler: avg %llu max %u nsec\n",
+		       st->time_ns / st->count, st->max_ns);
+
+	return 0;
+}
+
+static void report_mbox(void)
+{
+	struct wil_hist *h[] = {&wil->wmi_wait_head, &wil->wmi_wait_full};
+	const char *name[] = {"head busy", "ring full"};
+	struct fw_emu_stats fs;
+	uint i;
+
+	for (i = 0; i < ARRAY_SIZE(h); i++)
+		if (h[i]->count)
+			printf("mbox %s: %u waits, avg %llu max %u usec\n",
+			       name[i], h[i]->count, h[i]->sum / h[i]->count,
+			       h[i]->max);
+	fw_emu_get_stats(fw, &fs);
+	printf("fw: %lu commands (%lu unknown), %lu events, %lu IRQs\n",
+	       fs.cmds, fs.cmds_unknown, fs.events, fs.irqs);
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [options]\n"
+	       "  -b         benchmark instead of functional test\n"
+	       "  -n <num>   benchmark: calls (10000)\n"
+	       "  -j <num>   benchmark: threads doing wmi_call() (1)\n"
+	       "  -e <num>   benchmark: events in the storm (100000)\n"
+	       "  -d <usec>  FW reply delay for echo (0)\n"
+	       "  -s <usec>  FW busy polls doorbell for this long (100)\n"
+	       "  -S <usec>  FW sleeps between doorbell polls (50)\n"
+	       "  -v         print driver errors\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_t ticker;
+	bool bench = false;
+	unsigned long n = 10000, n_storm = 100000;
+	int threads = 1;
+	u32 delay = 0, spin_us = 100, sleep_us = 50;
+	int c, rc;
+
+	while ((c = getopt(argc, argv, "bn:j:e:d:s:S:vh")) != -1) {
+		switch (c) {
+		case 'b': bench = true; break;
+		case 'n': n = strtoul(optarg, NULL, 0); break;
+		case 'j': threads = atoi(optarg); break;
+		case 'e': n_storm = strtoul(optarg, NULL, 0); break;
+		case 'd': delay = strtoul(optarg, NULL, 0); break;
+		case 's': spin_us = strtoul(optarg, NULL, 0); break;
+		case 'S': sleep_us = strtoul(optarg, NULL, 0); break;
+		case 'v': verbose = true; break;
+		default:
+			usage(argv[0]);
+			return c == 'h' ? 0 : 1;
+		}
+	}
+	if (threads < 1 || n < (unsigned long)threads) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	jiffies = 1;
+	pthread_create(&ticker, NULL, ticker_thread, NULL);
+
+	rc = emu_init();
+	if (rc) {
+		fprintf(stderr, "init failed: %d\n", rc);
+		return 1;
+	}
+	fw_emu_set_poll(fw, spin_us, sleep_us);
+	fw_emu_rule(fw, WMI_ECHO_CMDID)->delay_us = delay;
+
+	if (!bench) {
+		rc = run_tests();
+	} else {
+		rc = test_boot();
+		if (!rc)
+			rc = bench_calls(n, threads);
+		if (!rc)
+			rc = bench_async(n);
+		if (!rc && n_storm)
+			rc = bench_storm(n_storm);
+		report_mbox();
+	}
+	if (verbose || rc)
+		printf("driver errors: %d\n", EV(errors));
+
+	emu_fini();
+	ticker_stop = true;
+	pthread_join(ticker, NULL);
+
+	return rc ? 1 : 0;
+}
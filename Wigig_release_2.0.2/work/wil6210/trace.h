@@ -69,6 +69,26 @@ DEFINE_EVENT(wil6210_wmi, wil6210_wmi_event,
 	TP_ARGS(id, buf, buf_len)
 );
 
+TRACE_EVENT(wil6210_wmi_call,
+	TP_PROTO(u16 cmdid, u16 reply_id, int rc, u32 usec),
+	TP_ARGS(cmdid, reply_id, rc, usec),
+	TP_STRUCT__entry(
+		__field(u16, cmdid)
+		__field(u16, reply_id)
+		__field(int, rc)
+		__field(u32, usec)
+	),
+	TP_fast_assign(
+		__entry->cmdid = cmdid;
+		__entry->reply_id = reply_id;
+		__entry->rc = rc;
+		__entry->usec = usec;
+	),
+	TP_printk("cmd 0x%04x -> 0x%04x rc %d in %u usec",
+		  __entry->cmdid, __entry->reply_id, __entry->rc,
+		  __entry->usec)
+);
+
 #define WIL6210_MSG_MAX (200)
 
 DECLARE_EVENT_CLASS(wil6210_log_event,
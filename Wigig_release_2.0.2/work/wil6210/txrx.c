@@ -21,6 +21,9 @@
 #include <linux/ip.h>
 #include <linux/ipv6.h>
 #include <net/ipv6.h>
+#ifdef CONFIG_NET_RX_BUSY_POLL
+#include <net/busy_poll.h>
+#endif
 
 #include "wil6210.h"
 #include "wmi.h"
@@ -39,6 +42,26 @@ module_param(rtap_include_phy_info, bool, S_IRUGO);
 MODULE_PARM_DESC(rtap_include_phy_info,
 		 " Include PHY info in the radiotap header, default - no");
 
+static uint tx_irq_frames = 1;
+module_param(tx_irq_frames, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(tx_irq_frames, " request Tx completion IRQ once per"
+		 " this many frames, default 1 - every frame");
+
+static uint tx_irq_fill = 50;
+module_param(tx_irq_fill, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(tx_irq_fill, " always request Tx completion IRQ when"
+		 " vring is filled above this percentage, default 50");
+
+static uint tx_reap_usec = 200;
+module_param(tx_reap_usec, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(tx_reap_usec, " reap Tx completions this many usec after"
+		 " frame sent without Tx completion IRQ, default 200");
+
+static uint tx_vring_pool = WIL_TX_VRING_POOL;
+module_param(tx_vring_pool, uint, S_IRUGO);
+MODULE_PARM_DESC(tx_vring_pool, " Tx vrings allocated at probe and reused"
+		 " across reconnects, default and max. 8");
+
 static inline int wil_vring_is_empty(struct vring *vring)
 {
 	return vring->swhead == vring->swtail;
@@ -112,6 +135,122 @@ static int wil_vring_alloc(struct wil6210_priv *wil, struct vring *vring)
 	return 0;
 }
 
+/*
+ * Tx vring memory pool.
+ *
+ * Stations flap on beam tracking loss; rather than dma_alloc_coherent()
+ * on every reconnect, keep descriptor ring and ctx array of a freed Tx
+ * vring for the next one. Pool is filled at probe, so reconnect works
+ * even when contiguous DMA memory is gone by then.
+ * All Tx vrings are WIL6210_TX_RING_SIZE, other sizes bypass the pool.
+ * Only vrings FW is known to be done with are pooled, see
+ * wil_tx_vring_fw_done(); others are freed, as the pool would hand
+ * them to the next station at once while FW may still write there.
+ */
+static bool wil_tx_vring_pool_get(struct wil6210_priv *wil,
+				  struct vring *vring)
+{
+	struct vring *v;
+	bool found = false;
+
+	if (vring->size != WIL6210_TX_RING_SIZE)
+		return false;
+
+	spin_lock(&wil->tx_vring_pool_lock);
+	if (wil->tx_vring_pool_n) {
+		v = &wil->tx_vring_pool[--wil->tx_vring_pool_n];
+		vring->pa = v->pa;
+		vring->va = v->va;
+		vring->ctx = v->ctx;
+		memset(v, 0, sizeof(*v));
+		found = true;
+	} else {
+		wil->tx_vring_pool_miss++;
+	}
+	spin_unlock(&wil->tx_vring_pool_lock);
+
+	vring->swhead = 0;
+	vring->swtail = 0;
+
+	return found;
+}
+
+/*
+ * Return drained Tx vring to the pool, in the state wil_vring_alloc()
+ * leaves it. Returns false if the pool is full, for the caller to free
+ */
+static bool wil_tx_vring_pool_put(struct wil6210_priv *wil,
+				  struct vring *vring)
+{
+	uint max = min_t(uint, tx_vring_pool, WIL_TX_VRING_POOL);
+	struct vring_tx_data *txdata = &wil->vring_tx_data[vring -
+							   wil->vring_tx];
+	bool taken = false;
+	uint i;
+
+	if (vring->size != WIL6210_TX_RING_SIZE || !txdata->fw_done)
+		return false;
+
+	memset(vring->ctx, 0, vring->size * sizeof(vring->ctx[0]));
+	for (i = 0; i < vring->size; i++)
+		vring->va[i].tx.dma.status = TX_DMA_STATUS_DU;
+
+	spin_lock(&wil->tx_vring_pool_lock);
+	if (wil->tx_vring_pool_n < max) {
+		wil->tx_vring_pool[wil->tx_vring_pool_n++] = *vring;
+		taken = true;
+	}
+	spin_unlock(&wil->tx_vring_pool_lock);
+
+	if (taken) {
+		vring->pa = 0;
+		vring->va = NULL;
+		vring->ctx = NULL;
+	}
+
+	return taken;
+}
+
+void wil_tx_vring_pool_init(struct wil6210_priv *wil)
+{
+	uint max = min_t(uint, tx_vring_pool, WIL_TX_VRING_POOL);
+	struct vring vring;
+
+	spin_lock_init(&wil->tx_vring_pool_lock);
+
+	/* best effort, connect allocates if pool runs out */
+	while (wil->tx_vring_pool_n < max) {
+		memset(&vring, 0, sizeof(vring));
+		vring.size = WIL6210_TX_RING_SIZE;
+		if (wil_vring_alloc(wil, &vring))
+			break;
+		wil->tx_vring_pool[wil->tx_vring_pool_n++] = vring;
+	}
+
+	wil_dbg_misc(wil, "Tx vring pool %d x %d\n", wil->tx_vring_pool_n,
+		     WIL6210_TX_RING_SIZE);
+}
+
+void wil_tx_vring_pool_free(struct wil6210_priv *wil)
+{
+	struct device *dev = wil_to_dev(wil);
+	struct vring *v;
+
+	spin_lock(&wil->tx_vring_pool_lock);
+	while (wil->tx_vring_pool_n) {
+		v = &wil->tx_vring_pool[--wil->tx_vring_pool_n];
+		spin_unlock(&wil->tx_vring_pool_lock);
+
+		dma_free_coherent(dev, v->size * sizeof(v->va[0]),
+				  (void *)v->va, v->pa);
+		kfree(v->ctx);
+		memset(v, 0, sizeof(*v));
+
+		spin_lock(&wil->tx_vring_pool_lock);
+	}
+	spin_unlock(&wil->tx_vring_pool_lock);
+}
+
 static void wil_vring_free(struct wil6210_priv *wil, struct vring *vring,
 			   int tx)
 {
@@ -150,6 +289,9 @@ static void wil_vring_free(struct wil6210_priv *wil, struct vring *vring,
 			wil_vring_advance_head(vring, 1);
 		}
 	}
+	if (tx && wil_tx_vring_pool_put(wil, vring))
+		return;
+
 	dma_free_coherent(dev, sz, (void *)vring->va, vring->pa);
 	kfree(vring->ctx);
 	vring->pa = 0;
@@ -325,15 +467,60 @@ static void wil_swap_ethaddr(void *data)
 	wil_swap_u16(s, d);
 }
 
+/*
+ * Non-data frames may be delivered through Rx DMA channel (ex: BAR)
+ * Driver should recognize it by frame type, that is found
+ * in Rx descriptor. If type is not data, it is 802.11 frame as is
+ */
+static int wil_rx_non_data(struct wil6210_priv *wil, struct sk_buff *skb)
+{
+	struct vring_rx_desc *d = wil_skb_rxdesc(skb);
+	u16 ftype = wil_rxdesc_ftype(d) << 2;
+	u16 stype = wil_rxdesc_subtype(d) << 4;
+	struct ieee80211_bar *bar = (void *)skb->data;
+	u16 ctl;
+
+	if (ftype != IEEE80211_FTYPE_CTL || stype != IEEE80211_STYPE_BACK_REQ) {
+		wil_dbg_txrx(wil, "Non-data frame ftype 0x%02x stype 0x%02x\n",
+			     ftype, stype);
+		return 0;
+	}
+
+	if (skb->len < sizeof(*bar)) {
+		wil_err(wil, "Short BAR, len = %d\n", skb->len);
+		return 0;
+	}
+
+	ctl = le16_to_cpu(bar->control);
+	if (ctl & IEEE80211_BAR_CTRL_MULTI_TID) {
+		wil_dbg_txrx(wil, "Multi-TID BAR not supported\n");
+		return 0;
+	}
+
+	return wil_rx_bar(wil, wil_rxdesc_cid(d),
+			  ctl >> IEEE80211_BAR_CTRL_TID_INFO_SHIFT,
+			  le16_to_cpu(bar->start_seq_num) >> 4);
+}
+
+/*
+ * Frames released from reorder buffer cost NAPI quota as well;
+ * they are already out, so only make sure quota does not go negative
+ */
+static inline void wil_rx_charge(int *quota, int n)
+{
+	*quota -= min(n, *quota);
+}
+
 /**
  * reap 1 frame from @swhead
  *
- * Rx descriptor copied to skb->cb
+ * Rx descriptor copied to skb->cb. Every descriptor reaped, including
+ * dropped ones, is charged to @quota; none reaped once it is used up
  *
  * Safe to call from IRQ
  */
 static struct sk_buff *wil_vring_reap_rx(struct wil6210_priv *wil,
-					 struct vring *vring)
+					 struct vring *vring, int *quota)
 {
 	struct device *dev = wil_to_dev(wil);
 	struct net_device *ndev = wil_to_ndev(wil);
@@ -350,6 +537,9 @@ static struct sk_buff *wil_vring_reap_rx(struct wil6210_priv *wil,
 
 	BUILD_BUG_ON(sizeof(struct vring_rx_desc) > sizeof(skb->cb));
 
+again:
+	if (*quota <= 0)
+		return NULL;
 	if (wil_vring_is_empty(vring))
 		return NULL;
 
@@ -383,28 +573,22 @@ static struct sk_buff *wil_vring_reap_rx(struct wil6210_priv *wil,
 			  (const void *)d1, sizeof(*d1), false);
 
 	wil_vring_advance_head(vring, 1);
+	(*quota)--;
 
 	/* no extra checks if in sniffer mode */
 	if (ndev->type != ARPHRD_ETHER)
 		return skb;
-	/*
-	 * Non-data frames may be delivered through Rx DMA channel (ex: BAR)
-	 * Driver should recognize it by frame type, that is found
-	 * in Rx descriptor. If type is not data, it is 802.11 frame as is
-	 */
 	ftype = wil_rxdesc_ftype(d1) << 2;
 	if (ftype != IEEE80211_FTYPE_DATA) {
-		wil_dbg_txrx(wil, "Non-data frame ftype 0x%08x\n", ftype);
-		/* TODO: process it */
+		wil_rx_charge(quota, wil_rx_non_data(wil, skb));
 		kfree_skb(skb);
-		return NULL;
+		goto again;
 	}
 
 	if (skb->len < ETH_HLEN) {
 		wil_err(wil, "Short frame, len = %d\n", skb->len);
-		/* TODO: process it (i.e. BAR) */
 		kfree_skb(skb);
-		return NULL;
+		goto again;
 	}
 
 	ds_bits = wil_rxdesc_ds_bits(d1);
@@ -502,11 +686,14 @@ void wil_rx_handle(struct wil6210_priv *wil, int *quota)
 		return;
 	}
 	wil_dbg_txrx(wil, "%s()\n", __func__);
-	while ((*quota > 0) && (NULL != (skb = wil_vring_reap_rx(wil, v)))) {
+	wil_rx_charge(quota, wil_rx_reorder_flush(wil));
+	while (NULL != (skb = wil_vring_reap_rx(wil, v, quota))) {
 		wil_hex_dump_txrx("Rx ", DUMP_PREFIX_OFFSET, 16, 1,
 				  skb->data, skb_headlen(skb), false);
 
-		(*quota)--;
+#ifdef CONFIG_NET_RX_BUSY_POLL
+		skb_mark_napi_id(skb, &wil->napi_rx);
+#endif
 
 		if (wil->wdev->iftype == NL80211_IFTYPE_MONITOR) {
 			skb->dev = ndev;
@@ -557,8 +744,29 @@ void wil_rx_fini(struct wil6210_priv *wil)
 		wil_vring_free(wil, vring, 0);
 }
 
+/* WMI_VRING_CFG_DONE_EVENTID as passed to wil_vring_init_tx() callback */
+struct wil_vring_cfg_reply {
+	struct wil6210_mbox_hdr_wmi wmi;
+	struct wmi_vring_cfg_done_event cmd;
+} __packed;
+
+/* callback ctx: vring id and its cfg_gen at the time command was sent */
+#define WIL_VRING_CFG_CTX(id, gen) ((void *)(((ulong)(gen) << 8) | (id)))
+#define WIL_VRING_CFG_ID(ctx) ((int)((ulong)(ctx) & 0xff))
+#define WIL_VRING_CFG_GEN(ctx) ((u16)((ulong)(ctx) >> 8))
+
+/**
+ * wil_vring_init_tx - allocate Tx vring and ask FW to configure it
+ *
+ * Does not wait for the firmware: reply goes to @cb on @wil->wmi_wq,
+ * that should finish with wil_vring_init_tx_done(). This way, vrings
+ * for several stations are configured at once.
+ * Until then, the vring stays allocated even if wil_vring_fini_tx()
+ * is called for it, so it is not reused while FW may write to it.
+ * On error, vring is freed and @cb is not called.
+ */
 int wil_vring_init_tx(struct wil6210_priv *wil, int id, int size,
-		      int cid, int tid)
+		      int cid, int tid, wil_wmi_cb cb)
 {
 	int rc;
 	struct wmi_vring_cfg_cmd cmd = {
@@ -579,61 +787,173 @@ int wil_vring_init_tx(struct wil6210_priv *wil, int id, int size,
 			},
 		},
 	};
-	struct {
-		struct wil6210_mbox_hdr_wmi wmi;
-		struct wmi_vring_cfg_done_event cmd;
-	} __packed reply;
 	struct vring *vring = &wil->vring_tx[id];
 	struct vring_tx_data *txdata = &wil->vring_tx_data[id];
+	u16 gen;
 
 	if (vring->va) {
 		wil_err(wil, "Tx ring [%d] already allocated\n", id);
-		rc = -EINVAL;
-		goto out;
+		return -EINVAL;
 	}
 
+	spin_lock(&wil->vring_cfg_lock);
+	gen = txdata->cfg_gen + 1;
 	memset(txdata, 0, sizeof(*txdata));
+	txdata->cfg_gen = gen;
+	spin_unlock(&wil->vring_cfg_lock);
+
 	vring->size = size;
-	rc = wil_vring_alloc(wil, vring);
-	if (rc)
-		goto out;
+	if (!wil_tx_vring_pool_get(wil, vring)) {
+		rc = wil_vring_alloc(wil, vring);
+		if (rc)
+			return rc;
+	}
 
 	wil->vring2cid_tid[id][0] = cid;
 	wil->vring2cid_tid[id][1] = tid;
 
 	cmd.vring_cfg.tx_sw_ring.ring_mem_base = cpu_to_le64(vring->pa);
 
-	rc = wmi_call(wil, WMI_VRING_CFG_CMDID, &cmd, sizeof(cmd),
-		      WMI_VRING_CFG_DONE_EVENTID, &reply, sizeof(reply), 100);
+	/* reply may come before wmi_call_async() returns */
+	spin_lock(&wil->vring_cfg_lock);
+	txdata->cfg_pending = true;
+	spin_unlock(&wil->vring_cfg_lock);
+	rc = wmi_call_async(wil, WMI_VRING_CFG_CMDID, &cmd, sizeof(cmd),
+			    WMI_VRING_CFG_DONE_EVENTID,
+			    sizeof(struct wil_vring_cfg_reply), 100, cb,
+			    WIL_VRING_CFG_CTX(id, gen));
+	if (rc) {
+		spin_lock(&wil->vring_cfg_lock);
+		txdata->cfg_pending = false;
+		txdata->cfg_orphan = false;
+		/* FW never saw the vring */
+		txdata->fw_done = true;
+		spin_unlock(&wil->vring_cfg_lock);
+		wil_vring_free(wil, vring, 1);
+	}
+
+	return rc;
+}
+
+/**
+ * wil_vring_init_tx_done - process reply for wil_vring_init_tx()
+ *
+ * @ctx, @rc, @reply and @len as passed to the callback; vring id
+ * goes to @id.
+ * Returns 0 if vring is ready for Tx. -ESTALE if it was released while
+ * the command was in flight, or the completion is not for its current
+ * use; caller should not touch the vring nor its station then.
+ * On other errors, vring is freed.
+ */
+int wil_vring_init_tx_done(struct wil6210_priv *wil, void *ctx, int rc,
+			   void *reply, u16 len, int *id)
+{
+	struct wil_vring_cfg_reply *r = reply;
+	struct vring *vring;
+	struct vring_tx_data *txdata;
+	bool orphan;
+
+	*id = WIL_VRING_CFG_ID(ctx);
+	vring = &wil->vring_tx[*id];
+	txdata = &wil->vring_tx_data[*id];
+
+	spin_lock(&wil->vring_cfg_lock);
+	if (!txdata->cfg_pending ||
+	    txdata->cfg_gen != WIL_VRING_CFG_GEN(ctx)) {
+		spin_unlock(&wil->vring_cfg_lock);
+		wil_err(wil, "Stale Tx config completion for vring [%d]\n",
+			*id);
+		return -ESTALE;
+	}
+	txdata->cfg_pending = false;
+	orphan = txdata->cfg_orphan;
+	txdata->cfg_orphan = false;
+	spin_unlock(&wil->vring_cfg_lock);
+
 	if (rc)
 		goto out_free;
 
-	if (reply.cmd.status != WMI_FW_STATUS_SUCCESS) {
+	if (len < sizeof(*r)) {
+		wil_err(wil, "Tx config reply too short: %d bytes\n", len);
+		rc = -EINVAL;
+		goto out_free;
+	}
+	if (r->cmd.ringid != *id) {
+		wil_err(wil, "Tx config reply for vring [%d], expected [%d]\n",
+			r->cmd.ringid, *id);
+		rc = -EINVAL;
+		goto out_free;
+	}
+	if (r->cmd.status != WMI_FW_STATUS_SUCCESS) {
 		wil_err(wil, "Tx config failed, status 0x%02x\n",
-			reply.cmd.status);
+			r->cmd.status);
+		/* rejected, FW does not use the vring */
+		txdata->fw_done = true;
 		rc = -EINVAL;
 		goto out_free;
 	}
-	vring->hwtail = le32_to_cpu(reply.cmd.tx_vring_tail_ptr);
+	if (orphan) {
+		rc = -ESTALE;
+		goto out_free;
+	}
+	vring->hwtail = le32_to_cpu(r->cmd.tx_vring_tail_ptr);
 
 	return 0;
  out_free:
-	wil_vring_free(wil, vring, 1);
- out:
+	wil_vring_fini_tx(wil, *id);
 
-	return rc;
+	return orphan ? -ESTALE : rc;
+}
+
+/*
+ * FW reported the station @cid gone, all of them if @cid < 0: it is
+ * done with its Tx vrings, these may be pooled when freed.
+ * Vring freed on local disconnect, timeout or shutdown is not
+ */
+void wil_tx_vring_fw_done(struct wil6210_priv *wil, int cid)
+{
+	uint i;
+
+	spin_lock(&wil->vring_cfg_lock);
+	for (i = 0; i < ARRAY_SIZE(wil->vring_tx); i++) {
+		if (!wil->vring_tx[i].va)
+			continue;
+		if (cid < 0 || wil->vring2cid_tid[i][0] == cid)
+			wil->vring_tx_data[i].fw_done = true;
+	}
+	spin_unlock(&wil->vring_cfg_lock);
 }
 
 void wil_vring_fini_tx(struct wil6210_priv *wil, int id)
 {
 	struct vring *vring = &wil->vring_tx[id];
+	struct vring_tx_data *txdata = &wil->vring_tx_data[id];
 
 	if (!vring->va)
 		return;
 
+	/* FW may still write to it, see wil_vring_init_tx() */
+	spin_lock(&wil->vring_cfg_lock);
+	if (txdata->cfg_pending) {
+		txdata->cfg_orphan = true;
+		spin_unlock(&wil->vring_cfg_lock);
+		wil_dbg_misc(wil, "Tx vring [%d] freed on config reply\n",
+			     id);
+		return;
+	}
+	spin_unlock(&wil->vring_cfg_lock);
+
 	wil_vring_free(wil, vring, 1);
 }
 
+/*
+ * Allocated and configured by FW. Vring of a former station on the
+ * same CID may still wait for its config reply, don't Tx there
+ */
+static inline bool wil_tx_vring_ready(struct wil6210_priv *wil, int i)
+{
+	return wil->vring_tx[i].va && !wil->vring_tx_data[i].cfg_pending;
+}
 
 /*
 *
@@ -646,7 +966,7 @@ static struct vring *wil_find_first_tx_vring(struct wil6210_priv *wil,
 	/* find 1-st vring */
 	for(i = 0; i < WIL6210_MAX_TX_RINGS; i++) {
 		v = &wil->vring_tx[i];
-		if (v && v->va) {
+		if (wil_tx_vring_ready(wil, i)) {
 			*vring_index = i;
 			return v;
 		}
@@ -668,18 +988,14 @@ static struct vring *wil_find_tx_vring(struct wil6210_priv *wil,
 
 	/* TODO: fix for multiple TID */
 	for (i = 0; i < ARRAY_SIZE(wil->vring2cid_tid); i++) {
-		if (wil->vring2cid_tid[i][0] == cid) {
-			struct vring *v = &wil->vring_tx[i];
-			wil_dbg_txrx(wil, "%s(%pM) -> [%d]\n",
-				     __func__, eth->h_dest, i);
-			if (v->va) {
-				return v;
-			} else {
-				wil_dbg_txrx(wil, "vring[%d] not valid\n", i);
-				return NULL;
-			}
-		}
+		if (wil->vring2cid_tid[i][0] != cid ||
+		    !wil_tx_vring_ready(wil, i))
+			continue;
+		wil_dbg_txrx(wil, "%s(%pM) -> [%d]\n",
+			     __func__, eth->h_dest, i);
+		return &wil->vring_tx[i];
 	}
+	wil_dbg_txrx(wil, "%s(%pM) no valid vring\n", __func__, eth->h_dest);
 
 	return NULL;
 }
@@ -734,7 +1050,7 @@ found:
 	/* find other active vrings and duplicate skb for each */
 	for(;i < WIL6210_MAX_TX_RINGS; i++) {
 		v2 = &wil->vring_tx[i];
-		if (!v2->va)
+		if (!wil_tx_vring_ready(wil, i))
 			continue;
 		skb2 = skb_copy(skb, GFP_ATOMIC);
 		if (skb2) {
@@ -853,12 +1169,204 @@ static int wil_tx_desc_offload_setup(struct vring_tx_desc *d,
 	return is_tcp ? (is_ip4 ? 1 : 2) : 0;
 }
 
-static inline void wil_tx_last_desc(struct vring_tx_desc *d, int vring_index)
+static inline void wil_tx_last_desc(struct vring_tx_desc *d, int vring_index,
+				    bool irq)
 {
 	d->dma.d0 |= BIT(DMA_CFG_DESC_TX_0_CMD_EOP_POS)
 		| BIT(9) /* BUG: undocumented bit */
-		| BIT(DMA_CFG_DESC_TX_0_CMD_DMA_IT_POS)
 		| (vring_index << DMA_CFG_DESC_TX_0_QID_POS);
+	if (irq)
+		d->dma.d0 |= BIT(DMA_CFG_DESC_TX_0_CMD_DMA_IT_POS);
+}
+
+/*
+ * Tx completion IRQ coalescing
+ *
+ * With tx_irq_frames > 1, DMA interrupt requested only for every
+ * tx_irq_frames-th frame, or when vring is filled above tx_irq_fill
+ * percent, so completions keep up under load. Frames sent without
+ * IRQ get reaped by tx_reap_timer, or opportunistically in xmit;
+ * the timer keeps running while any Tx vring is non-empty, as frames
+ * HW completes after its last reap have no IRQ to follow.
+ * TSO frame asks for IRQ per MSS chain, each chain counts as a frame.
+ */
+static inline bool wil_tx_coalesce(void)
+{
+	return tx_irq_frames > 1;
+}
+
+/* decide on IRQ for frame of @ndesc descriptors about to be queued */
+static bool wil_tx_want_irq(struct wil6210_priv *wil, struct vring *vring,
+			    int ndesc)
+{
+	struct vring_tx_data *txdata =
+			&wil->vring_tx_data[vring - wil->vring_tx];
+	int used = vring->size - 1 - wil_vring_avail_tx(vring) + ndesc;
+
+	/* near full vring stops Tx queues, completion must follow */
+	if (!wil_tx_coalesce() || (++txdata->irq_skipped >= tx_irq_frames) ||
+	    (used * 100 >= vring->size * tx_irq_fill) ||
+	    (used * 8 >= vring->size * 7)) {
+		txdata->irq_skipped = 0;
+		wil->tx_coal_stats.irq_req++;
+		return true;
+	}
+
+	wil->tx_coal_stats.irq_skip++;
+	return false;
+}
+
+static void wil_tx_reap_arm(struct wil6210_priv *wil)
+{
+	if (!hrtimer_active(&wil->tx_reap_timer))
+		hrtimer_start(&wil->tx_reap_timer,
+			      ns_to_ktime(tx_reap_usec * NSEC_PER_USEC),
+			      HRTIMER_MODE_REL);
+}
+
+/* any Tx vring with descriptors not reaped yet */
+static bool wil_tx_pending(struct wil6210_priv *wil)
+{
+	int i;
+
+	for (i = 0; i < WIL6210_MAX_TX_RINGS; i++) {
+		struct vring *vring = &wil->vring_tx[i];
+
+		if (vring->va && !wil_vring_is_empty(vring))
+			return true;
+	}
+
+	return false;
+}
+
+static enum hrtimer_restart wil_tx_reap_timer_fn(struct hrtimer *timer)
+{
+	struct wil6210_priv *wil = container_of(timer, struct wil6210_priv,
+						tx_reap_timer);
+
+	wil->tx_coal_stats.timer_reap++;
+	wil6210_schedule_tx(wil);
+
+	if (!wil_tx_pending(wil))
+		return HRTIMER_NORESTART;
+
+	hrtimer_forward_now(timer, ns_to_ktime(tx_reap_usec * NSEC_PER_USEC));
+	return HRTIMER_RESTART;
+}
+
+/* reap completions in xmit path, unless NAPI is at it right now */
+static void wil_tx_reap_xmit(struct wil6210_priv *wil, struct vring *vring)
+{
+	if (!spin_trylock(&wil->tx_reap_lock))
+		return;
+	wil->tx_coal_stats.xmit_reap +=
+		wil_tx_complete(wil, vring - wil->vring_tx);
+	spin_unlock(&wil->tx_reap_lock);
+}
+
+void wil_tx_coalesce_init(struct wil6210_priv *wil)
+{
+	spin_lock_init(&wil->tx_reap_lock);
+	hrtimer_init(&wil->tx_reap_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	wil->tx_reap_timer.function = wil_tx_reap_timer_fn;
+}
+
+void wil_tx_coalesce_stop(struct wil6210_priv *wil)
+{
+	hrtimer_cancel(&wil->tx_reap_timer);
+}
+
+/*
+ * EAPOL frames go to FW as WMI command; that may sleep, so they are
+ * sent from the high priority worker, not from the xmit path
+ */
+#define WIL_EAPOL_TXQ_MAX (32)
+
+/* resume xmit stopped by wil_eapol_tx_queue(), once half the queue is free */
+static void wil_eapol_tx_wake(struct wil6210_priv *wil)
+{
+	if (skb_queue_len(&wil->eapol_txq) > WIL_EAPOL_TXQ_MAX / 2)
+		return;
+	if (test_and_clear_bit(wil_status_eapol_full, &wil->status))
+		netif_tx_wake_all_queues(wil_to_ndev(wil));
+}
+
+static void wil_eapol_tx_worker(struct work_struct *work)
+{
+	struct wil6210_priv *wil = container_of(work, struct wil6210_priv,
+						eapol_worker);
+	struct net_device *ndev = wil_to_ndev(wil);
+	struct sk_buff *skb;
+	int rc;
+
+	while ((skb = skb_dequeue(&wil->eapol_txq)) != NULL) {
+		rc = wmi_tx_eapol(wil, skb);
+		if (rc) {
+			wil_err(wil, "EAPOL Tx failed: %d\n", rc);
+			ndev->stats.tx_dropped++;
+		}
+		dev_kfree_skb(skb);
+		wil_eapol_tx_wake(wil);
+	}
+}
+
+/*
+ * On full queue, stop xmit rather than drop; -EBUSY tells caller to
+ * return NETDEV_TX_BUSY. Worker may have drained the queue before it
+ * saw the stop, hence check again after stopping
+ */
+static int wil_eapol_tx_queue(struct wil6210_priv *wil, struct sk_buff *skb)
+{
+	if (skb_queue_len(&wil->eapol_txq) >= WIL_EAPOL_TXQ_MAX) {
+		set_bit(wil_status_eapol_full, &wil->status);
+		netif_tx_stop_all_queues(wil_to_ndev(wil));
+		smp_mb();
+		if (skb_queue_len(&wil->eapol_txq) >= WIL_EAPOL_TXQ_MAX)
+			return -EBUSY;
+	}
+
+	skb_queue_tail(&wil->eapol_txq, skb);
+	queue_work(wil->eapol_wq, &wil->eapol_worker);
+
+	return 0;
+}
+
+void wil_eapol_tx_init(struct wil6210_priv *wil)
+{
+	skb_queue_head_init(&wil->eapol_txq);
+	INIT_WORK(&wil->eapol_worker, wil_eapol_tx_worker);
+}
+
+void wil_eapol_tx_stop(struct wil6210_priv *wil)
+{
+	cancel_work_sync(&wil->eapol_worker);
+	skb_queue_purge(&wil->eapol_txq);
+	clear_bit(wil_status_eapol_full, &wil->status);
+}
+
+/* drop EAPOL frames still queued for the station @addr */
+void wil_eapol_tx_purge(struct wil6210_priv *wil, const u8 *addr)
+{
+	struct net_device *ndev = wil_to_ndev(wil);
+	struct sk_buff_head drop;
+	struct sk_buff *skb, *t;
+	ulong flags;
+
+	__skb_queue_head_init(&drop);
+	spin_lock_irqsave(&wil->eapol_txq.lock, flags);
+	skb_queue_walk_safe(&wil->eapol_txq, skb, t) {
+		struct ethhdr *eth = (void *)skb->data;
+
+		if (ether_addr_equal(eth->h_dest, addr)) {
+			__skb_unlink(skb, &wil->eapol_txq);
+			__skb_queue_tail(&drop, skb);
+		}
+	}
+	spin_unlock_irqrestore(&wil->eapol_txq.lock, flags);
+
+	ndev->stats.tx_dropped += skb_queue_len(&drop);
+	__skb_queue_purge(&drop);
+	wil_eapol_tx_wake(wil);
 }
 
 static inline void wil_set_tx_desc_count(struct vring_tx_desc *d, int cnt)
@@ -894,6 +1402,7 @@ static int wil_tx_vring_tso(struct wil6210_priv *wil, struct vring *vring,
 	int rem_data = 0;
 	int lenmss;
 	int end_of_first_chunck = 1;
+	bool irq;
 
 	if (avail < vring->size/8)
 		netif_tx_stop_all_queues(wil_to_ndev(wil));
@@ -938,7 +1447,7 @@ static int wil_tx_vring_tso(struct wil6210_priv *wil, struct vring *vring,
 	wil_tx_desc_map((struct vring_tx_desc *)d, pa, hdrlen, vring_index);
 	hdrdesc = d;
 	wil_tx_desc_offload_setup(d, skb, 0);
-	wil_tx_last_desc(d, vring_index);
+	wil_tx_last_desc(d, vring_index, !wil_tx_coalesce());
 
 	vring->ctx[i] = skb_get(skb);
 	skbcb->sngl_mapped = i;
@@ -975,7 +1484,9 @@ static int wil_tx_vring_tso(struct wil6210_priv *wil, struct vring *vring,
 			if (rem_data == 0) {
 				/* got full mss descs chain. Complete the
 				previous descriptor */
-				wil_tx_last_desc(d, vring_index);
+				wil_tx_last_desc(d, vring_index,
+						 wil_tx_want_irq(wil, vring,
+								 descs_used));
 				if (sg_desc)
 					wil_set_tx_desc_count(sg_desc,
 								sg_desc_cnt+end_of_first_chunck);
@@ -1018,7 +1529,8 @@ static int wil_tx_vring_tso(struct wil6210_priv *wil, struct vring *vring,
 			}
 		}
 	}
-	wil_tx_last_desc(d, vring_index);
+	irq = wil_tx_want_irq(wil, vring, descs_used);
+	wil_tx_last_desc(d, vring_index, irq);
 	if (sg_desc)
 		wil_set_tx_desc_count(sg_desc, sg_desc_cnt + end_of_first_chunck);
 
@@ -1033,6 +1545,8 @@ static int wil_tx_vring_tso(struct wil6210_priv *wil, struct vring *vring,
 	/* advance swhead */
 	wil_vring_advance_head(vring, descs_used);
 	iowrite32(vring->swhead, wil->csr + HOSTADDR(vring->hwtail));
+	if (!irq)
+		wil_tx_reap_arm(wil);
 	return 0;
 
  dma_error:
@@ -1069,6 +1583,7 @@ static int wil_tx_vring(struct wil6210_priv *wil, struct vring *vring,
 	int skblen = 0;
 	uint i = swhead;
 	dma_addr_t pa;
+	bool irq;
 
 	wil_dbg_txrx(wil, "%s()\n", __func__);
 
@@ -1133,7 +1648,8 @@ static int wil_tx_vring(struct wil6210_priv *wil, struct vring *vring,
 		vring->ctx[i] = skb_get(skb);
 	}
 	/* for the last seg only */
-	wil_tx_last_desc((struct vring_tx_desc *)d, vring_index);
+	irq = wil_tx_want_irq(wil, vring, nr_frags + 1);
+	wil_tx_last_desc((struct vring_tx_desc *)d, vring_index, irq);
 
 	wil_hex_dump_txrx("Tx", DUMP_PREFIX_NONE, 32, 4,
 			  (const void *)d, sizeof(*d), false);
@@ -1147,6 +1663,8 @@ static int wil_tx_vring(struct wil6210_priv *wil, struct vring *vring,
 
 	trace_wil6210_tx(vring_index, swhead, skb->len, nr_frags);
 	iowrite32(vring->swhead, wil->csr + HOSTADDR(vring->hwtail));
+	if (!irq)
+		wil_tx_reap_arm(wil);
 
 	return 0;
  dma_error:
@@ -1190,7 +1708,10 @@ netdev_tx_t wil_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 		goto drop;
 	}
 	if (skb->protocol == cpu_to_be16(ETH_P_PAE)) {
-		rc = wmi_tx_eapol(wil, skb);
+		/* sent by the worker, skb owned by it */
+		if (wil_eapol_tx_queue(wil, skb))
+			return NETDEV_TX_BUSY;
+		return NETDEV_TX_OK;
 	} else {
 		/* find vring, for unicast address */
 		if (is_unicast_ether_addr(eth->h_dest)) {
@@ -1205,6 +1726,9 @@ netdev_tx_t wil_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 					goto drop_err;
 				goto drop;
 		}
+		if (wil_tx_coalesce() &&
+		    (wil_vring_avail_tx(vring) < vring->size / 2))
+			wil_tx_reap_xmit(wil, vring);
 		/* set up vring entry */
 		if (skb_is_gso(skb))
 			rc = wil_tx_vring_tso(wil, vring, skb);
@@ -444,9 +444,12 @@ static inline struct vring_rx_desc *wil_skb_rxdesc(struct sk_buff *skb)
 
 void wil_netif_rx_any(struct sk_buff *skb, struct net_device *ndev);
 void wil_rx_reorder(struct wil6210_priv *wil, struct sk_buff *skb);
+int wil_rx_bar(struct wil6210_priv *wil, u8 cid, u8 tid, u16 seq);
 struct wil_tid_ampdu_rx *wil_tid_ampdu_rx_alloc(struct wil6210_priv *wil,
 						int size, u16 ssn);
-void wil_tid_ampdu_rx_free(struct wil6210_priv *wil,
-			   struct wil_tid_ampdu_rx *r);
+void wil_tid_ampdu_rx_set(struct wil6210_priv *wil, struct wil_sta_info *sta,
+			  int tid, struct wil_tid_ampdu_rx *r);
+int wil_rx_reorder_flush(struct wil6210_priv *wil);
+void wil_rx_reorder_purge(struct wil6210_priv *wil);
 
 #endif /* WIL6210_TXRX_H */
@@ -21,6 +21,8 @@
 #include <linux/wireless.h>
 #include <net/cfg80211.h>
 #include <linux/timex.h>
+#include <linux/hrtimer.h>
+#include <linux/ratelimit.h>
 
 #include <linux/version.h>
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(3,9,0))
@@ -34,6 +36,11 @@
 #define WLAN_CAPABILITY_DMG_TYPE_MASK		(3<<0)
 #endif
 
+#ifndef READ_ONCE
+#define READ_ONCE(x)		ACCESS_ONCE(x)
+#define WRITE_ONCE(x, val)	(ACCESS_ONCE(x) = (val))
+#endif
+
 extern bool use_pcp_for_ap;
 extern char *passphrase;
 
@@ -54,8 +61,13 @@ static inline u32 WIL_GET_BITS(u32 x, int b0, int b1)
 #define WIL6210_TX_RING_SIZE	(512)
 #define WIL6210_MAX_TX_RINGS	(24) /* HW limit */
 #define WIL6210_MAX_CID		(8) /* HW limit */
+#define WIL_TX_VRING_POOL	(WIL6210_MAX_CID) /* Tx vrings kept for reuse */
 #define WIL6210_NAPI_BUDGET	(16) /* arbitrary */
 #define WIL6210_ITR_TRSH	(10000) /* arbitrary - about 15 IRQs/msec */
+#define WIL_ITR_HISTORY		(32) /* adaptive ITR decisions kept */
+#define WIL_MAX_AGG_WSIZE	(64) /* max. Rx BACK window, 802.11 limit */
+#define WIL_MIN_AGG_WSIZE	(4) /* don't shrink Rx BACK window below */
+#define WIL_STA_BACK_POOL	(2) /* Rx reorder contexts preallocated per STA */
 
 /* Hardware definitions begin */
 
@@ -205,8 +217,23 @@ struct wil6210_mbox_hdr_wmi {
 	u8 reserved1[2];
 } __packed;
 
+/* WMI event buffers preallocated once FW reports mailbox entry size */
+#define WIL_WMI_EV_POOL (64)
+
+/* WMI event handlers table, indexed by hash of event ID */
+#define WIL_WMI_EVT_HASH_BITS (7)
+#define WIL_WMI_EVT_SLOTS (1 << WIL_WMI_EVT_HASH_BITS)
+
+struct wil_wmi_evt_stat {
+	u32 count;
+	u32 replies; /* of @count, delivered to wmi_call() */
+	u64 time_ns; /* cumulative handling time */
+	u32 max_ns;
+};
+
 struct pending_wmi_event {
 	struct list_head list;
+	bool pooled; /* from @wil->wmi_ev_pool, not kmalloc'ed */
 	struct {
 		struct wil6210_mbox_hdr hdr;
 		struct wil6210_mbox_hdr_wmi wmi;
@@ -214,6 +241,34 @@ struct pending_wmi_event {
 	} __packed event;
 };
 
+/* max. number of WMI calls waiting for reply at the same time */
+#define WIL_WMI_CALLS_MAX (8)
+
+struct wil6210_priv;
+
+typedef void (*wil_wmi_cb)(struct wil6210_priv *wil, void *ctx, int rc,
+			   void *reply, u16 len);
+
+/**
+ * WMI command waiting for its reply event, see wmi_call_async()
+ */
+struct wil_wmi_call {
+	struct list_head list; /* on wil->wmi_calls while in flight */
+	u16 cmdid;
+	u16 reply_id;
+	void *reply; /* NULL - reply passed to the event handler */
+	u16 reply_size;
+	u16 reply_len; /* bytes copied to @reply */
+	int rc;
+	ulong start; /* jiffies */
+	ulong deadline; /* jiffies */
+	ktime_t t_sent; /* command passed to FW */
+	wil_wmi_cb cb; /* NULL for the blocking wmi_call() */
+	void *ctx;
+	struct completion done;
+	bool stale; /* stand-in for timed out call, see wmi_call_stale() */
+};
+
 union vring_desc;
 
 struct vring {
@@ -234,6 +289,12 @@ struct vring_tx_data {
 	cycles_t idle, last_idle, begin;
 	u8 agg_wsize; /* agreed aggregation window, 0 - no agg */
 	u16 agg_timeout;
+	uint irq_skipped; /* frames sent without Tx IRQ since last one */
+	/* WMI_VRING_CFG, protected by wil6210_priv.vring_cfg_lock */
+	u16 cfg_gen; /* bumped per command, reply must carry the same */
+	bool cfg_pending; /* command in flight, vring stays reserved */
+	bool cfg_orphan; /* released meanwhile, free on reply or timeout */
+	bool fw_done; /* FW does not use the vring anymore, may pool it */
 };
 
 enum { /* for wil6210_priv.status */
@@ -242,6 +303,8 @@ enum { /* for wil6210_priv.status */
 	wil_status_dontscan,
 	wil_status_reset_done,
 	wil_status_irqen, /* FIXME: interrupts enabled - for debug */
+	wil_status_napi_en, /* NAPI enabled, protected by wil->mutex */
+	wil_status_eapol_full, /* xmit stopped on full EAPOL Tx queue */
 };
 
 struct pci_dev;
@@ -259,20 +322,20 @@ struct pci_dev;
  * @ssn: Starting Sequence Number expected to be aggregated.
  * @buf_size: buffer size for incoming A-MPDUs
  * @timeout: reset timer value (in TUs).
+ * @amsdu: A-MSDU within A-MPDU agreed for this session
  * @dialog_token: dialog token for aggregation session
- * @rcu_head: RCU head used for freeing this struct
- * @reorder_lock: serializes access to reorder buffer, see below.
  *
  * This structure's lifetime is managed by RCU, assignments to
- * the array holding it must hold the aggregation mutex.
+ * the array holding it must hold @tid_rx_lock of the wil6210_priv,
+ * see wil_tid_ampdu_rx_set().
  *
- * The @reorder_lock is used to protect the members of this
- * struct, except for @timeout, @buf_size and @dialog_token,
- * which are constant across the lifetime of the struct (the
- * dialog token being used only for debugging).
+ * Reorder state is owned by the Rx NAPI context and accessed there
+ * with no locking; @timeout, @buf_size, @amsdu and @dialog_token
+ * are constant across the lifetime of the struct.
+ * Frames still buffered when session torn down are released to
+ * the stack in order, by the Rx poll, see wil_rx_reorder_flush().
  */
 struct wil_tid_ampdu_rx {
-	spinlock_t reorder_lock;
 	struct sk_buff **reorder_buf;
 	unsigned long *reorder_time;
 	struct timer_list session_timer;
@@ -284,7 +347,23 @@ struct wil_tid_ampdu_rx {
 	u16 buf_size;
 	u16 timeout;
 	u16 ssn_last_drop;
+	bool amsdu;
 	u8 dialog_token;
+	struct wil6210_priv *wil;
+	struct rcu_head rcu; /* teardown, see wil_tid_ampdu_rx_set() */
+	struct list_head retired; /* on wil6210_priv.rx_reorder_retired */
+};
+
+/**
+ * struct wil_back_policy - Rx BACK acceptance policy, per TID
+ * @agg_wsize: max. window to accept, 0 - decline aggregation
+ * @agg_timeout: BA timeout (TU) to respond with, 0 - accept peer's one
+ * @agg_amsdu: accept A-MSDU within A-MPDU, if peer supports it
+ */
+struct wil_back_policy {
+	u16 agg_wsize;
+	u16 agg_timeout;
+	bool agg_amsdu;
 };
 
 struct wil6210_stats {
@@ -298,7 +377,33 @@ struct wil6210_stats {
 	u16 peer_tx_sector;
 };
 
-struct wil6210_priv;
+#define WIL_HIST_BUCKETS	(16)
+
+/**
+ * struct wil_hist - log2 histogram of latencies, in usec
+ *
+ * @bucket[0] counts values below 1 usec, @bucket[i] - values
+ * in [2^(i-1), 2^i) usec; last bucket collects everything above.
+ * Not protected, updated from single context
+ */
+struct wil_hist {
+	u32 bucket[WIL_HIST_BUCKETS];
+	u32 count;
+	u32 min;
+	u32 max;
+	u64 sum;
+};
+
+/* WMI call latency per command ID, see wmi_call_account() */
+#define WIL_WMI_CMD_STATS (32)
+
+struct wil_wmi_cmd_stat {
+	u16 cmdid; /* 0 - slot unused */
+	u16 reply_id;
+	u32 timeouts;
+	u32 errors; /* failed other than timeout */
+	struct wil_hist lat; /* command sent -> reply handled */
+};
 
 struct wil_roc {
 	struct delayed_work work;
@@ -325,9 +430,33 @@ struct wil_net_stats {
 	unsigned long	tx_bytes;
 	unsigned long	tx_errors;
 	unsigned long	rx_dropped;
+	unsigned long	rx_bar; /* BAR frames received */
+	unsigned long	rx_bar_old; /* BAR with SSN behind reorder window */
 	u16 last_mcs_rx;
 };
 
+/**
+ * struct wil_link_stats - link status reported by FW for the peer
+ *
+ * Filled from WMI_NOTIFY_REQ_DONE_EVENTID, either requested or pushed
+ * periodically by FW; station queries are answered from here
+ */
+struct wil_link_stats {
+	ulong updated; /* jiffies; 0 - never */
+	u64 tsf;
+	u32 snr;
+	u32 tx_tpt;
+	u32 tx_goodput;
+	u32 rx_goodput;
+	u16 bf_mcs;
+	u16 my_rx_sector;
+	u16 my_tx_sector;
+	u16 peer_rx_sector;
+	u16 peer_tx_sector;
+	u8 sqi;
+	bool refresh; /* async request in flight, READ/WRITE_ONCE */
+};
+
 /**
  * struct wil_sta_info - data for peer
  *
@@ -340,8 +469,11 @@ struct wil_sta_info {
 	u8 addr[ETH_ALEN];
 	enum wil_sta_status status;
 	struct wil_net_stats stats;
+	struct wil_link_stats link;
 	/* Rx BACK */
-	struct wil_tid_ampdu_rx *tid_rx[WIL_STA_TID_NUM];
+	struct wil_tid_ampdu_rx __rcu *tid_rx[WIL_STA_TID_NUM];
+	ktime_t addba_t_req[WIL_STA_TID_NUM]; /* ADDBA request, for latency */
+	struct wil_tid_ampdu_rx *back_pool[WIL_STA_BACK_POOL];
 	unsigned long tid_rx_timer_expired[BITS_TO_LONGS(WIL_STA_TID_NUM)];
 	unsigned long tid_rx_stop_requested[BITS_TO_LONGS(WIL_STA_TID_NUM)];
 };
@@ -354,6 +486,7 @@ struct wil_pending_back {
 	u16 ba_param_set;
 	u16 ba_timeout;
 	u16 ba_seq_ctrl;
+	ktime_t t_req; /* when request received */
 	/* response params - what we agree to do */
 	u16 agg_wsize;
 	u16 agg_timeout;
@@ -361,6 +494,97 @@ struct wil_pending_back {
 	u8 agg_amsdu:1; /* A-MSDU supported */
 };
 
+enum wil_itr_level {
+	wil_itr_lowest_latency,
+	wil_itr_low_latency,
+	wil_itr_bulk,
+};
+
+struct wil_itr_decision {
+	unsigned long jiffies;
+	u32 irqs; /* Rx IRQs during interval */
+	u32 pkts;
+	u32 bytes;
+	enum wil_itr_level level;
+	u32 trsh;
+};
+
+/**
+ * Adaptive Rx interrupt moderation, see wil6210_itr_update()
+ */
+struct wil_itr {
+	bool adaptive;
+	enum wil_itr_level level;
+	u32 trsh; /* programmed into RGF_DMA_ITR_CNT_TRSH, 0 - moderation off */
+	atomic_t irqs; /* Rx IRQs since last decision, vs. Rx handler */
+	unsigned long last; /* jiffies of last decision */
+	unsigned long rx_packets; /* ndev stats at last decision */
+	unsigned long rx_bytes;
+	u32 n_decisions;
+	struct wil_itr_decision history[WIL_ITR_HISTORY];
+};
+
+/* IRQ vectors, in order of the 3 MSI mode */
+enum {
+	wil_irq_tx = 0,
+	wil_irq_rx,
+	wil_irq_misc,
+	wil_irq_vecs,
+};
+
+struct wil_irq_vec {
+	int irq; /* 0 if not a separate vector */
+	int cpu; /* affinity hint, -1 if none */
+	int last_cpu; /* CPU served last interrupt */
+	u32 count; /* interrupts handled */
+	u32 spurious; /* nothing in ICR */
+	u32 unhandled; /* interrupts with unknown ICR bits */
+};
+
+/**
+ * IRQ storm detection, see wil6210_irq_storm_account()
+ *
+ * Per vector state is only touched by that vector's handler, which
+ * never runs concurrently with itself
+ */
+struct wil_irq_storm_vec {
+	unsigned long window; /* jiffies, current window started */
+	u32 irqs; /* interrupts in current window */
+	u32 spurious; /* spurious interrupts in current window */
+	u32 last_rate; /* IRQs/sec in last complete window */
+	u32 storms; /* times storm detected */
+	unsigned long until; /* jiffies, throttling ends */
+};
+
+struct wil_irq_storm {
+	struct wil_irq_storm_vec vec[wil_irq_vecs];
+	ulong active; /* bit per wil_irq_* vector throttled */
+	ulong misc_unmask; /* bit 0 - Misc handled, timer to unmask it */
+	ulong itr_bump; /* bit 0 - Rx/Tx storm, raise ITR on next poll */
+	struct hrtimer poll_timer; /* polls Rx/Tx, unmasks Misc in storm */
+};
+
+/* updated from all vectors, on different CPUs in 3 MSI mode */
+struct wil_irq_mmio {
+	atomic64_t reads;
+	atomic64_t writes;
+	atomic64_t skipped; /* mask/unmask writes avoided using shadow */
+};
+
+struct wil_busy_poll_stats {
+	u32 hits; /* packets received by busy poll */
+	u32 misses; /* busy poll found nothing */
+	u32 poll_yield; /* busy poll found Rx owned by NAPI */
+	u32 napi_yield; /* NAPI found Rx owned by busy poll */
+};
+
+struct wil_tx_coalesce_stats {
+	u32 irq_req; /* frames sent requesting Tx IRQ */
+	u32 irq_skip; /* frames sent without Tx IRQ */
+	u32 timer_reap; /* reap timer expired */
+	u32 xmit_reap; /* descriptors reaped in xmit path */
+};
+
 struct wil6210_priv {
 	struct pci_dev *pdev;
 	int n_msi;
@@ -373,49 +597,109 @@ struct wil6210_priv {
 	u32 monitor_flags;
 	u32 secure_pcp; /* create secure PCP? */
 	int sinfo_gen;
+	int sinfo_notify_cid; /* CID FW reports link status for, or -1 */
 	/* cached ISR registers */
 	u32 isr_misc;
+	struct wil_itr itr;
+	struct wil_irq_vec irq_vec[wil_irq_vecs];
+	u32 irq_shared_count; /* interrupts on the single vector, if used */
+	u32 irq_shared_spurious; /* no cause in pseudo cause register */
+	struct wil_irq_storm irq_storm;
+	ulong irq_masked; /* shadow of IRQ mask registers */
+	struct wil_irq_mmio irq_mmio; /* MMIO accesses on interrupt path */
 	/* mailbox related */
 	struct mutex wmi_mutex;
 	struct wil6210_mbox_ctl mbox_ctl;
 	struct completion wmi_ready;
 	u16 wmi_seq;
-	u16 reply_id; /**< wait for this WMI event */
-	void *reply_buf;
-	u16 reply_size;
+	/*
+	 * WMI calls waiting for reply, in the order sent
+	 * - added by the caller,
+	 * - completed by wmi_event_worker or wmi_call_expire
+	 */
+	struct list_head wmi_calls;
+	spinlock_t wmi_call_lock; /* protect wmi_calls */
+	struct semaphore wmi_call_sem; /* limit calls in flight */
+	struct delayed_work wmi_call_expire;
+	u32 wmi_calls_inflight;
+	u32 wmi_calls_inflight_max;
+	u32 wmi_calls_timeout;
+	u32 wmi_calls_stale; /* late replies absorbed */
+	struct wil_wmi_cmd_stat wmi_cmd_stats[WIL_WMI_CMD_STATS];
+	u32 wmi_cmd_stats_lost; /* no free slot */
+	spinlock_t wmi_cmd_stat_lock; /* protect wmi_cmd_stats */
+	wait_queue_head_t wmi_mbox_wq; /* woken on mailbox event */
+	struct wil_hist wmi_wait_head; /* Tx mailbox head busy */
+	struct wil_hist wmi_wait_full; /* Tx mailbox ring full */
 	struct workqueue_struct *wmi_wq; /* for deferred calls */
 	struct work_struct wmi_event_worker;
 	struct workqueue_struct *wmi_wq_conn; /* for connect worker */
 	struct work_struct connect_worker;
 	struct work_struct disconnect_worker;
 	struct timer_list connect_timer;
-	int pending_connect_cid;
+	ulong pending_connect; /* CIDs waiting for Tx vring, bitmap */
 	struct list_head pending_wmi_ev;
 	/*
 	 * protect pending_wmi_ev
 	 * - fill in IRQ from wil6210_irq_misc,
 	 * - consumed in thread by wmi_event_worker
+	 * and wmi_ev_free
 	 */
 	spinlock_t wmi_ev_lock;
+	void *wmi_ev_pool; /* WIL_WMI_EV_POOL event buffers */
+	struct list_head wmi_ev_free;
+	u16 wmi_ev_room; /* payload room of pool buffer, 0 - no pool */
+	u32 wmi_ev_oversize; /* events above @wmi_ev_room */
+	u32 wmi_ev_pool_empty; /* pool exhausted */
+	struct wil_wmi_evt_stat wmi_evt_stats[WIL_WMI_EVT_SLOTS];
+	u32 wmi_evt_unknown; /* events not in the handlers table */
 	struct napi_struct napi_rx;
 	struct napi_struct napi_tx;
+	bool combined_poll; /* napi_rx reaps Tx completions as well */
+	uint tx_reap_next; /* vring to start Tx completions from */
+	bool poll_threaded; /* Rx/Tx polled by @poll_task, never NAPI */
+	struct task_struct *poll_task; /* poll thread, READ_ONCE from IRQ */
+	wait_queue_head_t poll_wq;
+	ulong poll_sched; /* bit 0 - poll thread has work */
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	spinlock_t bp_lock; /* Rx ownership between NAPI and busy poll */
+	uint bp_state;
+#endif
+	struct wil_busy_poll_stats bp_stats;
+	spinlock_t tx_reap_lock; /* serialize wil_tx_complete() callers */
+	struct hrtimer tx_reap_timer; /* Tx completions without Tx IRQ */
+	struct wil_tx_coalesce_stats tx_coal_stats;
 	/* BACK */
 	struct list_head back_pending;
 	struct mutex back_mutex;
 	struct workqueue_struct *back_wq;
 	struct work_struct back_worker;
+	struct wil_back_policy back_policy[WIL_STA_TID_NUM];
+	spinlock_t tid_rx_lock; /* for wil_sta_info.tid_rx[] and back_pool[] */
+	struct list_head rx_reorder_retired; /* torn down, frames to release */
+	struct wil_hist back_lat_queued; /* ADDBA request -> response queued */
+	struct wil_hist back_lat_sent; /* ADDBA request -> response sent */
 	/* DMA related */
 	struct vring vring_rx;
 	struct vring vring_tx[WIL6210_MAX_TX_RINGS];
 	struct vring_tx_data vring_tx_data[WIL6210_MAX_TX_RINGS];
 	u8 vring2cid_tid[WIL6210_MAX_TX_RINGS][2]; /* [0] - CID, [1] - TID */
+	spinlock_t vring_cfg_lock; /* vring_tx_data cfg_*, sta status */
+	struct vring tx_vring_pool[WIL_TX_VRING_POOL]; /* free Tx vrings */
+	uint tx_vring_pool_n;
+	u32 tx_vring_pool_miss; /* Tx vring allocated, pool empty */
+	spinlock_t tx_vring_pool_lock; /* protect tx_vring_pool */
 	struct wil_sta_info sta[WIL6210_MAX_CID];
 	/* scan */
 	struct cfg80211_scan_request *scan_request;
 	/* p2p etc. */
 	struct workqueue_struct *roc_wq; /* for offchannel ops */
+	/* EAPOL Tx, off the xmit path */
+	struct workqueue_struct *eapol_wq;
+	struct work_struct eapol_worker;
+	struct sk_buff_head eapol_txq;
 	struct wil_roc roc;
-	u64 roc_counter;
+	atomic_t cookie_counter; /* ROC and mgmt Tx share cookie space */
 
 	struct mutex mutex; /* for wil6210_priv access in wil_{up|down} */
 	/* statistics */
@@ -439,6 +723,18 @@ struct wil6210_priv {
 #define wil_to_ndev(i) (wil_to_wdev(i)->netdev)
 #define ndev_to_wil(n) (wdev_to_wil(n->ieee80211_ptr))
 
+/* cookie for ROC or mgmt Tx, never 0 */
+static inline u64 wil_cookie_alloc(struct wil6210_priv *wil)
+{
+	u64 cookie = (u32)atomic_inc_return(&wil->cookie_counter);
+
+	return cookie ? : (u32)atomic_inc_return(&wil->cookie_counter);
+}
+
+struct seq_file;
+void wil_hist_add(struct wil_hist *h, u32 usec);
+void wil_hist_print(struct seq_file *s, struct wil_hist *h);
+
 int wil_dbg_trace(struct wil6210_priv *wil, const char *fmt, ...);
 int wil_err(struct wil6210_priv *wil, const char *fmt, ...);
 int wil_info(struct wil6210_priv *wil, const char *fmt, ...);
@@ -447,6 +743,13 @@ int wil_info(struct wil6210_priv *wil, const char *fmt, ...);
 	wil_dbg_trace(wil, fmt, ##arg); \
 } while(0)
 
+#define wil_err_ratelimited(wil, fmt, arg...) do { \
+	static DEFINE_RATELIMIT_STATE(_rs, DEFAULT_RATELIMIT_INTERVAL, \
+				      DEFAULT_RATELIMIT_BURST); \
+	if (__ratelimit(&_rs)) \
+		wil_err(wil, fmt, ##arg); \
+} while (0)
+
 #define wil_dbg_irq(wil, fmt, arg...) wil_dbg(wil, "DBG[ IRQ]" fmt, ##arg)
 #define wil_dbg_txrx(wil, fmt, arg...) wil_dbg(wil, "DBG[TXRX]" fmt, ##arg)
 #define wil_dbg_wmi(wil, fmt, arg...) wil_dbg(wil, "DBG[ WMI]" fmt, ##arg)
@@ -476,6 +779,11 @@ void wil_memcpy_toio_32(volatile void __iomem *dst, const void *src,
 			size_t count);
 
 void *wil_if_alloc(struct device *dev, void __iomem *csr);
+int wil6210_poll_thread_start(struct wil6210_priv *wil);
+void wil6210_poll_thread_stop(struct wil6210_priv *wil);
+void wil6210_poll_thread_wake(struct wil6210_priv *wil);
+void wil_busy_poll_enable(struct wil6210_priv *wil);
+void wil_busy_poll_disable(struct wil6210_priv *wil);
 void wil_if_free(struct wil6210_priv *wil);
 int wil_if_add(struct wil6210_priv *wil);
 void wil_if_remove(struct wil6210_priv *wil);
@@ -497,8 +805,19 @@ int wmi_send(struct wil6210_priv *wil, u16 cmdid, void *buf, u16 len);
 void wmi_recv_cmd(struct wil6210_priv *wil);
 int wmi_call(struct wil6210_priv *wil, u16 cmdid, void *buf, u16 len,
 	     u16 reply_id, void *reply, u8 reply_size, int to_msec);
+int wmi_call_async(struct wil6210_priv *wil, u16 cmdid, void *buf, u16 len,
+		   u16 reply_id, u16 reply_size, int to_msec,
+		   wil_wmi_cb cb, void *ctx);
+int wmi_call_async_try(struct wil6210_priv *wil, u16 cmdid, void *buf,
+		       u16 len, u16 reply_id, u16 reply_size, int to_msec,
+		       wil_wmi_cb cb, void *ctx);
+void wmi_call_expire(struct work_struct *work);
+void wmi_call_flush(struct wil6210_priv *wil, int rc);
 void wmi_event_worker(struct work_struct *work);
 void wmi_event_flush(struct wil6210_priv *wil);
+void wmi_ev_pool_init(struct wil6210_priv *wil);
+void wmi_ev_pool_free(struct wil6210_priv *wil);
+const char *wmi_evt_name(uint slot, u16 *eventid);
 int wmi_set_passphrase(struct wil6210_priv *wil, u8 ssid_len, const void *ssid,
 		       u8 pass_len, const void *pass);
 int wmi_set_ssid(struct wil6210_priv *wil, u8 ssid_len, const void *ssid);
@@ -511,17 +830,22 @@ int wmi_del_cipher_key(struct wil6210_priv *wil, u8 key_index,
 int wmi_add_cipher_key(struct wil6210_priv *wil, u8 key_index,
 		       const void *mac_addr, int key_len, const void *key);
 int wmi_echo(struct wil6210_priv *wil);
+struct wmi_notify_req_done_event;
+void wil_link_stats_update(struct wil6210_priv *wil, int cid,
+			   struct wmi_notify_req_done_event *evt);
 int wmi_set_ie(struct wil6210_priv *wil, u8 type, u16 ie_len, const void *ie);
 int wmi_rx_chain_add(struct wil6210_priv *wil, struct vring *vring);
 int wmi_p2p_cfg(struct wil6210_priv *wil, int channel, int bi);
 int wmi_rxon(struct wil6210_priv *wil, bool on);
 int wmi_get_temperature(struct wil6210_priv *wil, u32 *t_m, u32 *t_r);
-int wmi_mgmt_tx(struct wil6210_priv *wil, const u8 *buf, size_t len);
+int wmi_mgmt_tx(struct wil6210_priv *wil, const u8 *buf, size_t len,
+		u64 cookie, bool no_ack);
 int wmi_disconnect_sta(struct wil6210_priv *wil, const u8 *mac, u16 reason);
 int wmi_start_listen(struct wil6210_priv *wil);
 int wmi_start_search(struct wil6210_priv *wil);
 int wmi_start_discovery(struct wil6210_priv *wil);
 int wmi_stop_discovery(struct wil6210_priv *wil);
+int wmi_vring_delete(struct wil6210_priv *wil, int ringid);
 int wmi_addba(struct wil6210_priv *wil, u8 ringid, u8 size, u16 timeout);
 int wmi_delba(struct wil6210_priv *wil, u8 ringid, u16 reason);
 int wmi_rcp_addba_resp(struct wil6210_priv *wil, u8 cid, u8 tid, u8 token,
@@ -531,11 +855,20 @@ int wil_rcp_addba_request(struct wil6210_priv *wil, u8 cidxtid,
 			  __le16 ba_timeout, __le16 ba_seq_ctrl);
 void wil_back_worker(struct work_struct *work);
 void wil_back_flush(struct wil6210_priv *wil);
+void wil_back_policy_init(struct wil6210_priv *wil);
+void wil_back_pool_fill(struct wil6210_priv *wil, int cid);
+void wil_back_pool_drain(struct wil6210_priv *wil, int cid);
+void wil_addba_resp_sent(struct wil6210_priv *wil, u8 cidxtid, u16 status);
+int wil_reorder_budget(int *used);
 
 int wil6210_init_irq(struct wil6210_priv *wil, int irq);
 void wil6210_fini_irq(struct wil6210_priv *wil, int irq);
 void wil6210_disable_irq(struct wil6210_priv *wil);
 void wil6210_enable_irq(struct wil6210_priv *wil);
+void wil6210_synchronize_irq(struct wil6210_priv *wil);
+void wil6210_itr_update(struct wil6210_priv *wil);
+void wil6210_schedule_rx(struct wil6210_priv *wil);
+void wil6210_schedule_tx(struct wil6210_priv *wil);
 
 int wil6210_debugfs_init(struct wil6210_priv *wil);
 void wil6210_debugfs_remove(struct wil6210_priv *wil);
@@ -553,11 +886,21 @@ void wil_rx_fini(struct wil6210_priv *wil);
 
 /* TX API */
 int wil_vring_init_tx(struct wil6210_priv *wil, int id, int size,
-		      int cid, int tid);
+		      int cid, int tid, wil_wmi_cb cb);
+int wil_vring_init_tx_done(struct wil6210_priv *wil, void *ctx, int rc,
+			   void *reply, u16 len, int *id);
 void wil_vring_fini_tx(struct wil6210_priv *wil, int id);
+void wil_tx_vring_fw_done(struct wil6210_priv *wil, int cid);
+void wil_tx_vring_pool_init(struct wil6210_priv *wil);
+void wil_tx_vring_pool_free(struct wil6210_priv *wil);
 
 netdev_tx_t wil_start_xmit(struct sk_buff *skb, struct net_device *ndev);
 int wil_tx_complete(struct wil6210_priv *wil, int ringid);
+void wil_tx_coalesce_init(struct wil6210_priv *wil);
+void wil_tx_coalesce_stop(struct wil6210_priv *wil);
+void wil_eapol_tx_init(struct wil6210_priv *wil);
+void wil_eapol_tx_stop(struct wil6210_priv *wil);
+void wil_eapol_tx_purge(struct wil6210_priv *wil, const u8 *addr);
 void wil6210_unmask_irq_tx(struct wil6210_priv *wil);
 
 /* RX API */
@@ -570,6 +913,6 @@ int wil_iftype_nl2wmi(enum nl80211_iftype type);
 int wil_cancel_roc(struct wil6210_priv *wil);
 int wil_prepare_roc(struct wil6210_priv *wil, struct ieee80211_channel *chan,
 		    const u8 *buf, size_t len, unsigned int duration,
-		    u64 *cookie);
+		    bool no_ack, u64 *cookie);
 
 #endif /* __WIL6210_H__ */
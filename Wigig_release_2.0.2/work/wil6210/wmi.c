@@ -39,6 +39,26 @@
  * won't be completed because of blocked IRQ thread.
  */
 
+/**
+ * WMI calls - theory of operations
+ *
+ * Command that expects reply event is described by struct wil_wmi_call,
+ * queued on @wil->wmi_calls before being written to the mailbox.
+ * @wil->wmi_mutex protects the mailbox only, so several calls (up to
+ * WIL_WMI_CALLS_MAX) may wait for their replies at the same time.
+ * @wmi_event_handle matches every event against the queue, oldest first,
+ * and completes the call: wakes up the blocking wmi_call(), or invokes
+ * callback of the wmi_call_async().
+ *
+ * Replies carry no reference to the command, so matching relies on
+ * firmware answering commands with the same reply ID in order. Call that
+ * timed out leaves a stand-in in its place to absorb the late reply,
+ * see wmi_call_stale().
+ *
+ * Replies are delivered by @wmi_event_worker, so blocking wmi_call() must
+ * not be used from event handlers or async callbacks.
+ */
+
 /**
  * Addressing - theory of operations
  *
@@ -160,7 +180,82 @@ int wmi_read_hdr(struct wil6210_priv *wil, __le32 ptr,
 	return 0;
 }
 
-static int __wmi_send(struct wil6210_priv *wil, u16 cmdid, void *buf, u16 len)
+/* mailbox flow control: spin, then back off up to the total budget */
+#define WIL_MBOX_SPIN			(20)
+#define WIL_MBOX_WAIT_MIN_US		(10)
+#define WIL_MBOX_WAIT_STEP_MAX_US	(10000)
+#define WIL_MBOX_WAIT_MAX_US		(100000)
+
+static bool wmi_tx_head_free(struct wil6210_priv *wil, void *arg)
+{
+	struct wil6210_mbox_ring_desc *d_head = arg;
+	void __iomem *head = wmi_addr(wil, wil->mbox_ctl.tx.head);
+
+	wil_memcpy_fromio_32(d_head, head, sizeof(*d_head));
+
+	return d_head->sync == 0;
+}
+
+static bool wmi_tx_ring_room(struct wil6210_priv *wil, void *arg)
+{
+	struct wil6210_mbox_ring *r = &wil->mbox_ctl.tx;
+	u32 next_head = *(u32 *)arg;
+
+	r->tail = ioread32(wil->csr + HOST_MBOX +
+			   offsetof(struct wil6210_mbox_ctl, tx.tail));
+
+	return next_head != r->tail;
+}
+
+/*
+ * Wait till firmware frees mailbox entry.
+ *
+ * Spin for few reads, then sleep with exponential backoff starting
+ * from few usec. Once step grows above a jiffy, sleep on
+ * @wil->wmi_mbox_wq - misc IRQ wakes it up when firmware posts event,
+ * that is usually right after it consumed the command.
+ * Time spent waiting goes to @h
+ */
+static int wmi_mbox_wait(struct wil6210_priv *wil,
+			 bool (*ready)(struct wil6210_priv *, void *),
+			 void *arg, struct wil_hist *h)
+{
+	ktime_t start;
+	u32 delay = WIL_MBOX_WAIT_MIN_US;
+	u32 spent = 0;
+	bool done = false;
+	int i;
+
+	if (ready(wil, arg))
+		return 0;
+
+	start = ktime_get();
+	for (i = 0; i < WIL_MBOX_SPIN && !done; i++) {
+		cpu_relax();
+		done = ready(wil, arg);
+	}
+
+	while (!done) {
+		spent = ktime_to_us(ktime_sub(ktime_get(), start));
+		if (spent >= WIL_MBOX_WAIT_MAX_US)
+			break;
+		if (delay < jiffies_to_usecs(1))
+			usleep_range(delay, 2 * delay);
+		else
+			wait_event_timeout(wil->wmi_mbox_wq, ready(wil, arg),
+					   usecs_to_jiffies(delay));
+		done = ready(wil, arg);
+		delay = min_t(u32, 2 * delay, WIL_MBOX_WAIT_STEP_MAX_US);
+	}
+
+	spent = ktime_to_us(ktime_sub(ktime_get(), start));
+	wil_hist_add(h, spent);
+
+	return done ? 0 : -EBUSY;
+}
+
+static int __wmi_send(struct wil6210_priv *wil, u16 cmdid, void *buf, u16 len,
+		      ktime_t *t_sent)
 {
 	struct {
 		struct wil6210_mbox_hdr hdr;
@@ -181,7 +276,6 @@ static int __wmi_send(struct wil6210_priv *wil, u16 cmdid, void *buf, u16 len)
 	u32 next_head;
 	void __iomem *dst;
 	void __iomem *head = wmi_addr(wil, r->head);
-	uint retry;
 
 	if (sizeof(cmd) + len > r->entry_size) {
 		wil_err(wil, "WMI size too large: %d bytes, max is %d\n",
@@ -201,13 +295,8 @@ static int __wmi_send(struct wil6210_priv *wil, u16 cmdid, void *buf, u16 len)
 		return -EINVAL;
 	}
 	/* read Tx head till it is not busy */
-	for (retry = 5; retry > 0; retry--) {
-		wil_memcpy_fromio_32(&d_head, head, sizeof(d_head));
-		if (d_head.sync == 0)
-			break;
-		msleep(20);
-	}
-	if (d_head.sync != 0) {
+	if (wmi_mbox_wait(wil, wmi_tx_head_free, &d_head,
+			  &wil->wmi_wait_head)) {
 		wil_err(wil, "WMI head busy\n");
 		return -EBUSY;
 	}
@@ -215,14 +304,8 @@ static int __wmi_send(struct wil6210_priv *wil, u16 cmdid, void *buf, u16 len)
 	next_head = r->base + ((r->head - r->base + sizeof(d_head)) % r->size);
 	wil_dbg_wmi(wil, "Head 0x%08x -> 0x%08x\n", r->head, next_head);
 	/* wait till FW finish with previous command */
-	for (retry = 5; retry > 0; retry--) {
-		r->tail = ioread32(wil->csr + HOST_MBOX +
-				   offsetof(struct wil6210_mbox_ctl, tx.tail));
-		if (next_head != r->tail)
-			break;
-		msleep(20);
-	}
-	if (next_head == r->tail) {
+	if (wmi_mbox_wait(wil, wmi_tx_ring_room, &next_head,
+			  &wil->wmi_wait_full)) {
 		wil_err(wil, "WMI ring full\n");
 		return -EBUSY;
 	}
@@ -250,6 +333,9 @@ static int __wmi_send(struct wil6210_priv *wil, u16 cmdid, void *buf, u16 len)
 
 	trace_wil6210_wmi_cmd(cmdid, buf, len);
 
+	/* before FW sees it - reply may be handled before we return */
+	if (t_sent)
+		*t_sent = ktime_get();
 	/* interrupt to FW */
 	iowrite32(SW_INT_MBOX, wil->csr + HOST_SW_INT);
 
@@ -261,7 +347,7 @@ int wmi_send(struct wil6210_priv *wil, u16 cmdid, void *buf, u16 len)
 	int rc;
 
 	mutex_lock(&wil->wmi_mutex);
-	rc = __wmi_send(wil, cmdid, buf, len);
+	rc = __wmi_send(wil, cmdid, buf, len, NULL);
 	mutex_unlock(&wil->wmi_mutex);
 
 	return rc;
@@ -293,7 +379,7 @@ static void wmi_evt_fw_ready(struct wil6210_priv *wil, int id, void *d,
 	wil_dbg_wmi(wil, "WMI: FW ready\n");
 
 	set_bit(wil_status_fwready, &wil->status);
-	/* reuse wmi_ready for the firmware ready indication */
+	/* wmi_ready is for the firmware ready indication only */
 	complete(&wil->wmi_ready);
 }
 
@@ -476,9 +562,11 @@ static void wmi_evt_connect(struct wil6210_priv *wil, int id, void *d, int len)
 	/* FIXME FW can transmit only ucast frames to peer */
 	/* FIXME real ring_id instead of hard coded 0 */
 	memcpy(wil->sta[evt->cid].addr, evt->bssid, ETH_ALEN);
+	spin_lock(&wil->vring_cfg_lock);
 	wil->sta[evt->cid].status = wil_sta_conn_pending;
+	set_bit(evt->cid, &wil->pending_connect);
+	spin_unlock(&wil->vring_cfg_lock);
 
-	wil->pending_connect_cid = evt->cid;
 	queue_work(wil->wmi_wq_conn, &wil->connect_worker);
 }
 
@@ -486,6 +574,8 @@ static void wmi_evt_disconnect(struct wil6210_priv *wil, int id,
 			       void *d, int len)
 {
 	struct wmi_disconnect_event *evt = d;
+	struct net_device *ndev = wil_to_ndev(wil);
+	int cid;
 
 	wil_dbg_wmi(wil, "Disconnect %pM reason %d proto %d wmi\n",
 		    evt->bssid,
@@ -493,18 +583,57 @@ static void wmi_evt_disconnect(struct wil6210_priv *wil, int id,
 
 	wil->sinfo_gen++;
 
+	/* own address - all stations, as in wil6210_disconnect() */
+	cid = wil_find_cid(wil, evt->bssid);
+	if (cid >= 0)
+		wil_tx_vring_fw_done(wil, cid);
+	else if (ether_addr_equal(ndev->dev_addr, evt->bssid))
+		wil_tx_vring_fw_done(wil, -1);
+
 	wil6210_disconnect(wil, evt->bssid);
 }
 
+void wil_link_stats_update(struct wil6210_priv *wil, int cid,
+			   struct wmi_notify_req_done_event *evt)
+{
+	struct wil_link_stats *link = &wil->sta[cid].link;
+
+	link->tsf = le64_to_cpu(evt->tsf);
+	link->snr = le32_to_cpu(evt->snr_val);
+	link->tx_tpt = le32_to_cpu(evt->tx_tpt);
+	link->tx_goodput = le32_to_cpu(evt->tx_goodput);
+	link->rx_goodput = le32_to_cpu(evt->rx_goodput);
+	link->bf_mcs = le16_to_cpu(evt->bf_mcs);
+	link->my_rx_sector = le16_to_cpu(evt->my_rx_sector);
+	link->my_tx_sector = le16_to_cpu(evt->my_tx_sector);
+	link->peer_rx_sector = le16_to_cpu(evt->other_rx_sector);
+	link->peer_tx_sector = le16_to_cpu(evt->other_tx_sector);
+	link->sqi = evt->sqi;
+	/* readers check @updated first */
+	smp_wmb();
+	link->updated = jiffies ? : 1;
+}
+
 static void wmi_evt_notify(struct wil6210_priv *wil, int id, void *d, int len)
 {
 	struct wmi_notify_req_done_event *evt = d;
+	/* reset before reports are stopped, see wil_link_notify_stop() */
+	int cid = READ_ONCE(wil->sinfo_notify_cid);
 
 	if (len < sizeof(*evt)) {
 		wil_err(wil, "Short NOTIFY event\n");
 		return;
 	}
 
+	/*
+	 * periodic report, FW reports for one CID at a time. Replies to
+	 * link queries never get here, neither do late ones, see
+	 * wmi_event_handle(); so with no periodic reports requested,
+	 * the source is unknown: ack to report stop, or a stray report
+	 */
+	if (cid >= 0 && wil->sta[cid].status == wil_sta_connected)
+		wil_link_stats_update(wil, cid, evt);
+
 	wil->stats.tsf = le64_to_cpu(evt->tsf);
 	wil->stats.snr = le32_to_cpu(evt->snr_val);
 	wil->stats.bf_mcs = le16_to_cpu(evt->bf_mcs);
@@ -630,22 +759,13 @@ static void wmi_evt_ba_status(struct wil6210_priv *wil, int id, void *d,
 
 	wil_dbg_wmi(wil, "BACK for CID %d %pM\n", cid, sta->addr);
 	for (i = 0; i < WIL_STA_TID_NUM; i++) {
-		struct wil_tid_ampdu_rx *r = sta->tid_rx[i];
-		sta->tid_rx[i] = NULL;
-		wil_tid_ampdu_rx_free(wil, r);
-		if ((evt->status == WMI_BA_AGREED) && evt->agg_wsize) {
-
-wil_err(wil, "EREZK !!! wmi_evt_ba_status: evt->ringid %x, req_agg_wsize %d", evt->ringid, evt->agg_wsize);
+		struct wil_tid_ampdu_rx *r = NULL;
 
-			sta->tid_rx[i] = wil_tid_ampdu_rx_alloc(wil,
-						evt->agg_wsize, 0);
-		}
+		if ((evt->status == WMI_BA_AGREED) && evt->agg_wsize)
+			r = wil_tid_ampdu_rx_alloc(wil, evt->agg_wsize, 0);
+		wil_tid_ampdu_rx_set(wil, sta, i, r);
 	}
 
-
-
-
-
 	txdata = &wil->vring_tx_data[evt->ringid];
 
 	txdata->agg_timeout = le16_to_cpu(evt->ba_timeout);
@@ -664,25 +784,199 @@ static void wmi_evt_rcp_addba_req(struct wil6210_priv *wil, int id, void *d,
 			      evt->ba_seq_ctrl);
 }
 
+static void wmi_evt_addba_resp_sent(struct wil6210_priv *wil, int id,
+				    void *d, int len)
+{
+	struct wmi_rcp_addba_resp_sent_event *evt = d;
+
+	wil_addba_resp_sent(wil, evt->cidxtid, le16_to_cpu(evt->status));
+}
+
+/*
+ * Event handlers table, direct-indexed by WMI_EVT_HASH(eventid).
+ * Multiplier chosen so every event ID of wmi.h lands in its own slot;
+ * should the listed events ever collide, wmi_evt_hash_check() breaks
+ * the build with "duplicate case value".
+ * Events with no handler are replies consumed by wmi_call(), listed
+ * for the statistics.
+ */
+#define WMI_EVT_HASH(id) \
+	((u16)((id) * 0x4e09) >> (16 - WIL_WMI_EVT_HASH_BITS))
+
+#define WMI_EVT_HANDLERS(evt) \
+	evt(WMI_READY_EVENTID,			wmi_evt_ready) \
+	evt(WMI_FW_READY_EVENTID,		wmi_evt_fw_ready) \
+	evt(WMI_RX_MGMT_PACKET_EVENTID,		wmi_evt_rx_mgmt) \
+	evt(WMI_SCAN_COMPLETE_EVENTID,		wmi_evt_scan_complete) \
+	evt(WMI_CONNECT_EVENTID,		wmi_evt_connect) \
+	evt(WMI_DISCONNECT_EVENTID,		wmi_evt_disconnect) \
+	evt(WMI_NOTIFY_REQ_DONE_EVENTID,	wmi_evt_notify) \
+	evt(WMI_EAPOL_RX_EVENTID,		wmi_evt_eapol_rx) \
+	evt(WMI_DATA_PORT_OPEN_EVENTID,		wmi_evt_linkup) \
+	evt(WMI_WBE_LINKDOWN_EVENTID,		wmi_evt_linkdown) \
+	evt(WMI_BA_STATUS_EVENTID,		wmi_evt_ba_status) \
+	evt(WMI_RCP_ADDBA_REQ_EVENTID,		wmi_evt_rcp_addba_req) \
+	evt(WMI_ADDBA_RESP_SENT_EVENTID,	wmi_evt_addba_resp_sent) \
+	evt(WMI_ECHO_RSP_EVENTID,		NULL) \
+	evt(WMI_VRING_CFG_DONE_EVENTID,		NULL) \
+	evt(WMI_CFG_RX_CHAIN_DONE_EVENTID,	NULL) \
+	evt(WMI_SW_TX_COMPLETE_EVENTID,		NULL) \
+	evt(WMI_TEMP_SENSE_DONE_EVENTID,	NULL) \
+	evt(WMI_GET_SSID_EVENTID,		NULL) \
+	evt(WMI_GET_PCP_CHANNEL_EVENTID,	NULL) \
+	evt(WMI_PCP_STARTED_EVENTID,		NULL) \
+	evt(WMI_PCP_STOPPED_EVENTID,		NULL) \
+	evt(WMI_LISTEN_STARTED_EVENTID,		NULL) \
+	evt(WMI_SEARCH_STARTED_EVENTID,		NULL) \
+	evt(WMI_DISCOVERY_STARTED_EVENTID,	NULL) \
+	evt(WMI_DISCOVERY_STOPPED_EVENTID,	NULL)
+
+#define WMI_EVT_ENTRY(id, h) \
+	[WMI_EVT_HASH(id)] = { .eventid = id, .handler = h, .name = #id },
+
 static const struct {
 	int eventid;
 	void (*handler)(struct wil6210_priv *wil, int eventid,
 			void *data, int data_len);
-} wmi_evt_handlers[] = {
-	{WMI_READY_EVENTID,		wmi_evt_ready},
-	{WMI_FW_READY_EVENTID,		wmi_evt_fw_ready},
-	{WMI_RX_MGMT_PACKET_EVENTID,	wmi_evt_rx_mgmt},
-	{WMI_SCAN_COMPLETE_EVENTID,	wmi_evt_scan_complete},
-	{WMI_CONNECT_EVENTID,		wmi_evt_connect},
-	{WMI_DISCONNECT_EVENTID,	wmi_evt_disconnect},
-	{WMI_NOTIFY_REQ_DONE_EVENTID,	wmi_evt_notify},
-	{WMI_EAPOL_RX_EVENTID,		wmi_evt_eapol_rx},
-	{WMI_DATA_PORT_OPEN_EVENTID,	wmi_evt_linkup},
-	{WMI_WBE_LINKDOWN_EVENTID,	wmi_evt_linkdown},
-	{WMI_BA_STATUS_EVENTID,		wmi_evt_ba_status},
-	{WMI_RCP_ADDBA_REQ_EVENTID,	wmi_evt_rcp_addba_req},
+	const char *name;
+} wmi_evt_handlers[WIL_WMI_EVT_SLOTS] = {
+	WMI_EVT_HANDLERS(WMI_EVT_ENTRY)
 };
 
+#define WMI_EVT_CASE(id, h) case WMI_EVT_HASH(id):
+
+static inline void wmi_evt_hash_check(void)
+{
+	switch (0) {
+	WMI_EVT_HANDLERS(WMI_EVT_CASE)
+		break;
+	}
+}
+
+/* name of the event in the handlers table slot, NULL if slot empty */
+const char *wmi_evt_name(uint slot, u16 *eventid)
+{
+	if (slot >= WIL_WMI_EVT_SLOTS || !wmi_evt_handlers[slot].name)
+		return NULL;
+
+	*eventid = wmi_evt_handlers[slot].eventid;
+
+	return wmi_evt_handlers[slot].name + sizeof("WMI_") - 1;
+}
+
+/*
+ * Event buffers pool.
+ *
+ * Buffers sized for the mailbox Rx entry are allocated once FW is ready;
+ * only events that not fit, or arrive when pool is exhausted or not
+ * yet allocated, are kmalloc'ed.
+ * Free list is protected by @wil->wmi_ev_lock
+ */
+static size_t wmi_ev_pool_elem(u16 room)
+{
+	return ALIGN(offsetof(struct pending_wmi_event, event.wmi) + room,
+		     __alignof__(struct pending_wmi_event));
+}
+
+void wmi_ev_pool_init(struct wil6210_priv *wil)
+{
+	u16 room = wil->mbox_ctl.rx.entry_size;
+	size_t elem = wmi_ev_pool_elem(room);
+	struct pending_wmi_event *evt;
+	void *pool;
+	ulong flags;
+	int i;
+
+	if (wil->wmi_ev_pool || !room)
+		return;
+
+	pool = kcalloc(WIL_WMI_EV_POOL, elem, GFP_KERNEL);
+	if (!pool) {
+		wil_err(wil, "No memory for WMI event pool, %d x %zu\n",
+			WIL_WMI_EV_POOL, elem);
+		return;
+	}
+
+	spin_lock_irqsave(&wil->wmi_ev_lock, flags);
+	for (i = 0; i < WIL_WMI_EV_POOL; i++) {
+		evt = pool + i * elem;
+		evt->pooled = true;
+		list_add_tail(&evt->list, &wil->wmi_ev_free);
+	}
+	wil->wmi_ev_pool = pool;
+	wil->wmi_ev_room = room;
+	spin_unlock_irqrestore(&wil->wmi_ev_lock, flags);
+
+	wil_dbg_wmi(wil, "WMI event pool %d x %zu\n", WIL_WMI_EV_POOL, elem);
+}
+
+/*
+ * All pool buffers must be back on the free list: no events pending
+ * and IRQ disabled
+ */
+void wmi_ev_pool_free(struct wil6210_priv *wil)
+{
+	void *pool;
+	ulong flags;
+
+	spin_lock_irqsave(&wil->wmi_ev_lock, flags);
+	pool = wil->wmi_ev_pool;
+	wil->wmi_ev_pool = NULL;
+	wil->wmi_ev_room = 0;
+	INIT_LIST_HEAD(&wil->wmi_ev_free);
+	spin_unlock_irqrestore(&wil->wmi_ev_lock, flags);
+
+	kfree(pool);
+}
+
+static struct pending_wmi_event *wmi_ev_alloc(struct wil6210_priv *wil,
+					      u16 len)
+{
+	struct pending_wmi_event *evt = NULL;
+	ulong flags;
+
+	spin_lock_irqsave(&wil->wmi_ev_lock, flags);
+	if (len <= wil->wmi_ev_room) {
+		if (!list_empty(&wil->wmi_ev_free)) {
+			evt = list_first_entry(&wil->wmi_ev_free,
+					       struct pending_wmi_event, list);
+			list_del(&evt->list);
+		} else {
+			wil->wmi_ev_pool_empty++;
+		}
+	} else if (wil->wmi_ev_pool) {
+		wil->wmi_ev_oversize++;
+	}
+	spin_unlock_irqrestore(&wil->wmi_ev_lock, flags);
+
+	if (evt)
+		return evt;
+
+	evt = kmalloc(ALIGN(offsetof(struct pending_wmi_event,
+				     event.wmi) + len, 4),
+		      GFP_KERNEL);
+	if (evt)
+		evt->pooled = false;
+
+	return evt;
+}
+
+static void wmi_ev_free(struct wil6210_priv *wil,
+			struct pending_wmi_event *evt)
+{
+	ulong flags;
+
+	if (!evt->pooled) {
+		kfree(evt);
+		return;
+	}
+
+	/* LIFO - reuse cache hot buffer */
+	spin_lock_irqsave(&wil->wmi_ev_lock, flags);
+	list_add(&evt->list, &wil->wmi_ev_free);
+	spin_unlock_irqrestore(&wil->wmi_ev_lock, flags);
+}
+
 /*
  * Run in IRQ context
  * Extract WMI command from mailbox. Queue it to the @wil->pending_wmi_ev
@@ -729,9 +1023,7 @@ void wmi_recv_cmd(struct wil6210_priv *wil)
 		len = le16_to_cpu(hdr.len);
 		src = wmi_buffer(wil, d_tail.addr) +
 		      sizeof(struct wil6210_mbox_hdr);
-		evt = kmalloc(ALIGN(offsetof(struct pending_wmi_event,
-					     event.wmi) + len, 4),
-			      GFP_KERNEL);
+		evt = wmi_ev_alloc(wil, len);
 		if (!evt)
 			return;
 
@@ -772,40 +1064,403 @@ void wmi_recv_cmd(struct wil6210_priv *wil)
 	}
 }
 
+/*
+ * Stand-in for @call that timed out. It takes the call's place on
+ * @wil->wmi_calls, so the late reply, if any, gets absorbed rather than
+ * completing the next call waiting for the same event. Dropped by
+ * wmi_call_expire() once no reply came for another timeout period;
+ * if firmware lost the command, the next call's reply is absorbed
+ * instead until then.
+ */
+static struct wil_wmi_call *wmi_call_stale(struct wil_wmi_call *call,
+					   gfp_t gfp)
+{
+	struct wil_wmi_call *stale = kzalloc(sizeof(*stale), gfp);
+
+	if (!stale)
+		return NULL;
+
+	INIT_LIST_HEAD(&stale->list);
+	stale->cmdid = call->cmdid;
+	stale->reply_id = call->reply_id;
+	stale->start = jiffies;
+	stale->deadline = stale->start + (call->deadline - call->start);
+	stale->stale = true;
+
+	return stale;
+}
+
+/*
+ * Detach @call from @wil->wmi_calls if it is still there, leaving
+ * @stale, if not NULL, in its place.
+ * Returns false if the call is already being completed by someone else
+ */
+static bool wmi_call_cancel(struct wil6210_priv *wil,
+			    struct wil_wmi_call *call,
+			    struct wil_wmi_call *stale)
+{
+	bool queued;
+
+	spin_lock(&wil->wmi_call_lock);
+	queued = !list_empty(&call->list);
+	if (queued) {
+		if (stale)
+			list_replace_init(&call->list, &stale->list);
+		else
+			list_del_init(&call->list);
+		wil->wmi_calls_inflight--;
+	}
+	spin_unlock(&wil->wmi_call_lock);
+
+	if (queued)
+		up(&wil->wmi_call_sem);
+	else
+		kfree(stale);
+
+	return queued;
+}
+
+/*
+ * Detach the oldest call waiting for event @id; it may be stale one
+ */
+static struct wil_wmi_call *wmi_call_find(struct wil6210_priv *wil, u16 id)
+{
+	struct wil_wmi_call *call, *ret = NULL;
+
+	spin_lock(&wil->wmi_call_lock);
+	list_for_each_entry(call, &wil->wmi_calls, list) {
+		if (call->reply_id == id) {
+			list_del_init(&call->list);
+			if (!call->stale)
+				wil->wmi_calls_inflight--;
+			ret = call;
+			break;
+		}
+	}
+	spin_unlock(&wil->wmi_call_lock);
+
+	return ret;
+}
+
+/*
+ * Latency statistics, per command ID. Slots taken on first use,
+ * open addressing by command ID
+ */
+static struct wil_wmi_cmd_stat *wmi_cmd_stat(struct wil6210_priv *wil,
+					     u16 cmdid)
+{
+	struct wil_wmi_cmd_stat *st;
+	uint i, slot;
+
+	for (i = 0; i < WIL_WMI_CMD_STATS; i++) {
+		slot = (cmdid + i) % WIL_WMI_CMD_STATS;
+		st = &wil->wmi_cmd_stats[slot];
+		if (st->cmdid == cmdid)
+			return st;
+		if (!st->cmdid) {
+			st->cmdid = cmdid;
+			return st;
+		}
+	}
+
+	return NULL;
+}
+
+static void wmi_call_account(struct wil6210_priv *wil,
+			     struct wil_wmi_call *call, int rc)
+{
+	struct wil_wmi_cmd_stat *st;
+	u32 usec = 0;
+
+	if (ktime_to_ns(call->t_sent))
+		usec = ktime_to_us(ktime_sub(ktime_get(), call->t_sent));
+
+	trace_wil6210_wmi_call(call->cmdid, call->reply_id, rc, usec);
+	wil_dbg_wmi(wil, "wmi_call(0x%04x->0x%04x) done, rc %d in %d usec\n",
+		    call->cmdid, call->reply_id, rc, usec);
+
+	spin_lock(&wil->wmi_cmd_stat_lock);
+	st = wmi_cmd_stat(wil, call->cmdid);
+	if (!st) {
+		wil->wmi_cmd_stats_lost++;
+	} else {
+		st->reply_id = call->reply_id;
+		if (rc == 0)
+			wil_hist_add(&st->lat, usec);
+		else if (rc == -ETIME)
+			st->timeouts++;
+		else
+			st->errors++;
+	}
+	spin_unlock(&wil->wmi_cmd_stat_lock);
+}
+
+/*
+ * Finish call already detached from @wil->wmi_calls.
+ * Blocking call belongs to the waiter once completed, don't touch it after
+ */
+static void wmi_call_done(struct wil6210_priv *wil, struct wil_wmi_call *call,
+			  int rc)
+{
+	wmi_call_account(wil, call, rc);
+
+	call->rc = rc;
+	up(&wil->wmi_call_sem);
+
+	if (call->cb) {
+		call->cb(wil, call->ctx, rc, rc ? NULL : call->reply,
+			 rc ? 0 : call->reply_len);
+		kfree(call);
+	} else {
+		complete(&call->done);
+	}
+}
+
+/*
+ * Schedule expiry for the nearest deadline of the async and stale calls.
+ * Blocking calls track their own timeout
+ */
+static void wmi_call_arm(struct wil6210_priv *wil)
+{
+	struct wil_wmi_call *call;
+	ulong next = 0;
+	bool found = false;
+
+	spin_lock(&wil->wmi_call_lock);
+	list_for_each_entry(call, &wil->wmi_calls, list) {
+		if (!call->cb && !call->stale)
+			continue;
+		if (!found || time_before(call->deadline, next)) {
+			next = call->deadline;
+			found = true;
+		}
+	}
+	spin_unlock(&wil->wmi_call_lock);
+
+	if (found)
+		mod_delayed_work(wil->wmi_wq, &wil->wmi_call_expire,
+				 time_after(next, jiffies) ? next - jiffies : 0);
+}
+
+/*
+ * Put @call on the pending list and send the command.
+ * @to_msec covers both the wait for a free slot and for the reply;
+ * with @nowait, no free slot fails right away.
+ * Returns 0 if the call is in flight or already completed;
+ * otherwise, it was never queued and caller still owns it
+ */
+static int wmi_call_submit(struct wil6210_priv *wil,
+			   struct wil_wmi_call *call, void *buf, u16 len,
+			   int to_msec, bool nowait)
+{
+	int rc;
+
+	call->start = jiffies;
+	call->deadline = call->start + msecs_to_jiffies(to_msec);
+
+	if (nowait ? down_trylock(&wil->wmi_call_sem) :
+	    down_timeout(&wil->wmi_call_sem, msecs_to_jiffies(to_msec))) {
+		wil_err(wil, "wmi_call(0x%04x): %d calls in flight\n",
+			call->cmdid, WIL_WMI_CALLS_MAX);
+		return -EBUSY;
+	}
+
+	/* reply may come before __wmi_send() returns */
+	spin_lock(&wil->wmi_call_lock);
+	list_add_tail(&call->list, &wil->wmi_calls);
+	if (++wil->wmi_calls_inflight > wil->wmi_calls_inflight_max)
+		wil->wmi_calls_inflight_max = wil->wmi_calls_inflight;
+	spin_unlock(&wil->wmi_call_lock);
+
+	mutex_lock(&wil->wmi_mutex);
+	rc = __wmi_send(wil, call->cmdid, buf, len, &call->t_sent);
+	mutex_unlock(&wil->wmi_mutex);
+
+	if (rc && wmi_call_cancel(wil, call, NULL))
+		return rc;
+
+	return 0;
+}
+
+static int __wmi_call_async(struct wil6210_priv *wil, u16 cmdid, void *buf,
+			    u16 len, u16 reply_id, u16 reply_size, int to_msec,
+			    wil_wmi_cb cb, void *ctx, bool nowait)
+{
+	struct wil_wmi_call *call;
+	int rc;
+
+	if (!cb)
+		return -EINVAL;
+
+	call = kzalloc(sizeof(*call) + reply_size, GFP_KERNEL);
+	if (!call)
+		return -ENOMEM;
+
+	call->cmdid = cmdid;
+	call->reply_id = reply_id;
+	call->reply = reply_size ? &call[1] : NULL;
+	call->reply_size = reply_size;
+	call->cb = cb;
+	call->ctx = ctx;
+	init_completion(&call->done);
+
+	rc = wmi_call_submit(wil, call, buf, len, to_msec, nowait);
+	if (rc) {
+		kfree(call);
+		return rc;
+	}
+	/* @call may be gone already */
+	wmi_call_arm(wil);
+
+	return 0;
+}
+
+/**
+ * wmi_call_async - send WMI command, report reply via callback
+ *
+ * @reply_size bytes of the reply event, starting from the WMI header,
+ * are passed to @cb. With @reply_size 0, reply is processed by the
+ * regular event handler and @cb gets no data.
+ * @cb is called on @wil->wmi_wq; or from wmi_call_flush() with error
+ * when firmware goes down. It is called exactly once if 0 returned.
+ */
+int wmi_call_async(struct wil6210_priv *wil, u16 cmdid, void *buf, u16 len,
+		   u16 reply_id, u16 reply_size, int to_msec,
+		   wil_wmi_cb cb, void *ctx)
+{
+	return __wmi_call_async(wil, cmdid, buf, len, reply_id, reply_size,
+				to_msec, cb, ctx, false);
+}
+
+/*
+ * As wmi_call_async(), but never sleeps waiting for a free call slot:
+ * fails with -EBUSY when WIL_WMI_CALLS_MAX calls are in flight
+ */
+int wmi_call_async_try(struct wil6210_priv *wil, u16 cmdid, void *buf,
+		       u16 len, u16 reply_id, u16 reply_size, int to_msec,
+		       wil_wmi_cb cb, void *ctx)
+{
+	return __wmi_call_async(wil, cmdid, buf, len, reply_id, reply_size,
+				to_msec, cb, ctx, true);
+}
+
 int wmi_call(struct wil6210_priv *wil, u16 cmdid, void *buf, u16 len,
 	     u16 reply_id, void *reply, u8 reply_size, int to_msec)
 {
+	struct wil_wmi_call call = {
+		.cmdid = cmdid,
+		.reply_id = reply_id,
+		.reply = reply,
+		.reply_size = reply_size,
+	};
 	int rc;
-	int remain;
+	ulong remain;
 
-	mutex_lock(&wil->wmi_mutex);
+	init_completion(&call.done);
 
-	rc = __wmi_send(wil, cmdid, buf, len);
+	rc = wmi_call_submit(wil, &call, buf, len, to_msec, false);
 	if (rc)
-		goto out;
+		return rc;
 
-	wil->reply_id = reply_id;
-	wil->reply_buf = reply;
-	wil->reply_size = reply_size;
-	remain = wait_for_completion_timeout(&wil->wmi_ready,
-			msecs_to_jiffies(to_msec));
+	remain = time_after(call.deadline, jiffies) ?
+		 call.deadline - jiffies : 0;
+	remain = wait_for_completion_timeout(&call.done, remain);
 	if (0 == remain) {
+		struct wil_wmi_call *stale = wmi_call_stale(&call, GFP_KERNEL);
+
+		if (wmi_call_cancel(wil, &call, stale)) {
+			if (stale)
+				wmi_call_arm(wil);
+			wil_err(wil, "wmi_call(0x%04x->0x%04x) timeout %d msec\n",
+				cmdid, reply_id, to_msec);
+			wil->wmi_calls_timeout++;
+			wmi_call_account(wil, &call, -ETIME);
+			return -ETIME;
+		}
+		/* reply is being delivered right now */
+		wait_for_completion(&call.done);
+	}
+
+	return call.rc;
+}
+
+/*
+ * Fail async calls that passed their deadline, leaving stale ones in
+ * their place; drop stale ones that passed theirs
+ */
+static void wmi_call_expire_overdue(struct wil6210_priv *wil)
+{
+	struct wil_wmi_call *call, *t, *stale;
+	LIST_HEAD(expired);
+	LIST_HEAD(dropped);
+
+	spin_lock(&wil->wmi_call_lock);
+	list_for_each_entry_safe(call, t, &wil->wmi_calls, list) {
+		if ((!call->cb && !call->stale) ||
+		    time_before(jiffies, call->deadline))
+			continue;
+		if (call->stale) {
+			list_move_tail(&call->list, &dropped);
+			continue;
+		}
+		stale = wmi_call_stale(call, GFP_ATOMIC);
+		if (stale)
+			list_add(&stale->list, &call->list);
+		list_move_tail(&call->list, &expired);
+		wil->wmi_calls_inflight--;
+	}
+	spin_unlock(&wil->wmi_call_lock);
+
+	list_for_each_entry_safe(call, t, &dropped, list) {
+		wil_dbg_wmi(wil, "wmi_call(0x%04x->0x%04x) no late reply\n",
+			    call->cmdid, call->reply_id);
+		kfree(call);
+	}
+
+	list_for_each_entry_safe(call, t, &expired, list) {
+		list_del_init(&call->list);
 		wil_err(wil, "wmi_call(0x%04x->0x%04x) timeout %d msec\n",
-			cmdid, reply_id, to_msec);
-		rc = -ETIME;
-	} else {
-		wil_dbg_wmi(wil,
-			    "wmi_call(0x%04x->0x%04x) completed in %d msec\n",
-			    cmdid, reply_id,
-			    to_msec - jiffies_to_msecs(remain));
+			call->cmdid, call->reply_id,
+			jiffies_to_msecs(call->deadline - call->start));
+		wil->wmi_calls_timeout++;
+		wmi_call_done(wil, call, -ETIME);
 	}
-	wil->reply_id = 0;
-	wil->reply_buf = NULL;
-	wil->reply_size = 0;
- out:
-	mutex_unlock(&wil->wmi_mutex);
+}
 
-	return rc;
+void wmi_call_expire(struct work_struct *work)
+{
+	struct wil6210_priv *wil = container_of(to_delayed_work(work),
+						 struct wil6210_priv,
+						 wmi_call_expire);
+
+	wmi_call_expire_overdue(wil);
+	wmi_call_arm(wil);
+}
+
+/*
+ * Complete all calls in flight with @rc; no reply will come for them
+ */
+void wmi_call_flush(struct wil6210_priv *wil, int rc)
+{
+	struct wil_wmi_call *call, *t;
+	LIST_HEAD(calls);
+
+	wil_dbg_wmi(wil, "%s()\n", __func__);
+
+	spin_lock(&wil->wmi_call_lock);
+	list_splice_init(&wil->wmi_calls, &calls);
+	wil->wmi_calls_inflight = 0;
+	spin_unlock(&wil->wmi_call_lock);
+
+	list_for_each_entry_safe(call, t, &calls, list) {
+		list_del_init(&call->list);
+		if (call->stale)
+			kfree(call);
+		else
+			wmi_call_done(wil, call, rc);
+	}
+
+	cancel_delayed_work_sync(&wil->wmi_call_expire);
 }
 
 int wmi_echo(struct wil6210_priv *wil)
@@ -1189,34 +1844,82 @@ int wmi_rx_chain_add(struct wil6210_priv *wil, struct vring *vring)
 	return rc;
 }
 
-int wmi_mgmt_tx(struct wil6210_priv *wil, const u8 *buf, size_t len)
+/* management frame in flight, owned by wmi_mgmt_tx_done() */
+struct wmi_mgmt_tx_ctx {
+	u64 cookie;
+	bool no_ack;
+	size_t len;
+	u8 frame[0];
+};
+
+static void wmi_mgmt_tx_done(struct wil6210_priv *wil, void *ctx, int rc,
+			     void *reply, u16 len)
 {
-	int rc;
-	struct ieee80211_mgmt *mgmt_frame = (void*)buf;
-	struct wmi_sw_tx_req_cmd *cmd;
+	struct wmi_mgmt_tx_ctx *tx = ctx;
 	struct {
 		struct wil6210_mbox_hdr_wmi wmi;
 		struct wmi_sw_tx_complete_event evt;
-	} __packed evt;
+	} __packed *evt = reply;
+	bool acked = (rc == 0) && (len >= sizeof(*evt)) &&
+		     (evt->evt.status == WMI_TX_SW_STATUS_SUCCESS);
+
+	wil_dbg_wmi(wil, "mgmt Tx 0x%016llx done, rc %d %s\n",
+		    tx->cookie, rc, acked ? "ACK" : "no ACK");
+	if (!tx->no_ack)
+		cfg80211_mgmt_tx_status(wil->wdev, tx->cookie, tx->frame,
+					tx->len, acked, GFP_KERNEL);
+	kfree(tx);
+}
+
+/*
+ * Queue management frame to FW. Returns once it is in the mailbox;
+ * result reported with cfg80211_mgmt_tx_status() for @cookie
+ * when WMI_SW_TX_COMPLETE_EVENTID arrives, unless @no_ack.
+ * Never sleeps for a free call slot, -EBUSY instead.
+ *
+ * Completion carries no reference to the frame; it is matched to the
+ * oldest frame in flight, relying on FW to complete frames in order.
+ * Were one completion lost, following ones would be reported for the
+ * wrong frames until the lost one times out; completion arriving past
+ * that deadline fails its frame, see wmi_event_handle(). For this
+ * reason, a call is queued even with @no_ack, to absorb the completion
+ */
+int wmi_mgmt_tx(struct wil6210_priv *wil, const u8 *buf, size_t len,
+		u64 cookie, bool no_ack)
+{
+	int rc;
+	struct ieee80211_mgmt *mgmt_frame = (void*)buf;
+	struct wmi_sw_tx_req_cmd *cmd;
+	struct wmi_mgmt_tx_ctx *tx;
 
+	/* frame copy is only needed to report Tx status */
+	tx = kmalloc(sizeof(*tx) + (no_ack ? 0 : len), GFP_KERNEL);
 	cmd = kmalloc(sizeof(*cmd) + len, GFP_KERNEL);
-	if (!cmd) {
+	if (!tx || !cmd) {
 		rc = -ENOMEM;
 		goto out;
 	}
 
+	tx->cookie = cookie;
+	tx->no_ack = no_ack;
+	tx->len = no_ack ? 0 : len;
+	memcpy(tx->frame, buf, tx->len);
+
 	memcpy(cmd->dst_mac, mgmt_frame->da, WMI_MAC_LEN);
 	cmd->len = cpu_to_le16(len);
 	memcpy(cmd->payload, buf, len);
 
-	rc = wmi_call(wil, WMI_SW_TX_REQ_CMDID, cmd, sizeof(*cmd) + len,
-		      WMI_SW_TX_COMPLETE_EVENTID, &evt, sizeof(evt), 2000);
-	if (rc == 0 && evt.evt.status != WMI_TX_SW_STATUS_SUCCESS)
-		rc = -EINVAL; /* TODO: proper error code here */
-
-	kfree(cmd);
+	rc = wmi_call_async_try(wil, WMI_SW_TX_REQ_CMDID, cmd,
+				sizeof(*cmd) + len, WMI_SW_TX_COMPLETE_EVENTID,
+				sizeof(struct wil6210_mbox_hdr_wmi) +
+				sizeof(struct wmi_sw_tx_complete_event), 2000,
+				wmi_mgmt_tx_done, tx);
+	if (rc == 0)
+		tx = NULL;
 
 out:
+	kfree(cmd);
+	kfree(tx);
 	return rc;
 }
 
@@ -1257,6 +1960,32 @@ int wmi_disconnect_sta(struct wil6210_priv *wil, const u8 *mac, u16 reason)
 	return wmi_send(wil, WMI_DISCONNECT_STA_CMDID, &cmd, sizeof(cmd));
 }
 
+static void wmi_vring_delete_done(struct wil6210_priv *wil, void *ctx,
+				  int rc, void *reply, u16 len)
+{
+	wil_dbg_wmi(wil, "Tx vring [%d] deleted: %d\n", (int)(ulong)ctx, rc);
+}
+
+/*
+ * Ask FW to drop Tx vring, don't wait. Call keeps the reply from being
+ * matched to a Tx vring config in flight
+ */
+int wmi_vring_delete(struct wil6210_priv *wil, int ringid)
+{
+	struct wmi_vring_cfg_cmd cmd = {
+		.action = cpu_to_le32(WMI_VRING_CMD_DELETE),
+		.vring_cfg = {
+			.ringid = ringid,
+		},
+	};
+
+	wil_dbg_wmi(wil, "%s(ring %d)\n", __func__, ringid);
+
+	return wmi_call_async(wil, WMI_VRING_CFG_CMDID, &cmd, sizeof(cmd),
+			      WMI_VRING_CFG_DONE_EVENTID, 0, 100,
+			      wmi_vring_delete_done, (void *)(ulong)ringid);
+}
+
 int wmi_addba(struct wil6210_priv *wil, u8 ringid, u8 size, u16 timeout)
 {
 	struct wmi_vring_ba_en_cmd cmd = {
@@ -1284,10 +2013,12 @@ int wmi_delba(struct wil6210_priv *wil, u8 ringid, u16 reason)
 	return wmi_send(wil, WMI_VRING_BA_DIS_CMDID, &cmd, sizeof(cmd));
 }
 
+/*
+ * Completion reported by WMI_ADDBA_RESP_SENT_EVENTID, asynchronously
+ */
 int wmi_rcp_addba_resp(struct wil6210_priv *wil, u8 cid, u8 tid, u8 token,
 		       u16 status, bool amsdu, u16 agg_wsize, u16 timeout)
 {
-	int rc;
 	struct wmi_rcp_addba_resp_cmd cmd = {
 		.cidxtid = mk_cidxtid(cid, tid),
 		.dialog_token = token,
@@ -1297,20 +2028,8 @@ int wmi_rcp_addba_resp(struct wil6210_priv *wil, u8 cid, u8 tid, u8 token,
 					    (agg_wsize << 6)),
 		.ba_timeout = cpu_to_le16(timeout),
 	};
-	struct {
-		struct wil6210_mbox_hdr_wmi wmi;
-		struct wmi_rcp_addba_resp_sent_event evt;
-	} __packed reply;
 
-	rc = wmi_call(wil, WMI_RCP_ADDBA_RESP_CMDID, &cmd, sizeof(cmd),
-		      WMI_ADDBA_RESP_SENT_EVENTID, &reply, sizeof(reply), 100);
-	if (rc)
-		return rc;
-
-	if (reply.evt.status)
-		rc = -EINVAL;
-
-	return rc;
+	return wmi_send(wil, WMI_RCP_ADDBA_RESP_CMDID, &cmd, sizeof(cmd));
 }
 
 void wmi_event_flush(struct wil6210_priv *wil)
@@ -1321,23 +2040,44 @@ void wmi_event_flush(struct wil6210_priv *wil)
 
 	list_for_each_entry_safe(evt, t, &wil->pending_wmi_ev, list) {
 		list_del(&evt->list);
-		kfree(evt);
+		wmi_ev_free(wil, evt);
 	}
 }
 
 static bool wmi_evt_call_handler(struct wil6210_priv *wil, int id,
 				 void *d, int len)
 {
-	uint i;
+	uint slot = WMI_EVT_HASH(id);
 
-	for (i = 0; i < ARRAY_SIZE(wmi_evt_handlers); i++) {
-		if (wmi_evt_handlers[i].eventid == id) {
-			wmi_evt_handlers[i].handler(wil, id, d, len);
-			return true;
-		}
+	if (wmi_evt_handlers[slot].eventid != id ||
+	    !wmi_evt_handlers[slot].handler)
+		return false;
+
+	wmi_evt_handlers[slot].handler(wil, id, d, len);
+
+	return true;
+}
+
+/* count event and its handling time; called from wmi_event_worker only */
+static void wmi_evt_account(struct wil6210_priv *wil, u16 id, bool reply,
+			    ktime_t start)
+{
+	uint slot = WMI_EVT_HASH(id);
+	struct wil_wmi_evt_stat *st = &wil->wmi_evt_stats[slot];
+	u32 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (!wmi_evt_handlers[slot].name ||
+	    wmi_evt_handlers[slot].eventid != id) {
+		wil->wmi_evt_unknown++;
+		return;
 	}
 
-	return false;
+	st->count++;
+	if (reply)
+		st->replies++;
+	st->time_ns += ns;
+	if (ns > st->max_ns)
+		st->max_ns = ns;
 }
 
 static void wmi_event_handle(struct wil6210_priv *wil,
@@ -1350,25 +2090,42 @@ static void wmi_event_handle(struct wil6210_priv *wil,
 		struct wil6210_mbox_hdr_wmi *wmi = (void *)(&hdr[1]);
 		void *evt_data = (void *)(&wmi[1]);
 		u16 id = le16_to_cpu(wmi->id);
+		struct wil_wmi_call *call;
+		ktime_t start = ktime_get();
+		/*
+		 * reply past the deadline of the oldest async call waiting
+		 * for it is late one; fail the call rather than hand it
+		 * reply that may belong to the next one
+		 */
+		wmi_call_expire_overdue(wil);
 		/* check if someone waits for this event */
-		if (wil->reply_id && wil->reply_id == id) {
-			if (wil->reply_buf) {
-				memcpy(wil->reply_buf, wmi,
-				       min(len, wil->reply_size));
+		call = wmi_call_find(wil, id);
+		if (call && call->stale) {
+			/*
+			 * late reply, nobody waits for it anymore; handler
+			 * could not tell it from unsolicited event, skip it
+			 */
+			wil_err(wil, "Late reply 0x%04x to 0x%04x\n", id,
+				call->cmdid);
+			wil->wmi_calls_stale++;
+			kfree(call);
+			call = NULL;
+		} else if (call) {
+			if (call->reply) {
+				call->reply_len = min(len, call->reply_size);
+				memcpy(call->reply, wmi, call->reply_len);
 			} else {
 				wmi_evt_call_handler(wil, id, evt_data,
 						     len - sizeof(*wmi));
 			}
 			wil_dbg_wmi(wil, "Complete WMI 0x%04x\n", id);
-			complete(&wil->wmi_ready);
-			return;
-		}
-		/* unsolicited event */
-		/* search for handler */
-		if (!wmi_evt_call_handler(wil, id, evt_data,
-					  len - sizeof(*wmi))) {
+			wmi_call_done(wil, call, 0);
+		} else if (!wmi_evt_call_handler(wil, id, evt_data,
+						 len - sizeof(*wmi))) {
+			/* unsolicited event with no handler */
 			wil_err(wil, "Unhandled event 0x%04x\n", id);
 		}
+		wmi_evt_account(wil, id, call != NULL, start);
 	} else {
 		wil_err(wil, "Unknown event type\n");
 		print_hex_dump(KERN_ERR, "evt?? ", DUMP_PREFIX_OFFSET, 16, 1,
@@ -1409,6 +2166,6 @@ void wmi_event_worker(struct work_struct *work)
 	while ((lh = next_wmi_ev(wil)) != NULL) {
 		evt = list_entry(lh, struct pending_wmi_event, list);
 		wmi_event_handle(wil, &evt->event.hdr);
-		kfree(evt);
+		wmi_ev_free(wil, evt);
 	}
 }